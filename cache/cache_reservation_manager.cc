@@ -181,4 +181,5 @@ template class CacheReservationManagerImpl<CacheEntryRole::kMisc>;
 template class CacheReservationManagerImpl<CacheEntryRole::kWriteBuffer>;
 template class CacheReservationManagerImpl<CacheEntryRole::kFileMetadata>;
 template class CacheReservationManagerImpl<CacheEntryRole::kBlobCache>;
+template class CacheReservationManagerImpl<CacheEntryRole::kOmniCache>;
 }  // namespace ROCKSDB_NAMESPACE
@@ -520,8 +520,6 @@ std::vector<std::string> ColumnFamilyData::GetDbPaths() const {
 const uint32_t ColumnFamilyData::kDummyColumnFamilyDataId =
     std::numeric_limits<uint32_t>::max();
 
-OmniCache* g_oc_ = nullptr;
-
 ColumnFamilyData::ColumnFamilyData(
     uint32_t id, const std::string& name, Version* _dummy_versions,
     Cache* _table_cache, WriteBufferManager* write_buffer_manager,
@@ -577,9 +575,10 @@ ColumnFamilyData::ColumnFamilyData(
           "Failed to register data paths of column family (id: %d, name: %s)",
           id_, name_.c_str());
     }
-    oc_ = new OmniCache(cf_options);
-//    oc_ = new OmniCache(cf_options,cfd_dbptr_);
-    g_oc_ = oc_;
+    if (cf_options.omnicache_capacity > 0) {
+      oc_ = new OmniCache(cf_options, cf_options.omnicache_capacity,
+                          ioptions_.stats);
+    }
   }
   Ref();
 
@@ -654,6 +653,16 @@ ColumnFamilyData::ColumnFamilyData(
               CacheReservationManagerImpl<CacheEntryRole::kFileMetadata>>(
               bbto->block_cache)));
     }
+    const auto omnicache_charged =
+        options_overrides.at(CacheEntryRole::kOmniCache).charged;
+    if (bbto->block_cache && oc_ != nullptr &&
+        omnicache_charged == CacheEntryRoleOptions::Decision::kEnabled) {
+      oc_->SetCacheReservationManager(
+          std::make_shared<ConcurrentCacheReservationManager>(
+              std::make_shared<
+                  CacheReservationManagerImpl<CacheEntryRole::kOmniCache>>(
+                  bbto->block_cache)));
+    }
   }
 }
 
@@ -711,6 +720,10 @@ ColumnFamilyData::~ColumnFamilyData() {
           id_, name_.c_str());
     }
   }
+
+  // The evictor was stopped when the DB closed or the column family was
+  // dropped, see OmniCache::Close().
+  delete oc_;
 }
 
 bool ColumnFamilyData::UnrefAndTryDelete() {
@@ -1539,6 +1552,32 @@ Status ColumnFamilyData::SetOptions(
   if (s.ok()) {
     s = ValidateOptions(db_opts, cf_opts);
   }
+  if (s.ok() && options_map.count("omnicache_capacity") > 0) {
+    const size_t oc_capacity = cf_opts.omnicache_capacity;
+    if (oc_ == nullptr && oc_capacity > 0) {
+      s = Status::InvalidArgument(
+          "omnicache_capacity",
+          "column family was opened without OmniCache, reopen to enable it");
+    } else if (oc_ != nullptr) {
+      oc_->SetCapacity(oc_capacity);
+    }
+  }
+  if (s.ok() && oc_ != nullptr &&
+      options_map.count("omnicache_admission_min_frequency") > 0) {
+    oc_->SetAdmissionMinFrequency(cf_opts.omnicache_admission_min_frequency);
+  }
+  if (s.ok() && oc_ != nullptr &&
+      options_map.count("omnicache_replacement_policy") > 0) {
+    oc_->SetReplacementPolicy(cf_opts.omnicache_replacement_policy);
+  }
+  if (s.ok() && oc_ != nullptr &&
+      options_map.count("omnicache_pin_value_min_size") > 0) {
+    oc_->SetPinValueMinSize(cf_opts.omnicache_pin_value_min_size);
+  }
+  if (s.ok() && oc_ != nullptr &&
+      options_map.count("omnicache_warm_restart") > 0) {
+    oc_->SetWarmRestart(cf_opts.omnicache_warm_restart);
+  }
   if (s.ok()) {
     mutable_cf_options_ = MutableCFOptions(cf_opts);
     mutable_cf_options_.RefreshDerivedOptions(ioptions_);
@@ -653,7 +653,7 @@ class ColumnFamilyData {
   std::atomic<uint64_t> next_epoch_number_;
 
  public:
-  OmniCache* oc_;
+  OmniCache* oc_ = nullptr;
   DB* cfd_dbptr_;
 };
 
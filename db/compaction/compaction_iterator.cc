@@ -364,6 +364,16 @@ bool CompactionIterator::InvokeFilterIfNeeded(bool* need_skip,
     decision = CompactionFilter::Decision::kKeep;
   }
 
+  if (filter_changes_ != nullptr &&
+      decision != CompactionFilter::Decision::kKeep) {
+    // A skip drops everything up to the skip key.
+    const bool skip =
+        decision == CompactionFilter::Decision::kRemoveAndSkipUntil;
+    filter_changes_->Add(
+        ikey_.user_key,
+        skip ? Slice(*compaction_filter_skip_until_.rep()) : ikey_.user_key);
+  }
+
   if (decision == CompactionFilter::Decision::kRemove) {
     // convert the current key to a delete; key_ is pointing into
     // current_key_ at this point, so updating current_key_ updates key()
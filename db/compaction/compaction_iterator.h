@@ -9,6 +9,7 @@
 #include <deque>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "db/compaction/compaction.h"
@@ -80,6 +81,30 @@ class SequenceIterWrapper : public InternalIterator {
   bool has_num_itered_ = true;
 };
 
+// User key ranges, both ends included, whose data a compaction filter
+// removed or rewrote, in the order the compaction met them. OmniCache drops
+// them once the output is installed, see CompactionJob::InvalidateOmniCache().
+// Past kMaxRanges they collapse into the one span covering them all.
+struct CompactionFilterChanges {
+  static const size_t kMaxRanges = 1024;
+
+  std::vector<std::pair<std::string, std::string>> ranges;
+  bool collapsed = false;
+
+  void Add(const Slice& begin, const Slice& end) {
+    if (collapsed) {
+      ranges.back().second.assign(end.data(), end.size());
+      return;
+    }
+    ranges.emplace_back(begin.ToString(), end.ToString());
+    if (ranges.size() > kMaxRanges) {
+      ranges.front().second = std::move(ranges.back().second);
+      ranges.resize(1);
+      collapsed = true;
+    }
+  }
+};
+
 class CompactionIterator {
  public:
   // A wrapper around Compaction. Has a much smaller interface, only what
@@ -265,6 +290,11 @@ class CompactionIterator {
     return current_user_key_;
   }
   const CompactionIterationStats& iter_stats() const { return iter_stats_; }
+  // Records in `changes` what the compaction filter removes or rewrites from
+  // now on. nullptr (the default) records nothing.
+  void SetFilterChanges(CompactionFilterChanges* changes) {
+    filter_changes_ = changes;
+  }
   bool HasNumInputEntryScanned() const { return input_.HasNumItered(); }
   uint64_t NumInputEntryScanned() const { return input_.NumItered(); }
   // If the current key should be placed on penultimate level, only valid if
@@ -471,6 +501,7 @@ class CompactionIterator {
   PinnableSlice blob_value_;
   std::string compaction_filter_value_;
   InternalKey compaction_filter_skip_until_;
+  CompactionFilterChanges* filter_changes_ = nullptr;
   // "level_ptrs" holds indices that remember which file of an associated
   // level we were last checking during the last call to compaction->
   // KeyNotExistsBeyondOutputLevel(). This allows future calls to the function
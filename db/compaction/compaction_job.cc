@@ -46,6 +46,7 @@
 #include "port/port.h"
 #include "rocksdb/db.h"
 #include "rocksdb/env.h"
+#include "rocksdb/omnicache.h"
 #include "rocksdb/options.h"
 #include "rocksdb/statistics.h"
 #include "rocksdb/status.h"
@@ -1025,6 +1026,23 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options,
   return status;
 }
 
+void CompactionJob::InvalidateOmniCache() {
+  db_mutex_->AssertHeld();
+  ColumnFamilyData* cfd = compact_->compaction->column_family_data();
+  if (cfd->oc_ == nullptr) {
+    return;
+  }
+  // A filter changes data without a sequence number of its own. Fills of
+  // the changed spans are fenced off until the next write, since reads up
+  // to now may have seen the old data.
+  const SequenceNumber seq = versions_->LastSequence() + 1;
+  for (const auto& state : compact_->sub_compact_states) {
+    for (const auto& range : state.filter_changes.ranges) {
+      cfd->oc_->InvalidateRange(range.first, range.second, seq);
+    }
+  }
+}
+
 void CompactionJob::NotifyOnSubcompactionBegin(
     SubcompactionState* sub_compact) {
   Compaction* c = compact_->compaction;
@@ -1305,6 +1323,9 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
       sub_compact->compaction, compaction_filter, shutting_down_,
       db_options_.info_log, full_history_ts_low, preserve_time_min_seqno_,
       preclude_last_level_min_seqno_);
+  if (cfd->oc_ != nullptr) {
+    c_iter->SetFilterChanges(&sub_compact->filter_changes);
+  }
   c_iter->SeekToFirst();
 
   // Assign range delete aggregator to the target output level, which makes sure
@@ -191,6 +191,10 @@ class CompactionJob {
   Status Install(const MutableCFOptions& mutable_cf_options,
                  bool* compaction_released);
 
+  // REQUIRED: mutex held, the new SuperVersion installed
+  // Drop what the compaction filter removed or rewrote from OmniCache.
+  void InvalidateOmniCache();
+
   // Return the IO status
   IOStatus io_status() const { return io_status_; }
 
@@ -69,6 +69,9 @@ class SubcompactionState {
   // compaction job stats for this sub-compaction
   CompactionJobStats compaction_job_stats;
 
+  // What the compaction filter changed, recorded for OmniCache only
+  CompactionFilterChanges filter_changes;
+
   // sub-compaction job id, which is used to identify different sub-compaction
   // within the same compaction job.
   const uint32_t sub_job_id;
@@ -148,6 +151,7 @@ class SubcompactionState {
         notify_on_subcompaction_completion(
             state.notify_on_subcompaction_completion),
         compaction_job_stats(std::move(state.compaction_job_stats)),
+        filter_changes(std::move(state.filter_changes)),
         sub_job_id(state.sub_job_id),
         compaction_outputs_(std::move(state.compaction_outputs_)),
         penultimate_level_outputs_(std::move(state.penultimate_level_outputs_)),
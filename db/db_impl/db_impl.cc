@@ -52,6 +52,7 @@
 #include "db/table_properties_collector.h"
 #include "db/transaction_log_impl.h"
 #include "db/version_set.h"
+#include "db/wide/wide_columns_helper.h"
 #include "db/write_batch_internal.h"
 #include "db/write_callback.h"
 #include "env/unique_id_gen.h"
@@ -66,6 +67,7 @@
 #include "monitoring/instrumented_mutex.h"
 #include "monitoring/iostats_context_imp.h"
 #include "monitoring/perf_context_imp.h"
+#include "monitoring/perf_counter.h"
 #include "monitoring/persistent_stats_history.h"
 #include "monitoring/thread_status_updater.h"
 #include "monitoring/thread_status_util.h"
@@ -544,6 +546,20 @@ Status DBImpl::CloseHelper() {
   // reached.
   error_handler_.GetRecoveryError().PermitUncheckedError();
 
+  // OmniCache evictors write back into this DB, stop them while it can
+  // still take writes. Joined without the DB mutex, the evictor may need it.
+  autovector<OmniCache*> omnicaches;
+  mutex_.Lock();
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    if (cfd->oc_ != nullptr) {
+      omnicaches.push_back(cfd->oc_);
+    }
+  }
+  mutex_.Unlock();
+  for (OmniCache* oc : omnicaches) {
+    oc->Close();
+  }
+
   // CancelAllBackgroundWork called with false means we just set the shutdown
   // marker. After this we do a variant of the waiting and unschedule work
   // (to consider: moving all the waiting into CancelAllBackgroundWork(true))
@@ -1979,6 +1995,20 @@ static void CleanupGetMergeOperandsState(void* arg1, void* /*arg2*/) {
   delete state;
 }
 
+static void ReleaseOmniCacheWriteBacksHold(void* arg1, void* /*arg2*/) {
+  static_cast<DBImpl*>(arg1)->ReleaseOmniCacheWriteBacks();
+}
+
+// A key span of an OmniCache whose data changed outside the write path, to
+// be invalidated once the DB mutex is released, see
+// OmniCache::InvalidateRange().
+struct OmniCacheInvalidation {
+  OmniCache* oc;
+  std::string smallest;
+  std::string largest;
+  SequenceNumber seq;
+};
+
 }  // namespace
 
 InternalIterator* DBImpl::NewInternalIterator(
@@ -2063,18 +2093,27 @@ Status DBImpl::Get(const ReadOptions& _read_options,
   assert(value != nullptr);
   value->Reset();
 
-  if (OmniCache::Enabled()) {
-    auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
-    auto oc = cfh->cfd()->oc_;
+  // Readers without a snapshot see the newest cached version, including
+  // write-back entries that have not reached the LSM yet.
+  const SequenceNumber oc_read_seq =
+      _read_options.snapshot != nullptr
+          ? _read_options.snapshot->GetSequenceNumber()
+          : kMaxSequenceNumber;
+  auto oc_cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
+  OmniCache* oc = oc_cfh->cfd()->oc_;
+  if (oc != nullptr && !oc->ServesReadsAt(_read_options.timestamp)) {
+    oc = nullptr;
+  }
+  if (oc != nullptr) {
     try {
-      auto p = oc->Seek(key);
-      if (p->Valid() && p->Key() == key) {
-        Slice found_value = p->Value();  // TODO: if we delete or change
-        // there may have multi thread problem
-        value->PinSelf(found_value);
-        // TODO : we should process the timestamp
+      auto p = oc->Seek(key, oc_read_seq);
+      if (p->Valid()) {
+        OmniCache::PinValue(p->Current(), value, timestamp);
         return Status::OK();
       }
+      if (p->KnownAbsent()) {
+        return Status::NotFound();
+      }
 
     } catch (const std::exception& e) {
       return Status::IOError("Exception during Get in OC");
@@ -2097,13 +2136,64 @@ Status DBImpl::Get(const ReadOptions& _read_options,
     read_options.io_activity = Env::IOActivity::kGet;
   }
 
-  Status s = GetImpl(read_options, column_family, key, value, timestamp);
+  if (oc == nullptr) {
+    return GetImpl(read_options, column_family, key, value, timestamp);
+  }
+  // OC refill. Read as columns, so an entity is cached whole and not as
+  // its default column.
+  PinnableWideColumns columns;
+  Status s = GetImplWithOmniCacheFill(read_options, column_family, key,
+                                      &columns, timestamp);
+  if (s.ok()) {
+    const WideColumns& cols = columns.columns();
+    value->PinSelf(WideColumnsHelper::HasDefaultColumn(cols)
+                       ? WideColumnsHelper::GetDefaultColumn(cols)
+                       : Slice());
+  }
+  return s;
+}
 
-  // OC refill
-  if(OmniCache::Enabled()){
-    auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
-    auto& oc = cfh->cfd()->oc_;
-    oc->Insert(key, Slice(value->data(),value->size()));
+Status DBImpl::GetImplWithOmniCacheFill(const ReadOptions& read_options,
+                                        ColumnFamilyHandle* column_family,
+                                        const Slice& key,
+                                        PinnableWideColumns* columns,
+                                        std::string* timestamp) {
+  auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
+  OmniCache* oc = cfh->cfd()->oc_;
+  const size_t ts_sz = cfh->GetComparator()->timestamp_size();
+  // Taken before the lookup: GetImpl reads at this sequence or later, and the
+  // fill is rejected if any write landed in between.
+  const SequenceNumber oc_fill_seq =
+      read_options.snapshot != nullptr
+          ? read_options.snapshot->GetSequenceNumber()
+          : GetLatestSequenceNumber();
+  // The fill needs the version's timestamp even if the caller does not.
+  std::string oc_ts;
+  if (ts_sz > 0 && timestamp == nullptr) {
+    timestamp = &oc_ts;
+  }
+  GetImplOptions get_impl_options;
+  get_impl_options.column_family = column_family;
+  get_impl_options.columns = columns;
+  get_impl_options.timestamp = timestamp;
+  Status s = GetImpl(read_options, key, get_impl_options);
+
+  // Other tiers may not have looked everywhere, and a read that ignores
+  // range tombstones may return deleted data.
+  if (read_options.read_tier != kReadAllTier ||
+      read_options.ignore_range_deletions) {
+    return s;
+  }
+  if (s.ok()) {
+    if (ts_sz == 0) {
+      oc->Insert(key, columns->columns(), oc_fill_seq);
+    } else {
+      std::string oc_key(key.data(), key.size());
+      oc_key.append(*timestamp);
+      oc->Insert(oc_key, columns->columns(), oc_fill_seq);
+    }
+  } else if (s.IsNotFound()) {
+    oc->InsertAbsent(key, oc_fill_seq);
   }
   return s;
 }
@@ -2143,6 +2233,25 @@ Status DBImpl::GetEntity(const ReadOptions& _read_options,
   }
   columns->Reset();
 
+  auto oc_cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
+  OmniCache* oc = oc_cfh->cfd()->oc_;
+  if (oc != nullptr && oc->ServesReadsAt(read_options.timestamp)) {
+    // Same visibility as Get().
+    const SequenceNumber oc_read_seq =
+        read_options.snapshot != nullptr
+            ? read_options.snapshot->GetSequenceNumber()
+            : kMaxSequenceNumber;
+    auto p = oc->Seek(key, oc_read_seq);
+    if (p->Valid()) {
+      return OmniCache::PinColumns(p->Current(), columns);
+    }
+    if (p->KnownAbsent()) {
+      return Status::NotFound();
+    }
+    return GetImplWithOmniCacheFill(read_options, column_family, key, columns,
+                                    nullptr /* timestamp */);
+  }
+
   GetImplOptions get_impl_options;
   get_impl_options.column_family = column_family;
   get_impl_options.columns = columns;
@@ -2828,6 +2937,26 @@ void DBImpl::MultiGetCommon(const ReadOptions& read_options,
             return &(*cf_iter);
           };
 
+  // Without a snapshot the batch reads the caches at the sequence number
+  // picked below, so it holds write-backs off like a snapshot would.
+  bool oc_hold = false;
+  if (read_options.snapshot == nullptr) {
+    for (auto& cf_data : multiget_cf_data) {
+      if (cf_data.cfd->oc_ != nullptr) {
+        if (!oc_hold) {
+          HoldOmniCacheWriteBacks();
+          oc_hold = true;
+        }
+        FlushOmniCacheWriteBacks(cf_data.cfd);
+      }
+    }
+  }
+  Defer release_write_backs([this, oc_hold]() {
+    if (oc_hold) {
+      ReleaseOmniCacheWriteBacks();
+    }
+  });
+
   SequenceNumber consistent_seqnum;
   bool sv_from_thread_local;
   Status s = MultiCFSnapshot<
@@ -2853,9 +2982,10 @@ void DBImpl::MultiGetCommon(const ReadOptions& read_options,
 
   auto cf_iter = multiget_cf_data.begin();
   for (; cf_iter != multiget_cf_data.end(); ++cf_iter) {
-    s = MultiGetImpl(read_options, cf_iter->start, cf_iter->num_keys,
-                     &sorted_keys, cf_iter->super_version, consistent_seqnum,
-                     read_callback);
+    s = MultiGetImplWithOmniCache(read_options, cf_iter->start,
+                                  cf_iter->num_keys, &sorted_keys,
+                                  cf_iter->super_version, consistent_seqnum,
+                                  read_callback);
     if (!s.ok()) {
       break;
     }
@@ -3016,6 +3146,20 @@ void DBImpl::MultiGetWithCallbackImpl(
             return &(*cf_iter);
           };
 
+  // Same as MultiGetCommon().
+  const bool oc_hold = callback == nullptr &&
+                       read_options.snapshot == nullptr &&
+                       multiget_cf_data[0].cfd->oc_ != nullptr;
+  if (oc_hold) {
+    HoldOmniCacheWriteBacks();
+    FlushOmniCacheWriteBacks(multiget_cf_data[0].cfd);
+  }
+  Defer release_write_backs([this, oc_hold]() {
+    if (oc_hold) {
+      ReleaseOmniCacheWriteBacks();
+    }
+  });
+
   size_t num_keys = sorted_keys->size();
   SequenceNumber consistent_seqnum;
   bool sv_from_thread_local;
@@ -3059,14 +3203,145 @@ void DBImpl::MultiGetWithCallbackImpl(
     read_callback = &timestamp_read_callback;
   }
 
-  s = MultiGetImpl(read_options, 0, num_keys, sorted_keys,
-                   multiget_cf_data[0].super_version, consistent_seqnum,
-                   read_callback);
+  // A caller's own callback (e.g. a transaction's uncommitted writes) may
+  // show data the cache knows nothing about.
+  if (callback == nullptr) {
+    s = MultiGetImplWithOmniCache(read_options, 0, num_keys, sorted_keys,
+                                  multiget_cf_data[0].super_version,
+                                  consistent_seqnum, read_callback);
+  } else {
+    s = MultiGetImpl(read_options, 0, num_keys, sorted_keys,
+                     multiget_cf_data[0].super_version, consistent_seqnum,
+                     read_callback);
+  }
   assert(s.ok() || s.IsTimedOut() || s.IsAborted());
   ReturnAndCleanupSuperVersion(multiget_cf_data[0].cfd,
                                multiget_cf_data[0].super_version);
 }
 
+Status DBImpl::MultiGetImplWithOmniCache(
+    const ReadOptions& read_options, size_t start_key, size_t num_keys,
+    autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE>* sorted_keys,
+    SuperVersion* super_version, SequenceNumber snapshot,
+    ReadCallback* callback) {
+  static PERFCOUNTER_DEF("/oc/multiget/", keys);
+  static PERFCOUNTER_DEF("/oc/multiget/", hits);
+
+  OmniCache* oc = super_version->cfd->oc_;
+  if (oc == nullptr || num_keys == 0 ||
+      !oc->ServesReadsAt(read_options.timestamp)) {
+    return MultiGetImpl(read_options, start_key, num_keys, sorted_keys,
+                        super_version, snapshot, callback);
+  }
+  const size_t ts_sz = super_version->cfd->user_comparator()->timestamp_size();
+  // Hits are read at the batch's sequence number, like the misses: a later
+  // write of a key is a miss, and write-backs are held off while the batch
+  // runs, see MultiGetCommon().
+  // The keys are sorted by the column family's comparator already.
+  std::vector<Slice> user_keys;
+  user_keys.reserve(num_keys);
+  for (size_t i = start_key; i < start_key + num_keys; ++i) {
+    user_keys.push_back(*(*sorted_keys)[i]->key);
+  }
+  std::vector<bool> hit(num_keys, false);
+  oc->MultiFind(
+      user_keys, snapshot,
+      [&](size_t i, const FollyValue& current) {
+        KeyContext* kctx = (*sorted_keys)[start_key + i];
+        Status s;
+        if (kctx->value != nullptr) {
+          OmniCache::PinValue(current, kctx->value, kctx->timestamp);
+        } else {
+          s = OmniCache::PinColumns(current, kctx->columns, kctx->timestamp);
+        }
+        *kctx->s = s;
+        hit[i] = true;
+      },
+      [&](size_t i) {
+        *(*sorted_keys)[start_key + i]->s = Status::NotFound();
+        hit[i] = true;
+      });
+
+  autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE> misses;
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (!hit[i]) {
+      misses.push_back((*sorted_keys)[start_key + i]);
+    }
+  }
+  keys += num_keys;
+  hits += num_keys - misses.size();
+  if (misses.empty()) {
+    return Status::OK();
+  }
+
+  // The fill needs each version's timestamp even if the caller does not.
+  std::vector<std::string> miss_ts(ts_sz > 0 ? misses.size() : 0);
+  for (size_t i = 0; i < miss_ts.size(); ++i) {
+    if (misses[i]->timestamp == nullptr) {
+      misses[i]->timestamp = &miss_ts[i];
+    }
+  }
+  // Misses are read as columns, so an entity is cached whole and not as
+  // its default column. MultiGet callers get that column back below.
+  std::vector<PinnableSlice*> miss_values(misses.size());
+  std::vector<PinnableWideColumns> miss_columns(misses.size());
+  for (size_t i = 0; i < misses.size(); ++i) {
+    if (misses[i]->value != nullptr) {
+      miss_values[i] = misses[i]->value;
+      misses[i]->value = nullptr;
+      misses[i]->columns = &miss_columns[i];
+    }
+  }
+  Status s = MultiGetImpl(read_options, 0, misses.size(), &misses,
+                          super_version, snapshot, callback);
+
+  // Filled at the sequence the misses were read at, so a write of a key
+  // since then rejects its fill, see FollySkipList::FillAllowed(). Same
+  // read options as GetImplWithOmniCacheFill() fill.
+  const bool fill = read_options.read_tier == kReadAllTier &&
+                    !read_options.ignore_range_deletions;
+  std::vector<std::string> fill_keys;
+  fill_keys.reserve(ts_sz > 0 ? misses.size() : 0);
+  std::vector<std::pair<Slice, const WideColumns*>> fills;
+  for (size_t i = 0; i < misses.size(); ++i) {
+    KeyContext* kctx = misses[i];
+    if (i < miss_ts.size() && kctx->timestamp == &miss_ts[i]) {
+      kctx->timestamp = nullptr;
+    }
+    const WideColumns& columns = kctx->columns->columns();
+    if (miss_values[i] != nullptr) {
+      kctx->value = miss_values[i];
+      kctx->columns = nullptr;
+      if (kctx->s->ok()) {
+        kctx->value->PinSelf(WideColumnsHelper::HasDefaultColumn(columns)
+                                 ? WideColumnsHelper::GetDefaultColumn(columns)
+                                 : Slice());
+      }
+    }
+    if (!fill) {
+      continue;
+    }
+    if (kctx->s->IsNotFound() && ts_sz == 0) {
+      fills.emplace_back(*kctx->key, nullptr);
+      continue;
+    }
+    if (!kctx->s->ok()) {
+      continue;
+    }
+    Slice key = *kctx->key;
+    if (ts_sz > 0) {
+      const std::string& ts =
+          kctx->timestamp != nullptr ? *kctx->timestamp : miss_ts[i];
+      fill_keys.emplace_back(key.data(), key.size());
+      fill_keys.back().append(ts);
+      key = fill_keys.back();
+    }
+    fills.emplace_back(key, &columns);
+  }
+  oc->InsertBatch(fills, snapshot);
+  return s;
+}
+
 // The actual implementation of batched MultiGet. Parameters -
 // start_key - Index in the sorted_keys vector to start processing from
 // num_keys - Number of keys to lookup, starting with sorted_keys[start_key]
@@ -3464,6 +3739,9 @@ Status DBImpl::CreateColumnFamilyImpl(const ReadOptions& read_options,
       assert(cfd != nullptr);
       InstallSuperVersionAndScheduleWork(cfd, &sv_context,
                                          *cfd->GetLatestMutableCFOptions());
+      if (cfd->oc_ != nullptr) {
+        cfd->oc_->SetWriteBack(this, cfd->GetID());
+      }
 
       if (!cfd->mem()->IsSnapshotSupported()) {
         is_snapshot_supported_ = false;
@@ -3589,6 +3867,9 @@ Status DBImpl::DropColumnFamilyImpl(ColumnFamilyHandle* column_family) {
     // cfd before its ref-count goes to zero to avoid having to erase cf_info
     // later inside db_mutex.
     EraseThreadStatusCfInfo(cfd);
+    if (cfd->oc_ != nullptr) {
+      cfd->oc_->Close(true /* drop */);
+    }
     assert(cfd->IsDropped());
     ROCKS_LOG_INFO(immutable_db_options_.info_log,
                    "Dropped column family with id %u\n", cfd->GetID());
@@ -3708,6 +3989,15 @@ ArenaWrappedDBIter* DBImpl::NewIteratorImpl(
   TEST_SYNC_POINT("DBImpl::NewIterator:1");
   TEST_SYNC_POINT("DBImpl::NewIterator:2");
 
+  // An iterator reads the cache at its sequence number like a snapshot
+  // does, also one picked below or by Refresh(), so it holds write-backs
+  // off the same way while it lives.
+  const bool oc_hold = cfh->cfd()->oc_ != nullptr;
+  if (oc_hold) {
+    HoldOmniCacheWriteBacks();
+    FlushOmniCacheWriteBacks(cfh->cfd());
+  }
+
   if (snapshot == kMaxSequenceNumber) {
     // Note that the snapshot is assigned AFTER referencing the super
     // version because otherwise a flush happening in between may compact away
@@ -3770,6 +4060,9 @@ ArenaWrappedDBIter* DBImpl::NewIteratorImpl(
       sv->current, snapshot,
       sv->mutable_cf_options.max_sequential_skip_in_iterations,
       sv->version_number, read_callback, cfh, expose_blob_index, allow_refresh);
+  if (oc_hold) {
+    db_iter->RegisterCleanup(ReleaseOmniCacheWriteBacksHold, this, nullptr);
+  }
 
   InternalIterator* internal_iter = NewInternalIterator(
       db_iter->GetReadOptions(), cfh->cfd(), sv, db_iter->GetArena(), snapshot,
@@ -3892,20 +4185,80 @@ Status DBImpl::NewIterators(
   return Status::OK();
 }
 
-const Snapshot* DBImpl::GetSnapshot() { return GetSnapshotImpl(false); }
+const Snapshot* DBImpl::GetSnapshot() {
+  FenceOmniCacheWriteBacks();
+  const Snapshot* snapshot = GetSnapshotImpl(false);
+  oc_write_back_holds_.fetch_sub(1);
+  return snapshot;
+}
 
 const Snapshot* DBImpl::GetSnapshotForWriteConflictBoundary() {
-  return GetSnapshotImpl(true);
+  FenceOmniCacheWriteBacks();
+  const Snapshot* snapshot = GetSnapshotImpl(true);
+  oc_write_back_holds_.fetch_sub(1);
+  return snapshot;
 }
 
 std::pair<Status, std::shared_ptr<const Snapshot>>
 DBImpl::CreateTimestampedSnapshot(SequenceNumber snapshot_seq, uint64_t ts) {
   assert(ts != std::numeric_limits<uint64_t>::max());
 
+  FenceOmniCacheWriteBacks();
   auto ret = CreateTimestampedSnapshotImpl(snapshot_seq, ts, /*lock=*/true);
+  oc_write_back_holds_.fetch_sub(1);
   return ret;
 }
 
+void DBImpl::FenceOmniCacheWriteBacks() {
+  // From here on Puts write through, and the write-backs before are in
+  // their caches. No cache gets newly dirty while the hold lasts.
+  HoldOmniCacheWriteBacks();
+  autovector<ColumnFamilyData*> cfds;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (cfd->oc_ != nullptr && !cfd->IsDropped() &&
+          cfd->oc_->write_back_pending_.load(std::memory_order_acquire)) {
+        cfd->Ref();
+        cfds.push_back(cfd);
+      }
+    }
+  }
+  if (cfds.empty()) {
+    return;
+  }
+  for (ColumnFamilyData* cfd : cfds) {
+    FlushOmniCacheWriteBacks(cfd);
+  }
+  InstrumentedMutexLock l(&mutex_);
+  for (ColumnFamilyData* cfd : cfds) {
+    cfd->UnrefAndTryDelete();
+  }
+}
+
+void DBImpl::FlushOmniCacheWriteBacks(ColumnFamilyData* cfd) {
+  OmniCache* oc = cfd->oc_;
+  if (oc == nullptr ||
+      !oc->write_back_pending_.load(std::memory_order_acquire)) {
+    return;
+  }
+  // A reader racing with this one waits for the entries to be out: the
+  // flag is only cleared once they are.
+  std::lock_guard<std::mutex> fence_lock(oc_snapshot_fence_mu_);
+  if (!oc->write_back_pending_.load(std::memory_order_acquire)) {
+    return;
+  }
+  Status s = oc->FlushDirty();
+  if (s.ok()) {
+    oc->write_back_pending_.store(false, std::memory_order_release);
+  } else {
+    // Left for the next reader to try again.
+    ROCKS_LOG_WARN(immutable_db_options_.info_log,
+                   "OmniCache write-back before snapshot failed: %s",
+                   s.ToString().c_str());
+  }
+}
+
 std::shared_ptr<const SnapshotImpl> DBImpl::GetTimestampedSnapshot(
     uint64_t ts) const {
   InstrumentedMutexLock lock_guard(&mutex_);
@@ -3963,6 +4316,7 @@ SnapshotImpl* DBImpl::GetSnapshotImpl(bool is_write_conflict_boundary,
   auto snapshot_seq = GetLastPublishedSequence();
   SnapshotImpl* snapshot =
       snapshots_.New(s, snapshot_seq, unix_time, is_write_conflict_boundary);
+  oc_write_back_holds_.fetch_add(1);
   if (lock) {
     mutex_.Unlock();
   }
@@ -4053,6 +4407,7 @@ DBImpl::CreateTimestampedSnapshotImpl(SequenceNumber snapshot_seq, uint64_t ts,
   SnapshotImpl* snapshot =
       snapshots_.New(s, snapshot_seq, unix_time,
                      /*is_write_conflict_boundary=*/true, ts);
+  oc_write_back_holds_.fetch_add(1);
 
   std::shared_ptr<const SnapshotImpl> ret(
       snapshot,
@@ -4101,6 +4456,7 @@ void DBImpl::ReleaseSnapshot(const Snapshot* s) {
   {
     InstrumentedMutexLock l(&mutex_);
     snapshots_.Delete(casted_s);
+    oc_write_back_holds_.fetch_sub(1);
     uint64_t oldest_snapshot;
     if (snapshots_.empty()) {
       oldest_snapshot = GetLastPublishedSequence();
@@ -4737,6 +5093,7 @@ Status DBImpl::DeleteFilesInRanges(ColumnFamilyHandle* column_family,
 
   VersionEdit edit;
   std::set<FileMetaData*> deleted_files;
+  std::vector<OmniCacheInvalidation> oc_invalidations;
   JobContext job_context(next_job_id_.fetch_add(1), true);
   {
     InstrumentedMutexLock l(&mutex_);
@@ -4807,6 +5164,16 @@ Status DBImpl::DeleteFilesInRanges(ColumnFamilyHandle* column_family,
           cfd, job_context.superversion_contexts.data(),
           *cfd->GetLatestMutableCFOptions());
     }
+    if (status.ok() && cfd->oc_ != nullptr) {
+      // The deleted data has no sequence number of its own: fills of the
+      // spans stop until the next write, reads up to now may have seen it.
+      for (auto* deleted_file : deleted_files) {
+        oc_invalidations.push_back(
+            {cfd->oc_, deleted_file->smallest.user_key().ToString(),
+             deleted_file->largest.user_key().ToString(),
+             versions_->LastSequence() + 1});
+      }
+    }
     for (auto* deleted_file : deleted_files) {
       deleted_file->being_compacted = false;
     }
@@ -4814,6 +5181,10 @@ Status DBImpl::DeleteFilesInRanges(ColumnFamilyHandle* column_family,
     FindObsoleteFiles(&job_context, false);
   }  // lock released here
 
+  for (const auto& inv : oc_invalidations) {
+    inv.oc->InvalidateRange(inv.smallest, inv.largest, inv.seq);
+  }
+
   LogFlush(immutable_db_options_.info_log);
   // remove files outside the db-lock
   if (job_context.HaveSomethingToDelete()) {
@@ -5718,6 +6089,48 @@ Status DBImpl::IngestExternalFiles(
     return status;
   }
 
+  // Write-back values cached in the ingested key spans go to the memtable
+  // first, so the ingestion is ordered after them. Until it is done, Puts
+  // write through and queue up behind it.
+  bool has_omnicache = false;
+  for (size_t i = 0; i != num_cfs; ++i) {
+    if (static_cast<ColumnFamilyHandleImpl*>(args[i].column_family)
+            ->cfd()
+            ->oc_ != nullptr) {
+      has_omnicache = true;
+    }
+  }
+  if (has_omnicache) {
+    HoldOmniCacheWriteBacks();
+  }
+  Defer release_write_backs([this, has_omnicache]() {
+    if (has_omnicache) {
+      ReleaseOmniCacheWriteBacks();
+    }
+  });
+  for (size_t i = 0; status.ok() && i != num_cfs; ++i) {
+    OmniCache* oc =
+        static_cast<ColumnFamilyHandleImpl*>(args[i].column_family)->cfd()->oc_;
+    if (oc == nullptr) {
+      continue;
+    }
+    for (const auto& file : ingestion_jobs[i].files_to_ingest()) {
+      status = oc->FlushDirty(file.smallest_internal_key.user_key(),
+                              file.largest_internal_key.user_key());
+      if (!status.ok()) {
+        break;
+      }
+    }
+  }
+  if (!status.ok()) {
+    for (size_t i = 0; i != num_cfs; ++i) {
+      ingestion_jobs[i].Cleanup(status);
+    }
+    InstrumentedMutexLock l(&mutex_);
+    ReleaseFileNumberFromPendingOutputs(pending_output_elem);
+    return status;
+  }
+
   std::vector<SuperVersionContext> sv_ctxs;
   for (size_t i = 0; i != num_cfs; ++i) {
     sv_ctxs.emplace_back(true /* create_superversion */);
@@ -5725,6 +6138,7 @@ Status DBImpl::IngestExternalFiles(
   TEST_SYNC_POINT("DBImpl::IngestExternalFiles:BeforeJobsRun:0");
   TEST_SYNC_POINT("DBImpl::IngestExternalFiles:BeforeJobsRun:1");
   TEST_SYNC_POINT("DBImpl::AddFile:Start");
+  std::vector<OmniCacheInvalidation> oc_invalidations;
   {
     InstrumentedMutexLock l(&mutex_);
     TEST_SYNC_POINT("DBImpl::AddFile:MutexLock");
@@ -5881,6 +6295,17 @@ Status DBImpl::IngestExternalFiles(
                 "DBImpl::IngestExternalFiles:InstallSVForFirstCF:1");
           }
 #endif  // !NDEBUG
+          if (cfd->oc_ != nullptr) {
+            // Only the key spans of the ingested files. Files ingested at
+            // sequence 0 have no sequence number of their own: fills read
+            // up to now are fenced off until the next write.
+            const SequenceNumber oc_seq = versions_->LastSequence() + 1;
+            for (const auto& file : ingestion_jobs[i].files_to_ingest()) {
+              oc_invalidations.push_back(
+                  {cfd->oc_, file.smallest_internal_key.user_key().ToString(),
+                   file.largest_internal_key.user_key().ToString(), oc_seq});
+            }
+          }
         }
       }
     } else if (versions_->io_status().IsIOError()) {
@@ -5914,6 +6339,11 @@ Status DBImpl::IngestExternalFiles(
   }
   // mutex_ is unlocked here
 
+  // Readers get the new SuperVersion now; drop what they cached before.
+  for (const auto& inv : oc_invalidations) {
+    inv.oc->InvalidateRange(inv.smallest, inv.largest, inv.seq);
+  }
+
   // Cleanup
   for (size_t i = 0; i != num_cfs; ++i) {
     sv_ctxs[i].Clean();
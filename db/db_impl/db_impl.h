@@ -16,6 +16,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -455,6 +456,43 @@ class DBImpl : public DB {
 
   SequenceNumber GetLatestSequenceNumber() const override;
 
+  // A write-back Put (see DB::Put) keeps its value out of the LSM, tagged
+  // with the latest sequence number, which a snapshot may share. So Puts
+  // only write back while nothing holds them off, and taking a snapshot
+  // first writes the dirty OmniCache entries out.
+  // BeginOmniCacheWriteBack() returns false if the Put has to write
+  // through; otherwise it is paired with an EndOmniCacheWriteBack() once
+  // the value is in the cache. The two are a Dekker pair with
+  // HoldOmniCacheWriteBacks(): each side first bumps its own counter, then
+  // reads the other's, all seq_cst. So either the Put sees the hold and
+  // writes through, or the hold sees the write-back in flight and waits for
+  // it.
+  bool BeginOmniCacheWriteBack() {
+    if (oc_write_back_holds_.load(std::memory_order_relaxed) != 0) {
+      return false;
+    }
+    oc_write_backs_in_flight_.fetch_add(1, std::memory_order_seq_cst);
+    if (oc_write_back_holds_.load(std::memory_order_seq_cst) != 0) {
+      oc_write_backs_in_flight_.fetch_sub(1, std::memory_order_release);
+      return false;
+    }
+    return true;
+  }
+  void EndOmniCacheWriteBack() {
+    oc_write_backs_in_flight_.fetch_sub(1, std::memory_order_release);
+  }
+  // Makes Puts write through, e.g. while files are ingested, until the
+  // matching ReleaseOmniCacheWriteBacks(). Write-backs that did not see the
+  // hold are in their caches, and have marked them
+  // OmniCache::write_back_pending_, once this returns.
+  void HoldOmniCacheWriteBacks() {
+    oc_write_back_holds_.fetch_add(1, std::memory_order_seq_cst);
+    while (oc_write_backs_in_flight_.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+  void ReleaseOmniCacheWriteBacks() { oc_write_back_holds_.fetch_sub(1); }
+
   // IncreaseFullHistoryTsLow(ColumnFamilyHandle*, std::string) will acquire
   // and release db_mutex
   Status IncreaseFullHistoryTsLow(ColumnFamilyHandle* column_family,
@@ -1831,6 +1869,17 @@ class DBImpl : public DB {
   // Required: DB mutex held
   Status PersistentStatsProcessFormatVersion();
 
+  // Replays the OmniCache write-back logs a crash left behind. Entries still
+  // newer than the LSM are written through the WAL, then the logs are
+  // deleted, along with those of dropped column families.
+  // Required: DB mutex not held
+  Status RecoverOmniCacheLogs(const WriteOptions& write_options);
+
+  // Starts reading the ranges OmniCaches saved on the last close back into
+  // the caches, see ColumnFamilyOptions::omnicache_warm_restart.
+  // Required: DB mutex not held
+  void StartOmniCacheWarmUp();
+
   Status ResumeImpl(DBRecoverContext context);
 
   void MaybeIgnoreError(Status* s) const;
@@ -2219,6 +2268,18 @@ class DBImpl : public DB {
   SnapshotImpl* GetSnapshotImpl(bool is_write_conflict_boundary,
                                 bool lock = true);
 
+  // Called by the public snapshot calls before they take their snapshot:
+  // takes HoldOmniCacheWriteBacks(), then writes back the dirty entries of
+  // every OmniCache with write-backs pending. Returns with the hold, which
+  // the caller drops once its snapshot, if any, is registered.
+  // Required: DB mutex not held
+  void FenceOmniCacheWriteBacks();
+  // The same for one column family, for reads that pin a sequence number
+  // without a snapshot (iterators, MultiGet). Requires a
+  // HoldOmniCacheWriteBacks() and a reference to `cfd`.
+  // Required: DB mutex not held
+  void FlushOmniCacheWriteBacks(ColumnFamilyData* cfd);
+
   // If snapshot_seq != kMaxSequenceNumber, then this function can only be
   // called from the write thread that publishes sequence numbers to readers.
   // For 1) write-committed, or 2) write-prepared + one-write-queue, this will
@@ -2384,6 +2445,22 @@ class DBImpl : public DB {
       autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE>* sorted_keys,
       SuperVersion* sv, SequenceNumber snap_seqnum, ReadCallback* callback);
 
+  // GetImpl() into `columns` for a miss of the column family's OmniCache,
+  // which is then filled with the result.
+  Status GetImplWithOmniCacheFill(const ReadOptions& read_options,
+                                  ColumnFamilyHandle* column_family,
+                                  const Slice& key,
+                                  PinnableWideColumns* columns,
+                                  std::string* timestamp);
+
+  // MultiGetImpl() behind the column family's OmniCache, if it has one that
+  // serves this read: cached keys are answered with one batched probe, only
+  // the misses take the LSM path, and their results are filled in together.
+  Status MultiGetImplWithOmniCache(
+      const ReadOptions& read_options, size_t start_key, size_t num_keys,
+      autovector<KeyContext*, MultiGetContext::MAX_BATCH_SIZE>* sorted_keys,
+      SuperVersion* sv, SequenceNumber snap_seqnum, ReadCallback* callback);
+
   void MultiGetWithCallbackImpl(
       const ReadOptions& read_options, ColumnFamilyHandle* column_family,
       ReadCallback* callback,
@@ -2597,6 +2674,15 @@ class DBImpl : public DB {
 
   SnapshotList snapshots_;
 
+  // Live snapshots, snapshots being taken and other holds, see
+  // BeginOmniCacheWriteBack().
+  std::atomic<uint64_t> oc_write_back_holds_{0};
+  // Puts between BeginOmniCacheWriteBack() and EndOmniCacheWriteBack().
+  std::atomic<uint64_t> oc_write_backs_in_flight_{0};
+  // Lets one snapshot or reader at a time write the dirty entries out; the
+  // others wait for it, as they must see those entries too.
+  std::mutex oc_snapshot_fence_mu_;
+
   TimestampedSnapshotList timestamped_snapshots_;
 
   // For each background job, pending_outputs_ keeps the current file number at
@@ -1612,6 +1612,7 @@ Status DBImpl::CompactFilesImpl(
     InstallSuperVersionAndScheduleWork(
         c->column_family_data(), job_context->superversion_contexts.data(),
         *c->mutable_cf_options());
+    compaction_job.InvalidateOmniCache();
   }
   // status above captures any error during compaction_job.Install, so its ok
   // not check compaction_job.io_status() explicitly if we're not calling
@@ -3899,6 +3900,7 @@ Status DBImpl::BackgroundCompaction(bool* made_progress,
       InstallSuperVersionAndScheduleWork(
           c->column_family_data(), job_context->superversion_contexts.data(),
           *c->mutable_cf_options());
+      compaction_job.InvalidateOmniCache();
     }
     *made_progress = true;
     TEST_SYNC_POINT_CALLBACK("DBImpl::BackgroundCompaction:AfterCompaction",
@@ -6,11 +6,13 @@
 // Copyright (c) 2011 The LevelDB Authors. All rights reserved.
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
+#include <algorithm>
 #include <cinttypes>
 
 #include "db/builder.h"
 #include "db/db_impl/db_impl.h"
 #include "db/error_handler.h"
+#include "db/omnicache_log.h"
 #include "db/periodic_task_scheduler.h"
 #include "env/composite_env_wrapper.h"
 #include "file/filename.h"
@@ -909,6 +911,107 @@ Status DBImpl::PersistentStatsProcessFormatVersion() {
   return s;
 }
 
+Status DBImpl::RecoverOmniCacheLogs(const WriteOptions& write_options) {
+  std::vector<std::string> files;
+  IOOptions io_opts;
+  io_opts.do_not_recurse = true;
+  Status s = fs_->GetChildren(dbname_, io_opts, &files, nullptr);
+  if (!s.ok()) {
+    return s;
+  }
+  std::map<uint32_t, std::vector<uint64_t>> logs;
+  for (const auto& fname : files) {
+    uint32_t cf_id;
+    uint64_t number;
+    if (OmniCacheLog::ParseFileName(fname, &cf_id, &number)) {
+      logs[cf_id].push_back(number);
+    }
+  }
+  for (auto& [cf_id, numbers] : logs) {
+    std::sort(numbers.begin(), numbers.end());
+    ColumnFamilyData* cfd;
+    {
+      InstrumentedMutexLock l(&mutex_);
+      cfd = versions_->GetColumnFamilySet()->GetColumnFamily(cf_id);
+    }
+    if (cfd != nullptr && !cfd->IsDropped()) {
+      // Latest logged value and its sequence number, per key.
+      std::map<std::string, std::pair<SequenceNumber, std::string>> entries;
+      for (uint64_t number : numbers) {
+        s = OmniCacheLog::ReadFile(
+            fs_.get(), OmniCacheLog::FileName(dbname_, cf_id, number),
+            [&entries](const Slice& key, const Slice& value,
+                       SequenceNumber seq) {
+              entries[key.ToString()] = std::make_pair(seq, value.ToString());
+            });
+        if (!s.ok()) {
+          return s;
+        }
+      }
+      std::string ts;
+      const bool has_ts = cfd->user_comparator()->timestamp_size() > 0;
+      SuperVersion* sv = GetAndRefSuperVersion(cfd);
+      WriteBatch batch;
+      for (const auto& [key, entry] : entries) {
+        SequenceNumber seq = kMaxSequenceNumber;
+        bool found = false;
+        bool is_blob_index = false;
+        s = GetLatestSequenceForKey(sv, key, false /* cache_only */,
+                                    0 /* lower_bound_seq */, &seq,
+                                    has_ts ? &ts : nullptr, &found,
+                                    &is_blob_index);
+        if (!s.ok() && !s.IsNotFound()) {
+          break;
+        }
+        s = Status::OK();
+        // A write that made it into the LSM after the logged one wins.
+        if (!found || seq <= entry.first) {
+          s = WriteBatchInternal::Put(&batch, cf_id, key, entry.second);
+          if (!s.ok()) {
+            break;
+          }
+        }
+      }
+      ReturnAndCleanupSuperVersion(cfd, sv);
+      if (s.ok() && batch.Count() > 0) {
+        WriteOptions wo = write_options;
+        wo.sync = true;
+        s = Write(wo, &batch);
+      }
+      if (!s.ok()) {
+        return s;
+      }
+      ROCKS_LOG_INFO(immutable_db_options_.info_log,
+                     "Recovered %" PRIu32
+                     " OmniCache write-back entries of column family %" PRIu32,
+                     batch.Count(), cf_id);
+    }
+    for (uint64_t number : numbers) {
+      s = fs_->DeleteFile(OmniCacheLog::FileName(dbname_, cf_id, number),
+                          IOOptions(), nullptr);
+      if (!s.ok()) {
+        return s;
+      }
+    }
+  }
+  return s;
+}
+
+void DBImpl::StartOmniCacheWarmUp() {
+  autovector<ColumnFamilyData*> cfds;
+  {
+    InstrumentedMutexLock l(&mutex_);
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (cfd->oc_ != nullptr && !cfd->IsDropped()) {
+        cfds.push_back(cfd);
+      }
+    }
+  }
+  for (ColumnFamilyData* cfd : cfds) {
+    cfd->oc_->StartWarmUp(this, cfd);
+  }
+}
+
 Status DBImpl::InitPersistStatsColumnFamily() {
   mutex_.AssertHeld();
   assert(!persist_stats_cf_handle_);
@@ -1943,8 +2046,6 @@ IOStatus DBImpl::CreateWAL(const WriteOptions& write_options,
   return io_s;
 }
 
-DB *pDBImpl = nullptr;
-
 Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
                     const std::vector<ColumnFamilyDescriptor>& column_families,
                     std::vector<ColumnFamilyHandle*>* handles, DB** dbptr,
@@ -1989,7 +2090,6 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
   }
 
   DBImpl* impl = new DBImpl(db_options, dbname, seq_per_batch, batch_per_txn);
-  pDBImpl = impl;
   if (!impl->immutable_db_options_.info_log) {
     s = impl->init_logger_creation_s_;
     delete impl;
@@ -2139,6 +2239,9 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
     for (auto cfd : *impl->versions_->GetColumnFamilySet()) {
       impl->InstallSuperVersionAndScheduleWork(
           cfd, &sv_context, *cfd->GetLatestMutableCFOptions());
+      if (cfd->oc_ != nullptr) {
+        cfd->oc_->SetWriteBack(impl, cfd->GetID());
+      }
     }
     sv_context.Clean();
   }
@@ -2269,6 +2372,10 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
   }
 
 
+  if (s.ok()) {
+    // Put hits logged by OmniCache but not yet written back before a crash.
+    s = impl->RecoverOmniCacheLogs(write_options);
+  }
   if (s.ok()) {
     ROCKS_LOG_HEADER(impl->immutable_db_options_.info_log, "DB pointer %p",
                      impl);
@@ -2304,6 +2411,10 @@ Status DBImpl::Open(const DBOptions& db_options, const std::string& dbname,
     s = impl->RegisterRecordSeqnoTimeWorker(read_options, write_options,
                                             recovery_ctx.is_new_db_);
   }
+  if (s.ok()) {
+    // The warm-up reads through the DB, so only once it is fully open.
+    impl->StartOmniCacheWarmUp();
+  }
   impl->options_mutex_.Unlock();
   if (!s.ok()) {
     for (auto* h : *handles) {
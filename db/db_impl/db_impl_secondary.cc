@@ -13,6 +13,7 @@
 #include "logging/logging.h"
 #include "monitoring/perf_context_imp.h"
 #include "rocksdb/configurable.h"
+#include "rocksdb/omnicache.h"
 #include "util/cast_util.h"
 #include "util/write_batch_util.h"
 
@@ -674,12 +675,22 @@ Status DBImplSecondary::TryCatchUpWithPrimary() {
   Status s;
   // read the manifest and apply new changes to the secondary instance
   std::unordered_set<ColumnFamilyData*> cfds_changed;
+  // Key spans the MANIFEST changed behind the OmniCache write hooks, which
+  // only the WAL replay goes through.
+  std::vector<CatchUpCacheChange> oc_changes;
   JobContext job_context(0, true /*create_superversion*/);
   {
     InstrumentedMutexLock lock_guard(&mutex_);
+    // Data up to here was visible to reads, and went through the write hooks
+    // when its WAL was replayed. Flushed files that hold nothing newer need
+    // no invalidation.
+    const SequenceNumber oc_seen_seq =
+        oc_wal_gap_ ? 0 : versions_->LastSequence();
+    bool oc_wal_purged = false;
     s = static_cast_with_check<ReactiveVersionSet>(versions_.get())
             ->ReadAndApply(&mutex_, &manifest_reader_,
-                           manifest_reader_status_.get(), &cfds_changed);
+                           manifest_reader_status_.get(), &cfds_changed,
+                           &oc_changes);
 
     ROCKS_LOG_INFO(immutable_db_options_.info_log, "Last sequence is %" PRIu64,
                    static_cast<uint64_t>(versions_->LastSequence()));
@@ -705,6 +716,9 @@ Status DBImplSecondary::TryCatchUpWithPrimary() {
           immutable_db_options_.info_log,
           "Secondary tries to read WAL, but WAL file(s) have already "
           "been purged by primary.");
+      // Their data reaches the secondary as flushed files, maybe only in a
+      // later catch-up.
+      oc_wal_purged = true;
       s = Status::OK();
     }
     if (s.ok()) {
@@ -715,6 +729,20 @@ Status DBImplSecondary::TryCatchUpWithPrimary() {
         cfd->InstallSuperVersion(&sv_context, &mutex_);
         sv_context.NewSuperVersion();
       }
+      // Changes without a sequence number of their own fence fills off until
+      // the next catch-up that brings a write, reads up to now may have seen
+      // the old data.
+      const SequenceNumber last_seq = versions_->LastSequence();
+      for (const auto& change : oc_changes) {
+        if (change.cfd->IsDropped() || change.largest_seqno <= oc_seen_seq) {
+          continue;
+        }
+        change.cfd->oc_->InvalidateRange(
+            change.smallest, change.largest,
+            change.largest_seqno == kMaxSequenceNumber ? last_seq + 1
+                                                       : last_seq);
+      }
+      oc_wal_gap_ = oc_wal_purged;
     }
   }
   job_context.Clean();
@@ -315,6 +315,11 @@ class DBImplSecondary : public DBImpl {
   // Current WAL number replayed for each column family.
   std::unordered_map<ColumnFamilyData*, uint64_t> cfd_to_current_log_;
 
+  // The last catch-up could not read WALs the primary had already purged, so
+  // the last sequence may cover data OmniCache never saw, see
+  // TryCatchUpWithPrimary().
+  bool oc_wal_gap_ = false;
+
   const std::string secondary_path_;
 };
 
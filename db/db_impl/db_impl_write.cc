@@ -2405,19 +2405,38 @@ Status DB::Put_OC_Delete_(const WriteOptions& opt,
 // can call if they wish
 Status DB::Put(const WriteOptions& opt, ColumnFamilyHandle* column_family,
                const Slice& key, const Slice& value) {
-  if (OmniCache::Enabled()) {
-    auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
-    auto& oc = cfh->cfd()->oc_;
+  auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
+  // Column families with user-defined timestamps need the Put overload that
+  // takes one; let the batch reject this call. A Merge, or a Put through an
+  // inplace_callback, builds on the memtable's value and would not see one
+  // held back in the cache: such column families write through.
+  const ImmutableOptions& ioptions = *cfh->cfd()->ioptions();
+  OmniCache* oc = cfh->GetComparator()->timestamp_size() == 0 &&
+                          ioptions.merge_operator == nullptr &&
+                          (!ioptions.inplace_update_support ||
+                           ioptions.inplace_callback == nullptr)
+                      ? cfh->cfd()->oc_
+                      : nullptr;
+  DBImpl* db = cfh->db();
+  if (oc != nullptr && db->BeginOmniCacheWriteBack()) {
+    Status s = Status::Incomplete();
     try {
-      //              oc->Insert(key, value); //Update value
-      auto p = oc->Seek(key);
-      if (p->Valid() && p->Key() == key) {
-        p->Value() = value.ToString();
-        return Status::OK();
+      auto p = oc->Seek(key, kMaxSequenceNumber);
+      if (p->Valid()) {
+        // The write-back value has no sequence number of its own. Nothing
+        // holds write-backs off, so it is visible to exactly the snapshots
+        // and iterators taken from now on, which write it back first.
+        s = oc->WriteBack(opt, p.get(), value, GetLatestSequenceNumber());
       }
     } catch (const std::exception& e) {
-      return Status::IOError("Exception during OC check in Put");
+      s = Status::IOError("Exception during OC check in Put");
+    }
+    db->EndOmniCacheWriteBack();
+    if (!s.IsIncomplete()) {
+      return s;
     }
+    // The key is not cached, or the entry went away: write the value
+    // through.
   }
 
   // Pre-allocate size of write batch conservatively.
@@ -23,11 +23,11 @@
 #include "logging/logging.h"
 #include "memory/arena.h"
 #include "monitoring/perf_context_imp.h"
+#include "monitoring/perf_counter.h"
 #include "rocksdb/env.h"
 #include "rocksdb/iterator.h"
 #include "rocksdb/merge_operator.h"
 #include "rocksdb/options.h"
-#include "rocksdb/perf_data_client.h"
 #include "rocksdb/system_clock.h"
 #include "table/internal_iterator.h"
 #include "table/iterator_wrapper.h"
@@ -55,6 +55,9 @@ DBIter::DBIter(Env* _env, const ReadOptions& read_options,
       user_comparator_(cmp),
       merge_operator_(ioptions.merge_operator.get()),
       iter_(iter),
+      oc_fills_left_(mutable_cf_options.omnicache_max_iterator_fills > 0
+                         ? mutable_cf_options.omnicache_max_iterator_fills
+                         : std::numeric_limits<uint64_t>::max()),
       version_(version),
       read_callback_(read_callback),
       sequence_(s),
@@ -87,6 +90,12 @@ DBIter::DBIter(Env* _env, const ReadOptions& read_options,
       timestamp_lb_(read_options.iter_start_ts),
       timestamp_size_(timestamp_ub_ ? timestamp_ub_->size() : 0) {
   RecordTick(statistics_, NO_ITERATOR_CREATED);
+  // Reads that may not look everywhere, or that ignore range tombstones,
+  // do not fill the OmniCache.
+  if (read_options.read_tier != kReadAllTier ||
+      read_options.ignore_range_deletions) {
+    oc_fills_left_ = 0;
+  }
   if (pin_thru_lifetime_) {
     pinned_iters_mgr_.StartPinning();
   }
@@ -134,43 +143,110 @@ bool DBIter::ParseKey(ParsedInternalKey* ikey) {
   }
 }
 
+bool DBIter::OmniCacheHitInRange(const Slice& user_key) const {
+  if (iterate_upper_bound_ != nullptr &&
+      user_comparator_.CompareWithoutTimestamp(
+          user_key, /*a_has_ts=*/true, *iterate_upper_bound_,
+          /*b_has_ts=*/false) >= 0) {
+    return false;
+  }
+  if (iterate_lower_bound_ != nullptr &&
+      user_comparator_.CompareWithoutTimestamp(
+          user_key, /*a_has_ts=*/true, *iterate_lower_bound_,
+          /*b_has_ts=*/false) < 0) {
+    return false;
+  }
+  if (prefix_same_as_start_ &&
+      prefix_extractor_->Transform(
+          StripTimestampFromUserKey(user_key, timestamp_size_)) !=
+          prefix_.GetUserKey()) {
+    return false;
+  }
+  return true;
+}
+
+void DBIter::SetOmniCacheHit(Direction direction) {
+  status_ = Status::OK();
+  direction_ = direction;
+  // The inner iterator stays where it was.
+  match_ = false;
+  const FollyKV& data = cache_iter_->Data();
+  if (!OmniCacheHitInRange(data.Key())) {
+    valid_ = false;
+    return;
+  }
+  valid_ = true;
+  // One buffer for the value, its kind and its version, the one the
+  // positioning call checked. It outlives the node, see PauseOmniCache();
+  // the key is copied.
+  cache_value_ = cache_iter_->Current().Hold();
+  const FollyValue& current = *cache_value_;
+  if (timestamp_size_ == 0) {
+    saved_key_.SetUserKey(data.Key(), true /* copy */);
+  } else {
+    // The node's key has the timestamp of the version it was added for.
+    std::string key =
+        StripTimestampFromUserKey(data.Key(), timestamp_size_).ToString();
+    const Slice ts = current.Timestamp();
+    key.append(ts.data(), ts.size());
+    saved_key_.SetUserKey(key, true /* copy */);
+  }
+  // Columns point into the cached entry, like a pinned block.
+  ResetValueAndColumns();
+  if (current.Entity()) {
+    SetValueAndColumnsFromEntity(current.Value());
+  } else {
+    SetValueAndColumnsFromPlain(current.Value());
+  }
+}
+
+void DBIter::PauseOmniCache() {
+  if (cache_iter_ != nullptr) {
+    cache_iter_->Pause();
+  }
+  if (cache_iter_ == nullptr || match_) {
+    // Not on a cache hit.
+    cache_value_.reset();
+  }
+}
+
 void DBIter::Next() {
   static PERFCOUNTER_DEF("/oc/dbiter/", next_all);
-  static PERFCOUNTER_DEF("/oc/dbiter/", next_hit);
-  static PERFCOUNTER_DEF("/oc/dbiter/", next_miss);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", next_hit,
+                              OMNICACHE_ITER_NEXT_HIT);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", next_miss,
+                              OMNICACHE_ITER_NEXT_MISS);
 
-  if (OmniCache::Enabled()) {
+  OmniCache* oc = omnicache();
+  if (oc != nullptr && cache_iter_ != nullptr) {
     PERFCOUNTER_INC(next_all);
-    auto oc = cfh_->cfd()->oc_;
 
     cache_iter_->Next();
     if (cache_iter_->Valid()) {
-      PERFCOUNTER_INC(next_hit);
+      PERFCOUNTER_INC_STAT(next_hit, statistics_);
       // OC Hit: return
-      valid_ = true;
-      value_ = cache_iter_->Value();
-      saved_key_.SetUserKey(cache_iter_->Key(), false);
-      direction_ = kForward;
-      status_ = Status::OK();
-      match_ = false;
+      SetOmniCacheHit(kForward);
     } else {
-      PERFCOUNTER_INC(next_miss);
+      PERFCOUNTER_INC_STAT(next_miss, statistics_);
       // OC Miss:
       // TODO: In fact, we don't need seek
       //     just store a underlying iterator in each EA
       // refill
+      std::string prev_key = saved_key_.GetUserKey().ToString();
       if (!match_) {
-        Seek_(saved_key_.GetUserKey());
+        Seek_(StripTimestampFromUserKey(prev_key, timestamp_size_));
       }
       Next_();
-      if (Valid()) {
-        cache_iter_ = oc->Append(saved_key_.GetUserKey(), value());
+      if (Valid() && TakeOmniCacheFill()) {
+        cache_iter_ = oc->Append(prev_key, saved_key_.GetUserKey(),
+                                 wide_columns_, sequence_);
       }
       match_ = true;
     }
   } else {
     Next_();
   }
+  PauseOmniCache();
 }
 
 void DBIter::Next_() {
@@ -700,6 +776,44 @@ bool DBIter::MergeValuesNewToOld() {
 }
 
 void DBIter::Prev() {
+  static PERFCOUNTER_DEF("/oc/dbiter/", prev_all);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", prev_hit,
+                              OMNICACHE_ITER_NEXT_HIT);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", prev_miss,
+                              OMNICACHE_ITER_NEXT_MISS);
+
+  OmniCache* oc = reverse_omnicache();
+  if (oc != nullptr && cache_iter_ != nullptr) {
+    PERFCOUNTER_INC(prev_all);
+
+    cache_iter_->Prev();
+    if (cache_iter_->Valid()) {
+      PERFCOUNTER_INC_STAT(prev_hit, statistics_);
+      SetOmniCacheHit(kReverse);
+    } else {
+      PERFCOUNTER_INC_STAT(prev_miss, statistics_);
+      // Put the inner iterator back on the current key, step back and
+      // extend the range we came from.
+      std::string next_key = saved_key_.GetUserKey().ToString();
+      if (!match_) {
+        SeekForPrev_(StripTimestampFromUserKey(next_key, timestamp_size_));
+      }
+      Prev_();
+      if (Valid() && TakeOmniCacheFill()) {
+        cache_iter_ = oc->Prepend(next_key, saved_key_.GetUserKey(),
+                                  wide_columns_, sequence_);
+      }
+      match_ = true;
+    }
+  } else {
+    // The cache position no longer follows the inner iterator.
+    cache_iter_.reset();
+    Prev_();
+  }
+  PauseOmniCache();
+}
+
+void DBIter::Prev_() {
   assert(valid_);
   assert(status_.ok());
 
@@ -1497,39 +1611,65 @@ void DBIter::SetSavedKeyToSeekForPrevTarget(const Slice& target) {
 
 void DBIter::Seek(const Slice& target) {
   static PERFCOUNTER_DEF("/oc/dbiter/", seek_all);
-  static PERFCOUNTER_DEF("/oc/dbiter/", seek_hit);
-  static PERFCOUNTER_DEF("/oc/dbiter/", seek_miss);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_hit,
+                              OMNICACHE_ITER_SEEK_HIT);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_miss,
+                              OMNICACHE_ITER_SEEK_MISS);
 
-  if (OmniCache::Enabled()) {
+  OmniCache* oc = omnicache();
+  if (oc != nullptr) {
     PERFCOUNTER_INC(seek_all);
-    auto oc = cfh_->cfd()->oc_;
 
     if (cache_iter_ == nullptr) {
       // TODO: Move to constructor
-      cache_iter_ = oc->NewIterator();
+      cache_iter_ = oc->NewIterator(sequence_);
     }
-    cache_iter_->Seek(target);
+    cache_iter_->SetReadSequence(sequence_);
+    if (prefix_same_as_start_) {
+      prefix_.SetUserKey(prefix_extractor_->Transform(target));
+    }
+    if (!expect_total_order_inner_iter()) {
+      oc_seek_prefix_.SetUserKey(prefix_extractor_->Transform(target));
+    }
+    const Slice seek_key =
+        iterate_lower_bound_ != nullptr &&
+                user_comparator_.CompareWithoutTimestamp(
+                    target, /*a_has_ts=*/false, *iterate_lower_bound_,
+                    /*b_has_ts=*/false) < 0
+            ? *iterate_lower_bound_
+            : target;
+    // Also a hit if seek_key falls into a known gap.
+    cache_iter_->LowerBound(seek_key);
 
-    if (cache_iter_->Valid() &&
-        user_comparator_.Compare(cache_iter_->Key(), target) == 0) {
-      PERFCOUNTER_INC(seek_hit);
+    if (cache_iter_->Valid()) {
+      PERFCOUNTER_INC_STAT(seek_hit, statistics_);
       // OC Hit: setup cache_iter_ & return value
-      status_ = Status::OK();
-      valid_ = true;
-      SetSavedKeyToSeekTarget(target);
-      direction_ = kForward;
-      value_ = cache_iter_->Value();
-      match_ = false;
+      SetOmniCacheHit(kForward);
     } else {
-      PERFCOUNTER_INC(seek_miss);
+      PERFCOUNTER_INC_STAT(seek_miss, statistics_);
       // OC Miss: Seek_ & Insert
       Seek_(target);
-      cache_iter_ = oc->Insert(saved_key_.GetUserKey(), value());
+      if (Valid() && TakeOmniCacheFill()) {
+        if (expect_total_order_inner_iter() &&
+            user_comparator_.CompareWithoutTimestamp(
+                saved_key_.GetUserKey(), /*a_has_ts=*/true, seek_key,
+                /*b_has_ts=*/false) > 0) {
+          // Nothing lies in [seek_key, key): a negative entry for seek_key
+          // owns that gap, so the next Seek into it is a hit.
+          oc->InsertAbsent(seek_key, sequence_);
+          cache_iter_ = oc->Append(seek_key, saved_key_.GetUserKey(),
+                                   wide_columns_, sequence_);
+        } else {
+          cache_iter_ =
+              oc->Insert(saved_key_.GetUserKey(), wide_columns_, sequence_);
+        }
+      }
       match_ = true;
     }
   } else {
     Seek_(target);
   }
+  PauseOmniCache();
 }
 
 void DBIter::Seek_(const Slice& target) {
@@ -1609,6 +1749,73 @@ void DBIter::Seek_(const Slice& target) {
 }
 
 void DBIter::SeekForPrev(const Slice& target) {
+  static PERFCOUNTER_DEF("/oc/dbiter/", seek_for_prev_all);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_for_prev_hit,
+                              OMNICACHE_ITER_SEEK_HIT);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_for_prev_miss,
+                              OMNICACHE_ITER_SEEK_MISS);
+
+  OmniCache* oc = reverse_omnicache();
+  if (oc != nullptr) {
+    PERFCOUNTER_INC(seek_for_prev_all);
+
+    if (cache_iter_ == nullptr) {
+      cache_iter_ = oc->NewIterator(sequence_);
+    }
+    cache_iter_->SetReadSequence(sequence_);
+    if (prefix_same_as_start_) {
+      prefix_.SetUserKey(prefix_extractor_->Transform(target));
+    }
+    const bool clamped =
+        iterate_upper_bound_ != nullptr &&
+        user_comparator_.CompareWithoutTimestamp(
+            target, /*a_has_ts=*/false, *iterate_upper_bound_,
+            /*b_has_ts=*/false) >= 0;
+    if (clamped) {
+      // The last key before the bound, which itself is excluded.
+      cache_iter_->SeekForPrev(*iterate_upper_bound_);
+      if (cache_iter_->Valid() &&
+          user_comparator_.CompareWithoutTimestamp(
+              cache_iter_->Key(), /*a_has_ts=*/true, *iterate_upper_bound_,
+              /*b_has_ts=*/false) == 0) {
+        cache_iter_->Prev();
+      }
+    } else {
+      cache_iter_->SeekForPrev(target);
+    }
+
+    if (cache_iter_->Valid()) {
+      PERFCOUNTER_INC_STAT(seek_for_prev_hit, statistics_);
+      SetOmniCacheHit(kReverse);
+    } else {
+      PERFCOUNTER_INC_STAT(seek_for_prev_miss, statistics_);
+      // Only (key, target] is known empty, not the gap after the key. A
+      // negative entry for target records it; below an upper bound, target
+      // was not read.
+      SeekForPrev_(target);
+      if (Valid() && TakeOmniCacheFill()) {
+        if (!clamped &&
+            user_comparator_.CompareWithoutTimestamp(
+                saved_key_.GetUserKey(), /*a_has_ts=*/true, target,
+                /*b_has_ts=*/false) < 0) {
+          oc->InsertAbsent(target, sequence_);
+          cache_iter_ = oc->Prepend(target, saved_key_.GetUserKey(),
+                                    wide_columns_, sequence_);
+        } else {
+          cache_iter_ =
+              oc->Insert(saved_key_.GetUserKey(), wide_columns_, sequence_);
+        }
+      }
+      match_ = true;
+    }
+  } else {
+    cache_iter_.reset();
+    SeekForPrev_(target);
+  }
+  PauseOmniCache();
+}
+
+void DBIter::SeekForPrev_(const Slice& target) {
   PERF_COUNTER_ADD(iter_seek_count, 1);
   PERF_CPU_TIMER_GUARD(iter_seek_cpu_nanos, clock_);
   StopWatch sw(clock_, statistics_, DB_SEEK);
@@ -1679,6 +1886,49 @@ void DBIter::SeekForPrev(const Slice& target) {
 }
 
 void DBIter::SeekToFirst() {
+  static PERFCOUNTER_DEF("/oc/dbiter/", seek_to_first_all);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_to_first_hit,
+                              OMNICACHE_ITER_SEEK_HIT);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_to_first_miss,
+                              OMNICACHE_ITER_SEEK_MISS);
+
+  // With a lower bound, SeekToFirst_() goes through Seek(), which sets up
+  // its own cache position.
+  OmniCache* oc =
+      iterate_lower_bound_ == nullptr ? reverse_omnicache() : nullptr;
+  if (oc != nullptr) {
+    PERFCOUNTER_INC(seek_to_first_all);
+
+    if (cache_iter_ == nullptr) {
+      cache_iter_ = oc->NewIterator(sequence_);
+    }
+    cache_iter_->SetReadSequence(sequence_);
+    cache_iter_->SeekToFirst();
+
+    if (cache_iter_->Valid()) {
+      PERFCOUNTER_INC_STAT(seek_to_first_hit, statistics_);
+      if (prefix_same_as_start_) {
+        prefix_.SetUserKey(prefix_extractor_->Transform(
+            StripTimestampFromUserKey(cache_iter_->Key(), timestamp_size_)));
+      }
+      SetOmniCacheHit(kForward);
+    } else {
+      PERFCOUNTER_INC_STAT(seek_to_first_miss, statistics_);
+      SeekToFirst_();
+      if (Valid() && TakeOmniCacheFill()) {
+        cache_iter_ =
+            oc->InsertFirst(saved_key_.GetUserKey(), wide_columns_, sequence_);
+      }
+      match_ = true;
+    }
+  } else {
+    cache_iter_.reset();
+    SeekToFirst_();
+  }
+  PauseOmniCache();
+}
+
+void DBIter::SeekToFirst_() {
   if (iterate_lower_bound_ != nullptr) {
     Seek(*iterate_lower_bound_);
     return;
@@ -1731,6 +1981,48 @@ void DBIter::SeekToFirst() {
 }
 
 void DBIter::SeekToLast() {
+  static PERFCOUNTER_DEF("/oc/dbiter/", seek_to_last_all);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_to_last_hit,
+                              OMNICACHE_ITER_SEEK_HIT);
+  static PERFCOUNTER_DEF_STAT("/oc/dbiter/", seek_to_last_miss,
+                              OMNICACHE_ITER_SEEK_MISS);
+
+  // With an upper bound, SeekToLast_() goes through SeekForPrev().
+  OmniCache* oc =
+      iterate_upper_bound_ == nullptr ? reverse_omnicache() : nullptr;
+  if (oc != nullptr) {
+    PERFCOUNTER_INC(seek_to_last_all);
+
+    if (cache_iter_ == nullptr) {
+      cache_iter_ = oc->NewIterator(sequence_);
+    }
+    cache_iter_->SetReadSequence(sequence_);
+    cache_iter_->SeekToLast();
+
+    if (cache_iter_->Valid()) {
+      PERFCOUNTER_INC_STAT(seek_to_last_hit, statistics_);
+      if (prefix_same_as_start_) {
+        prefix_.SetUserKey(prefix_extractor_->Transform(
+            StripTimestampFromUserKey(cache_iter_->Key(), timestamp_size_)));
+      }
+      SetOmniCacheHit(kReverse);
+    } else {
+      PERFCOUNTER_INC_STAT(seek_to_last_miss, statistics_);
+      SeekToLast_();
+      if (Valid() && TakeOmniCacheFill()) {
+        cache_iter_ =
+            oc->InsertLast(saved_key_.GetUserKey(), wide_columns_, sequence_);
+      }
+      match_ = true;
+    }
+  } else {
+    cache_iter_.reset();
+    SeekToLast_();
+  }
+  PauseOmniCache();
+}
+
+void DBIter::SeekToLast_() {
   if (iterate_upper_bound_ != nullptr) {
     // Seek to last key strictly less than ReadOptions.iterate_upper_bound.
     SeekForPrev(*iterate_upper_bound_);
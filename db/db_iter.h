@@ -204,13 +204,17 @@ class DBIter final : public Iterator {
   void Next() final override;
   void Next_();
   void Prev() final override;
+  void Prev_();
   // 'target' does not contain timestamp, even if user timestamp feature is
   // enabled.
   void Seek(const Slice& target) final override;
   void Seek_(const Slice& target);
   void SeekForPrev(const Slice& target) final override;
+  void SeekForPrev_(const Slice& target);
   void SeekToFirst() final override;
+  void SeekToFirst_();
   void SeekToLast() final override;
+  void SeekToLast_();
   Env* env() const { return env_; }
   void set_sequence(uint64_t s) {
     sequence_ = s;
@@ -352,6 +356,60 @@ class DBIter final : public Iterator {
     return true;
   }
 
+  // nullptr unless this column family has an OmniCache that can serve this
+  // iterator: the cache holds the latest version of each key only. A read
+  // callback (a transaction's own or prepared writes) decides visibility by
+  // more than the sequence number, which the cache cannot follow.
+  OmniCache* omnicache() const {
+    OmniCache* oc = cfh_ != nullptr ? cfh_->cfd()->oc_ : nullptr;
+    if (oc == nullptr || timestamp_lb_ != nullptr ||
+        read_callback_ != nullptr || !oc->ServesReadsAt(timestamp_ub_)) {
+      return nullptr;
+    }
+    return oc;
+  }
+
+  // Counts a fill of the current key against oc_fills_left_. Once none are
+  // left, misses are not cached. A prefix seek (see
+  // expect_total_order_inner_iter()) only reads the keys of the seek prefix
+  // reliably, so other keys are not cached either.
+  bool TakeOmniCacheFill() {
+    if (oc_fills_left_ == 0) {
+      return false;
+    }
+    if (!expect_total_order_inner_iter_ &&
+        prefix_extractor_->Transform(StripTimestampFromUserKey(
+            saved_key_.GetUserKey(), timestamp_size_)) !=
+            oc_seek_prefix_.GetUserKey()) {
+      return false;
+    }
+    --oc_fills_left_;
+    return true;
+  }
+
+  // Same, for Prev(), SeekForPrev(), SeekToFirst() and SeekToLast(), which
+  // a prefix seek does not support.
+  OmniCache* reverse_omnicache() const {
+    if (!expect_total_order_inner_iter_) {
+      return nullptr;
+    }
+    return omnicache();
+  }
+
+  // Whether `user_key` (with timestamp, if any), a cache hit, lies within
+  // the iterate bounds and, with prefix_same_as_start, within prefix_. The
+  // cache knows there is nothing between the hit and the previous key, so
+  // a hit outside ends the iteration just like the LSM would.
+  bool OmniCacheHitInRange(const Slice& user_key) const;
+  // Positions the iterator on the cache hit at cache_iter_ if it is in
+  // range, invalidates it otherwise.
+  void SetOmniCacheHit(Direction direction);
+  // At the end of every positioning call: between calls the cache position
+  // is only a key and the hit's buffer in cache_value_, so a long-lived
+  // iterator does not keep the cache's removed nodes and retired values
+  // from being reclaimed.
+  void PauseOmniCache();
+
   const SliceTransform* prefix_extractor_;
   Env* const env_;
   SystemClock* clock_;
@@ -360,7 +418,14 @@ class DBIter final : public Iterator {
   const MergeOperator* const merge_operator_;
   IteratorWrapper iter_;
   std::unique_ptr<OmniCache::OmniCacheIterator> cache_iter_;
+  // The buffer value() points into while on a cache hit.
+  FollyValueHandle cache_value_;
   bool match_ = true;
+  // Fills this iterator may still make, see
+  // ColumnFamilyOptions::omnicache_max_iterator_fills.
+  uint64_t oc_fills_left_;
+  // Prefix of the last Seek() target, for a prefix seek only.
+  IterKey oc_seek_prefix_;
   const Version* version_;
   ReadCallback* read_callback_;
   // Max visible sequence number. It is normally the snapshot seq unless we have
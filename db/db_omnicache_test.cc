@@ -0,0 +1,590 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include "db/db_test_util.h"
+#include "port/stack_trace.h"
+#include "rocksdb/convenience.h"
+#include "rocksdb/omnicache.h"
+#include "rocksdb/sst_file_writer.h"
+#include "util/cast_util.h"
+#include "utilities/merge_operators.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// OmniCache through the DB API: every result must match what the LSM alone
+// would return.
+class DBOmniCacheTest : public DBTestBase {
+ public:
+  DBOmniCacheTest() : DBTestBase("db_omnicache_test", /*env_do_fsync=*/false) {}
+
+  Options OmniCacheOptions() {
+    Options options = CurrentOptions();
+    options.create_if_missing = true;
+    options.omnicache_capacity = 1 << 20;
+    return options;
+  }
+
+  // "key=value" for every entry of a full scan of `db`, in iteration order.
+  std::vector<std::string> Scan(DB* db, const ReadOptions& read_options,
+                                bool reverse = false) {
+    std::vector<std::string> entries;
+    std::unique_ptr<Iterator> iter(db->NewIterator(read_options));
+    if (reverse) {
+      iter->SeekToLast();
+    } else {
+      iter->SeekToFirst();
+    }
+    for (; iter->Valid(); reverse ? iter->Prev() : iter->Next()) {
+      entries.push_back(iter->key().ToString() + "=" +
+                        iter->value().ToString());
+    }
+    EXPECT_OK(iter->status());
+    return entries;
+  }
+
+  // Same as Get(), against `db`.
+  std::string GetFrom(DB* db, const std::string& key) {
+    std::string value;
+    Status s = db->Get(ReadOptions(), key, &value);
+    if (s.IsNotFound()) {
+      return "NOT_FOUND";
+    }
+    return s.ok() ? value : s.ToString();
+  }
+
+  OmniCache* GetOmniCache() {
+    return static_cast_with_check<ColumnFamilyHandleImpl>(
+               db_->DefaultColumnFamily())
+        ->cfd()
+        ->oc_;
+  }
+};
+
+TEST_F(DBOmniCacheTest, WriteBack) {
+  DestroyAndReopen(OmniCacheOptions());
+  ASSERT_OK(Put("k", "v1"));
+  // Fills the cache, the next Put is written back.
+  ASSERT_EQ("v1", Get("k"));
+  ASSERT_OK(Put("k", "v2"));
+  ASSERT_EQ("v2", Get("k"));
+
+  // Closing writes the dirty entry to the LSM.
+  Reopen(OmniCacheOptions());
+  ASSERT_EQ("v2", Get("k"));
+}
+
+TEST_F(DBOmniCacheTest, WriteBackAndSnapshots) {
+  DestroyAndReopen(OmniCacheOptions());
+  ASSERT_OK(Put("k", "v1"));
+  ASSERT_EQ("v1", Get("k"));
+  // No write since the snapshot: it shares the latest sequence number
+  // with the Put that hits the cache next.
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("k", "v2"));
+  ASSERT_EQ("v1", Get("k", snapshot));
+  ASSERT_EQ("v2", Get("k"));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Written back, then seen by a snapshot taken later.
+  ASSERT_OK(Put("k", "v3"));
+  snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("k", "v4"));
+  ASSERT_EQ("v3", Get("k", snapshot));
+  ASSERT_EQ("v4", Get("k"));
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST_F(DBOmniCacheTest, WriteBackAndIterators) {
+  DestroyAndReopen(OmniCacheOptions());
+  ASSERT_OK(Put("k", "v1"));
+  ASSERT_EQ("v1", Get("k"));
+  // The iterator pins the latest sequence number without a snapshot; a Put
+  // after it must not show up in it.
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  ASSERT_OK(Put("k", "v2"));
+  iter->Seek("k");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("v1", iter->value().ToString());
+  ASSERT_OK(iter->status());
+  ASSERT_EQ("v2", Get("k"));
+  iter.reset();
+
+  // Written back, then seen by an iterator created later.
+  ASSERT_OK(Put("k", "v3"));
+  iter.reset(db_->NewIterator(ReadOptions()));
+  ASSERT_OK(Put("k", "v4"));
+  iter->Seek("k");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("v3", iter->value().ToString());
+  ASSERT_OK(iter->status());
+  ASSERT_EQ("v4", Get("k"));
+}
+
+TEST_F(DBOmniCacheTest, MergeAfterPut) {
+  Options options = OmniCacheOptions();
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("k", "v1"));
+  ASSERT_EQ("v1", Get("k"));
+  // A cached key, but the Merge must build on this Put.
+  ASSERT_OK(Put("k", "v2"));
+  ASSERT_OK(Merge("k", "m"));
+  ASSERT_EQ("v2,m", Get("k"));
+
+  Reopen(options);
+  ASSERT_EQ("v2,m", Get("k"));
+}
+
+TEST_F(DBOmniCacheTest, ByteBudgetChargedToBlockCache) {
+  Options options = OmniCacheOptions();
+  options.omnicache_capacity = 256 << 10;
+  std::shared_ptr<Cache> block_cache = NewLRUCache(64 << 20);
+  BlockBasedTableOptions table_options;
+  table_options.block_cache = block_cache;
+  table_options.cache_usage_options.options_overrides.insert(
+      {CacheEntryRole::kOmniCache,
+       {/*.charged = */ CacheEntryRoleOptions::Decision::kEnabled}});
+  options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+  DestroyAndReopen(options);
+
+  // 1000 keys with 1 KB values: four times the capacity.
+  const std::string value(1024, 'v');
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_OK(Put(Key(i), value));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(value, Get(Key(i)));
+    // Fills above the hard limit are dropped, one entry may overshoot. Node
+    // memory kept for later fills comes on top, see IdleBytes().
+    ASSERT_LE(GetOmniCache()->follySkipList->ApproximateMemoryUsage(),
+              options.omnicache_capacity * 5 / 4 + 2 * value.size());
+  }
+  // The cache's usage is reserved in the block cache, which holds nothing
+  // else yet.
+  ASSERT_GT(block_cache->GetPinnedUsage(), 0u);
+}
+
+TEST_F(DBOmniCacheTest, ReverseScans) {
+  Options options = OmniCacheOptions();
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+  for (const char* key : {"a", "b", "c", "d", "e"}) {
+    ASSERT_OK(Put(key, std::string("v") + key));
+  }
+  const std::vector<std::string> forward = {"a=va", "b=vb", "c=vc", "d=vd",
+                                            "e=ve"};
+  const std::vector<std::string> backward(forward.rbegin(), forward.rend());
+  // Caches the whole range, then extends it to the end.
+  ASSERT_EQ(forward, Scan(db_, ReadOptions()));
+  ASSERT_EQ(backward, Scan(db_, ReadOptions(), true /* reverse */));
+
+  // Served from the cache, except for the step off the first key.
+  ASSERT_OK(options.statistics->Reset());
+  ASSERT_EQ(backward, Scan(db_, ReadOptions(), true /* reverse */));
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_ITER_SEEK_HIT), 1u);
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_ITER_NEXT_HIT), 4u);
+
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  iter->SeekForPrev("cc");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("c", iter->key());
+  ASSERT_EQ("vc", iter->value());
+  iter->Prev();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("b", iter->key());
+  // Change of direction on a cache hit.
+  iter->Next();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("c", iter->key());
+  iter.reset();
+
+  // A write between cached keys shows up in both directions.
+  ASSERT_OK(Put("bb", "vbb"));
+  ASSERT_OK(Delete("d"));
+  const std::vector<std::string> updated = {"a=va", "b=vb", "bb=vbb", "c=vc",
+                                            "e=ve"};
+  ASSERT_EQ(updated, Scan(db_, ReadOptions()));
+  ASSERT_EQ(std::vector<std::string>(updated.rbegin(), updated.rend()),
+            Scan(db_, ReadOptions(), true /* reverse */));
+}
+
+TEST_F(DBOmniCacheTest, MultiGet) {
+  Options options = OmniCacheOptions();
+  options.merge_operator = MergeOperators::CreateStringAppendOperator();
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("b", "vb"));
+  ASSERT_OK(Put("c", "vc"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(Put("d", "vd"));
+
+  // Some keys cached, some not, some absent.
+  ASSERT_EQ(std::vector<std::string>({"va", "vc", "NOT_FOUND"}),
+            MultiGet({"a", "c", "x"}));
+  ASSERT_EQ(std::vector<std::string>({"va", "vb", "vc", "vd", "NOT_FOUND"}),
+            MultiGet({"a", "b", "c", "d", "x"}));
+  // Unsorted, with a duplicate.
+  ASSERT_EQ(std::vector<std::string>({"vd", "va", "vd"}),
+            MultiGet({"d", "a", "d"}));
+
+  // Writes to cached keys are seen.
+  ASSERT_OK(Put("c", "vc2"));
+  ASSERT_OK(Delete("a"));
+  ASSERT_OK(Merge("b", "m"));
+  ASSERT_OK(Put("x", "vx"));
+  ASSERT_EQ(std::vector<std::string>({"NOT_FOUND", "vb,m", "vc2", "vx"}),
+            MultiGet({"a", "b", "c", "x"}));
+
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("c", "vc3"));
+  ASSERT_EQ(std::vector<std::string>({"vc2", "vx"}),
+            MultiGet({"c", "x"}, snapshot));
+  ASSERT_EQ(std::vector<std::string>({"vc3", "vx"}), MultiGet({"c", "x"}));
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST_F(DBOmniCacheTest, IterateBoundsAndPrefix) {
+  Options options = OmniCacheOptions();
+  options.statistics = CreateDBStatistics();
+  options.prefix_extractor.reset(NewFixedPrefixTransform(1));
+  DestroyAndReopen(options);
+  for (const char* key : {"a1", "a2", "b1", "b2", "c1"}) {
+    ASSERT_OK(Put(key, key));
+  }
+  ReadOptions total_order;
+  total_order.total_order_seek = true;
+  // One cached range over all keys.
+  ASSERT_EQ(std::vector<std::string>({"a1=a1", "a2=a2", "b1=b1", "b2=b2",
+                                      "c1=c1"}),
+            Scan(db_, total_order));
+
+  // The cache knows what follows each key; the bounds still apply.
+  ReadOptions bounded = total_order;
+  const Slice lower("a2");
+  const Slice upper("b2");
+  bounded.iterate_lower_bound = &lower;
+  bounded.iterate_upper_bound = &upper;
+  ASSERT_EQ(std::vector<std::string>({"a2=a2", "b1=b1"}),
+            Scan(db_, bounded));
+  ASSERT_EQ(std::vector<std::string>({"b1=b1", "a2=a2"}),
+            Scan(db_, bounded, true /* reverse */));
+  std::unique_ptr<Iterator> iter(db_->NewIterator(bounded));
+  iter->Seek("a");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("a2", iter->key());
+  iter->SeekForPrev("c");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("b1", iter->key());
+
+  ReadOptions same_prefix;
+  same_prefix.prefix_same_as_start = true;
+  iter.reset(db_->NewIterator(same_prefix));
+  std::vector<std::string> keys;
+  for (iter->Seek("a"); iter->Valid(); iter->Next()) {
+    keys.push_back(iter->key().ToString());
+  }
+  ASSERT_OK(iter->status());
+  ASSERT_EQ(std::vector<std::string>({"a1", "a2"}), keys);
+  iter.reset();
+
+  // A new key splits the cached range. A scan bounded at it stops there,
+  // a full one sees it.
+  ASSERT_OK(Put("b15", "b15"));
+  ReadOptions upper_only = total_order;
+  const Slice b15("b15");
+  upper_only.iterate_upper_bound = &b15;
+  ASSERT_EQ(std::vector<std::string>({"a1=a1", "a2=a2", "b1=b1"}),
+            Scan(db_, upper_only));
+  ASSERT_OK(options.statistics->Reset());
+  ASSERT_EQ(std::vector<std::string>({"a1=a1", "a2=a2", "b1=b1", "b15=b15",
+                                      "b2=b2", "c1=c1"}),
+            Scan(db_, total_order));
+  ASSERT_GT(TestGetTickerCount(options, OMNICACHE_ITER_NEXT_HIT), 0u);
+}
+
+TEST_F(DBOmniCacheTest, Entities) {
+  DestroyAndReopen(OmniCacheOptions());
+  const WideColumns columns{{kDefaultWideColumnName, "d"}, {"c1", "v1"}};
+  ASSERT_OK(db_->PutEntity(WriteOptions(), db_->DefaultColumnFamily(), "e",
+                           columns));
+  ASSERT_OK(Put("p", "vp"));
+  const WideColumns plain{{kDefaultWideColumnName, "vp"}};
+
+  // A miss that fills the cache, then a hit.
+  for (int i = 0; i < 2; ++i) {
+    PinnableWideColumns result;
+    ASSERT_OK(db_->GetEntity(ReadOptions(), db_->DefaultColumnFamily(), "e",
+                             &result));
+    ASSERT_EQ(columns, result.columns());
+    ASSERT_EQ("d", Get("e"));
+    result.Reset();
+    ASSERT_OK(db_->GetEntity(ReadOptions(), db_->DefaultColumnFamily(), "p",
+                             &result));
+    ASSERT_EQ(plain, result.columns());
+
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    iter->Seek("e");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(columns, iter->columns());
+    ASSERT_EQ("d", iter->value());
+    iter->Next();
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(plain, iter->columns());
+  }
+
+  // PutEntity over a cached key.
+  const WideColumns no_default{{"c2", "v2"}};
+  ASSERT_OK(db_->PutEntity(WriteOptions(), db_->DefaultColumnFamily(), "e",
+                           no_default));
+  ASSERT_OK(db_->PutEntity(WriteOptions(), db_->DefaultColumnFamily(), "p",
+                           columns));
+  const std::array<Slice, 3> keys{{"e", "p", "x"}};
+  std::array<PinnableWideColumns, 3> results;
+  std::array<Status, 3> statuses;
+  db_->MultiGetEntity(ReadOptions(), db_->DefaultColumnFamily(), keys.size(),
+                      keys.data(), results.data(), statuses.data());
+  ASSERT_OK(statuses[0]);
+  ASSERT_EQ(no_default, results[0].columns());
+  ASSERT_OK(statuses[1]);
+  ASSERT_EQ(columns, results[1].columns());
+  ASSERT_TRUE(statuses[2].IsNotFound());
+  ASSERT_EQ("", Get("e"));
+}
+
+TEST_F(DBOmniCacheTest, NegativeLookups) {
+  DestroyAndReopen(OmniCacheOptions());
+  ASSERT_OK(Put("a", "va"));
+  ASSERT_OK(Put("c", "vc"));
+  ASSERT_OK(Flush());
+
+  // The second lookup of each is answered by the cache.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ("NOT_FOUND", Get("b"));
+    ASSERT_EQ("NOT_FOUND", Get("x"));
+  }
+  // An empty value is not an absent key.
+  ASSERT_OK(Put("e", ""));
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ("", Get("e"));
+  }
+
+  // Writes to keys known to be absent.
+  ASSERT_OK(Put("b", "vb"));
+  ASSERT_EQ("vb", Get("b"));
+  ASSERT_OK(Delete("b"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  const Snapshot* snapshot = db_->GetSnapshot();
+  ASSERT_OK(Put("x", "vx"));
+  ASSERT_EQ("NOT_FOUND", Get("x", snapshot));
+  ASSERT_EQ("vx", Get("x"));
+  db_->ReleaseSnapshot(snapshot);
+
+  // Empty gaps between cached keys.
+  for (int i = 0; i < 2; ++i) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    iter->Seek("aa");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("c", iter->key());
+    iter->SeekForPrev("bb");
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ("a", iter->key());
+  }
+  ASSERT_OK(Put("bb", "vbb"));
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  iter->Seek("aa");
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("bb", iter->key());
+  iter.reset();
+
+  ASSERT_OK(db_->DeleteRange(WriteOptions(), db_->DefaultColumnFamily(), "a",
+                             "c"));
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("bb"));
+  ASSERT_EQ("vc", Get("c"));
+  Reopen(OmniCacheOptions());
+  ASSERT_EQ("NOT_FOUND", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  ASSERT_EQ("vx", Get("x"));
+}
+
+TEST_F(DBOmniCacheTest, IngestionAndDeleteFilesInRange) {
+  Options options = OmniCacheOptions();
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("b", "v1"));
+  ASSERT_OK(Put("z", "v1"));
+  for (const char* key : {"a", "b", "z"}) {
+    ASSERT_EQ("v1", Get(key));
+  }
+  // Written back: only in the cache and its log for now.
+  ASSERT_OK(Put("a", "v2"));
+
+  const std::string file = dbname_ + "_ingest.sst";
+  SstFileWriter writer(EnvOptions(), options);
+  ASSERT_OK(writer.Open(file));
+  ASSERT_OK(writer.Put("a", "v3"));
+  ASSERT_OK(writer.Delete("b"));
+  ASSERT_OK(writer.Finish());
+  ASSERT_OK(db_->IngestExternalFile({file}, IngestExternalFileOptions()));
+  ASSERT_EQ("v3", Get("a"));
+  ASSERT_EQ("NOT_FOUND", Get("b"));
+  // Outside the file's key span, still cached.
+  ASSERT_EQ("v1", Get("z"));
+  ASSERT_EQ(std::vector<std::string>({"a=v3", "z=v1"}),
+            Scan(db_, ReadOptions()));
+  // The write-back of v2 must not come back over the ingested value.
+  Reopen(options);
+  ASSERT_EQ("v3", Get("a"));
+
+  ASSERT_OK(Put("k1", "v"));
+  ASSERT_OK(Put("k2", "v"));
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_EQ("v", Get("k1"));
+  ASSERT_EQ("v", Get("k2"));
+  ASSERT_EQ(std::vector<std::string>({"a=v3", "k1=v", "k2=v", "z=v1"}),
+            Scan(db_, ReadOptions()));
+  const Slice begin("a");
+  const Slice end("zz");
+  ASSERT_OK(DeleteFilesInRange(db_, db_->DefaultColumnFamily(), &begin, &end));
+  ASSERT_EQ("NOT_FOUND", Get("k1"));
+  ASSERT_EQ("NOT_FOUND", Get("z"));
+  ASSERT_EQ(std::vector<std::string>(), Scan(db_, ReadOptions()));
+  ASSERT_OK(env_->DeleteFile(file));
+}
+
+TEST_F(DBOmniCacheTest, SecondaryCatchUp) {
+  Options options = OmniCacheOptions();
+  options.max_open_files = -1;
+  DestroyAndReopen(options);
+  ASSERT_OK(Put("a", "v1"));
+  ASSERT_OK(Put("b", "v1"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(Put("c", "v1"));
+
+  const std::string secondary_path = dbname_ + "_secondary";
+  DB* secondary = nullptr;
+  ASSERT_OK(DB::OpenAsSecondary(options, dbname_, secondary_path, &secondary));
+  std::unique_ptr<DB> secondary_guard(secondary);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ("v1", GetFrom(secondary, "a"));
+    ASSERT_EQ("v1", GetFrom(secondary, "b"));
+    ASSERT_EQ("NOT_FOUND", GetFrom(secondary, "bb"));
+  }
+  ASSERT_EQ(std::vector<std::string>({"a=v1", "b=v1", "c=v1"}),
+            Scan(secondary, ReadOptions()));
+
+  // Replayed WAL writes.
+  ASSERT_OK(Put("a", "v2"));
+  ASSERT_OK(Delete("b"));
+  ASSERT_OK(Put("bb", "v2"));
+  ASSERT_OK(secondary->TryCatchUpWithPrimary());
+  ASSERT_EQ("v2", GetFrom(secondary, "a"));
+  ASSERT_EQ("NOT_FOUND", GetFrom(secondary, "b"));
+  ASSERT_EQ("v2", GetFrom(secondary, "bb"));
+  ASSERT_EQ(std::vector<std::string>({"a=v2", "bb=v2", "c=v1"}),
+            Scan(secondary, ReadOptions()));
+
+  // Flushed and compacted behind the secondary's back.
+  ASSERT_OK(Put("c", "v2"));
+  ASSERT_OK(Flush());
+  ASSERT_OK(db_->CompactRange(CompactRangeOptions(), nullptr, nullptr));
+  ASSERT_OK(secondary->TryCatchUpWithPrimary());
+  ASSERT_EQ("v2", GetFrom(secondary, "c"));
+  ASSERT_EQ(std::vector<std::string>({"a=v2", "bb=v2", "c=v2"}),
+            Scan(secondary, ReadOptions()));
+}
+
+TEST_F(DBOmniCacheTest, StatisticsPerDB) {
+  Options options = OmniCacheOptions();
+  options.statistics = CreateDBStatistics();
+  DestroyAndReopen(options);
+
+  Options other_options = OmniCacheOptions();
+  other_options.statistics = CreateDBStatistics();
+  const std::string other_name = dbname_ + "_other";
+  ASSERT_OK(DestroyDB(other_name, other_options));
+  DB* other = nullptr;
+  ASSERT_OK(DB::Open(other_options, other_name, &other));
+  ASSERT_OK(other->Put(WriteOptions(), "k", "v"));
+  for (int i = 0; i < 3; ++i) {
+    std::unique_ptr<Iterator> iter(other->NewIterator(ReadOptions()));
+    iter->Seek("k");
+    ASSERT_TRUE(iter->Valid());
+  }
+  const uint64_t other_seeks =
+      other_options.statistics->getTickerCount(OMNICACHE_ITER_SEEK_HIT) +
+      other_options.statistics->getTickerCount(OMNICACHE_ITER_SEEK_MISS);
+  ASSERT_EQ(other_seeks, 3u);
+  delete other;
+  ASSERT_OK(DestroyDB(other_name, other_options));
+
+  // The other DB's seeks are not counted here, and a reset sticks.
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_ITER_SEEK_HIT) +
+                TestGetTickerCount(options, OMNICACHE_ITER_SEEK_MISS),
+            0u);
+  ASSERT_OK(Put("k", "v"));
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  iter->Seek("k");
+  ASSERT_TRUE(iter->Valid());
+  iter.reset();
+  ASSERT_OK(options.statistics->Reset());
+  std::string value;
+  ASSERT_TRUE(db_->GetProperty(DB::Properties::kOptionsStatistics, &value));
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_ITER_SEEK_HIT) +
+                TestGetTickerCount(options, OMNICACHE_ITER_SEEK_MISS),
+            0u);
+}
+
+TEST_F(DBOmniCacheTest, WarmRestartUnderIteratorFillCap) {
+  Options options = OmniCacheOptions();
+  options.statistics = CreateDBStatistics();
+  options.omnicache_warm_restart = true;
+  // Enough for one of the two ranges below.
+  options.omnicache_max_iterator_fills = 4;
+  DestroyAndReopen(options);
+  // "m" is never read: two separate ranges.
+  for (const char* key : {"a0", "a1", "a2", "a3", "m", "b0", "b1", "b2",
+                          "b3"}) {
+    ASSERT_OK(Put(key, key));
+  }
+  for (const char* first : {"a0", "b0"}) {
+    std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+    iter->Seek(first);
+    for (int i = 0; i < 3; ++i) {
+      iter->Next();
+    }
+    ASSERT_TRUE(iter->Valid());
+  }
+
+  // Saves both ranges, the next open reads them back.
+  Reopen(options);
+  for (int i = 0; i < 1000; ++i) {
+    if (TestGetTickerCount(options, OMNICACHE_WARM_UP_KEYS) >= 6) {
+      break;
+    }
+    env_->SleepForMicroseconds(10000);
+  }
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_WARM_UP_KEYS), 6u);
+
+  // The second range was warmed up too.
+  ASSERT_OK(options.statistics->Reset());
+  std::unique_ptr<Iterator> iter(db_->NewIterator(ReadOptions()));
+  iter->Seek("b0");
+  for (int i = 0; i < 3; ++i) {
+    iter->Next();
+  }
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("b3", iter->key());
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_ITER_SEEK_HIT), 1u);
+  ASSERT_EQ(TestGetTickerCount(options, OMNICACHE_ITER_NEXT_HIT), 3u);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ROCKSDB_NAMESPACE::port::InstallStackTraceHandler();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,71 +1,374 @@
 #include "rocksdb/omnicache.h"
 
-#include "rocksdb/debug.h"
+#include "db/column_family.h"
+#include "db/omnicache_log.h"
+#include "db/omnicache_warm.h"
+#include "db/wide/wide_column_serialization.h"
+#include "db/wide/wide_columns_helper.h"
 #include "rocksdb/options.h"
-#include "rocksdb/utilities/omnicache.h"
-#include "stdlib.h"
 #include "string"
+#include "util/cast_util.h"
 
 namespace rocksdb {
 
-OmniCacheEnv::OmniCacheEnv() {
-  fprintf(stderr, "OmniCacheEnv called\n");
-  const char* pEnabledStr = std::getenv("OC_ENABLED");
-  enabled = strenabled(pEnabledStr);
+namespace {
+// The cached form of a read result: the value of a lone default column, or
+// the columns serialized into `buf`.
+Slice CachedValue(const WideColumns& columns, std::string* buf,
+                  bool* entity) {
+  if (WideColumnsHelper::HasDefaultColumnOnly(columns)) {
+    *entity = false;
+    return WideColumnsHelper::GetDefaultColumn(columns);
+  }
+  *entity = true;
+  WideColumnSerialization::Serialize(columns, *buf).PermitUncheckedError();
+  return *buf;
+}
+
+// Cleanup releasing the reference to a shared value that a reader pinned.
+void ReleaseShared(void* arg1, void* /* arg2 */) {
+  static_cast<const FollyValue*>(arg1)->Unref();
+}
+}  // anonymous namespace
+
+OmniCache::OmniCache(const ColumnFamilyOptions& cf_options, size_t capacity,
+                     Statistics* stats) {
+  follySkipList = new FollySkipList(32, cf_options.comparator, capacity, stats);
+  follySkipList->SetAdmissionMinFrequency(
+      cf_options.omnicache_admission_min_frequency);
+  follySkipList->SetReplacementPolicy(cf_options.omnicache_replacement_policy);
+  follySkipList->SetPinValueMinSize(cf_options.omnicache_pin_value_min_size);
+  warm_restart_.store(cf_options.omnicache_warm_restart,
+                      std::memory_order_relaxed);
+  follySkipList->SetSecondaryCache(cf_options.omnicache_secondary_cache);
+}
+
+OmniCache::~OmniCache() { delete follySkipList; }
+
+void OmniCache::SetWriteBack(DB* db, uint32_t cf_id) {
+  log_.reset(new OmniCacheLog(db->GetFileSystem(),
+                              db->GetEnv()->GetSystemClock().get(),
+                              db->GetName(), cf_id));
+  follySkipList->SetWriteBack(db, cf_id);
+}
 
-  const char* pMaxSizeStr = std::getenv("OC_MAXSIZE");
-  if (pMaxSizeStr != nullptr) {
-    maxsize = strtoll(pMaxSizeStr, NULL, 10);
-    dbglprintf("maxsize set to %lu\n", maxsize);
+void OmniCache::Close(bool drop) {
+  // The warm-up reads through the DB, it has to stop first.
+  if (warmer_ != nullptr) {
+    warmer_->Stop();
+    warmer_.reset();
   }
+  DB* db = follySkipList->db_.load(std::memory_order_acquire);
+  Status s = drop ? Status::OK() : follySkipList->FlushDirty();
+  follySkipList->StopEvictor();
+  if (db != nullptr) {
+    if (drop) {
+      db->GetFileSystem()
+          ->DeleteFile(
+              OmniCacheWarmer::FileName(db->GetName(), follySkipList->cf_id_),
+              IOOptions(), nullptr)
+          .PermitUncheckedError();
+    } else if (warm_restart_.load(std::memory_order_relaxed)) {
+      // Only costs the next open a cold cache.
+      SaveHotRanges().PermitUncheckedError();
+    }
+  }
+  if (log_ == nullptr) {
+    return;
+  }
+  if (s.ok() && !drop && db != nullptr) {
+    // The log may only go once the write-back is durable.
+    s = db->FlushWAL(true /* sync */);
+  }
+  // On failure the log stays for DBImpl::Open to replay.
+  log_->Close(s.ok() /* delete_files */);
+  log_.reset();
+}
 
-  const char* pPerfEnabled = std::getenv("OC_PERF");
-  perfEnabled = strenabled(pPerfEnabled);
+Status OmniCache::SaveHotRanges() {
+  DB* db = follySkipList->db_.load(std::memory_order_acquire);
+  if (db == nullptr) {
+    return Status::NotSupported("OmniCache is not attached to a DB");
+  }
+  return OmniCacheWarmer::Save(db->GetFileSystem(),
+                               db->GetEnv()->GetSystemClock().get(),
+                               db->GetName(), follySkipList->cf_id_,
+                               *follySkipList);
+}
 
-  const char* pPerfServer = std::getenv("OC_PERFSERVER");
-  if (pPerfServer != nullptr) {
-    perfServer = std::string(pPerfServer);
-    dbglprintf("perfServer set to %s\n", perfServer.c_str());
+void OmniCache::StartWarmUp(DB* db, ColumnFamilyData* cfd) {
+  if (!warm_restart_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::vector<OmniCacheHotRange> ranges;
+  Status s = OmniCacheWarmer::Load(
+      db->GetFileSystem(), OmniCacheWarmer::FileName(db->GetName(),
+                                                     cfd->GetID()),
+      &ranges);
+  // A missing or damaged file only means a cold start.
+  if (s.ok() && !ranges.empty()) {
+    warmer_.reset(new OmniCacheWarmer(db, cfd, std::move(ranges)));
   }
 }
 
-OmniCacheEnv& OmniCacheEnv::GetOmniCacheEnv() {
-  static OmniCacheEnv env;
-  return env;
+Status OmniCache::WriteBack(const WriteOptions& opt, OmniCacheIterator* iter,
+                            const Slice& value, SequenceNumber seq) {
+  if (opt.disableWAL) {
+    if (!iter->Update(value, seq)) {
+      return Status::Incomplete();
+    }
+    write_back_pending_.store(true, std::memory_order_relaxed);
+    return Status::OK();
+  }
+  if (log_ == nullptr) {
+    return Status::NotSupported("OmniCache write-back log is not set up");
+  }
+  uint64_t log_number = 0;
+  IOStatus s = log_->Append(iter->Key(), value, seq, opt.sync, &log_number);
+  if (!s.ok()) {
+    return s;
+  }
+  // A logged value that did not make it into the cache is replayed on
+  // recovery only if the LSM has nothing newer, and the caller's write
+  // through will be newer.
+  const bool updated = iter->Update(value, seq, log_number);
+  log_->Applied(log_number);
+  if (!updated) {
+    return Status::Incomplete();
+  }
+  write_back_pending_.store(true, std::memory_order_relaxed);
+  if (log_->HasObsoleteFiles()) {
+    // Scan first, then sync: entries found clean have been written to the
+    // WAL, the sync makes that durable before their log files go.
+    uint64_t min_live = follySkipList->MinDirtyLogNumber();
+    DB* db = follySkipList->db_.load(std::memory_order_acquire);
+    if (db == nullptr || !db->FlushWAL(true /* sync */).ok()) {
+      // Keep everything, try again after the next rotation.
+      min_live = 0;
+    }
+    log_->DeleteObsoleteFiles(min_live);
+  }
+  return Status::OK();
+}
+
+size_t OmniCache::GetCapacity() const { return follySkipList->GetCapacity(); }
+
+void OmniCache::SetCapacity(size_t capacity) {
+  follySkipList->SetCapacity(capacity);
 }
 
-OmniCache::OmniCache(const ColumnFamilyOptions& cf_options) {
-  auto& env = OmniCacheEnv::GetOmniCacheEnv();
-  if (env.enabled) {
-    follySkipList = new FollySkipList(32, cf_options.comparator, env.maxsize);
+void OmniCache::SetAdmissionMinFrequency(uint64_t min_frequency) {
+  follySkipList->SetAdmissionMinFrequency(min_frequency);
+}
+
+void OmniCache::SetReplacementPolicy(OmniCacheReplacementPolicy policy) {
+  follySkipList->SetReplacementPolicy(policy);
+}
+
+void OmniCache::SetPinValueMinSize(uint64_t min_size) {
+  follySkipList->SetPinValueMinSize(min_size);
+}
+
+void OmniCache::SetWarmRestart(bool warm_restart) {
+  warm_restart_.store(warm_restart, std::memory_order_relaxed);
+}
+
+void OmniCache::PinValue(const FollyValue& current, PinnableSlice* value,
+                         std::string* timestamp) {
+  // One buffer for the value, its kind and its timestamp.
+  if (timestamp != nullptr) {
+    const Slice ts = current.Timestamp();
+    timestamp->assign(ts.data(), ts.size());
+  }
+  FollyValueHandle shared = current.Share();
+  Slice slice = current.Value();
+  if (current.Entity()) {
+    Slice entity = slice;
+    slice = Slice();
+    // Entities without a default column read as an empty value.
+    WideColumnSerialization::GetValueOfDefaultColumn(entity, slice)
+        .PermitUncheckedError();
+  }
+  if (shared == nullptr) {
+    value->PinSelf(slice);
+    return;
   }
+  value->PinSlice(slice, ReleaseShared,
+                  const_cast<FollyValue*>(shared.release()), nullptr);
 }
 
-OmniCache::~OmniCache() { delete follySkipList; }
+Status OmniCache::PinColumns(const FollyValue& current,
+                             PinnableWideColumns* columns,
+                             std::string* timestamp) {
+  if (timestamp != nullptr) {
+    const Slice ts = current.Timestamp();
+    timestamp->assign(ts.data(), ts.size());
+  }
+  FollyValueHandle shared = current.Share();
+  if (shared == nullptr) {
+    // Copied, the entry may change once the caller lets go of it.
+    if (current.Entity()) {
+      return columns->SetWideColumnValue(current.Value());
+    }
+    columns->SetPlainValue(current.Value());
+    return Status::OK();
+  }
+  const Slice slice = current.Value();
+  Cleanable cleanable;
+  cleanable.RegisterCleanup(
+      ReleaseShared, const_cast<FollyValue*>(shared.release()), nullptr);
+  if (current.Entity()) {
+    return columns->SetWideColumnValue(slice, &cleanable);
+  }
+  columns->SetPlainValue(slice, &cleanable);
+  return Status::OK();
+}
 
-bool OmniCache::Enabled() {
-  auto& env = OmniCacheEnv::GetOmniCacheEnv();
-  return env.enabled;
+bool OmniCache::ServesReadsAt(const Slice* read_ts) const {
+  return follySkipList->ServesReadsAt(read_ts);
 }
 
 std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::Seek(
-    const Slice& target) {
-  auto iter = NewIterator();
+    const Slice& target, SequenceNumber read_seq) {
+  auto iter = NewIterator(read_seq);
   iter->Seek(target);
   return iter;
 }
 
 std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::Insert(
-    const Slice& key, const Slice& value) {
-  return follySkipList->Insert(key, value);
+    const Slice& key, const WideColumns& columns, SequenceNumber seq) {
+  std::string buf;
+  bool entity;
+  const Slice value = CachedValue(columns, &buf, &entity);
+  return follySkipList->Insert(key, value, seq, entity);
 }
 
 std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::Append(
-    const Slice& key, const Slice& value) {
-  return follySkipList->Append(key, value);
+    const Slice& prev_key, const Slice& key, const WideColumns& columns,
+    SequenceNumber seq) {
+  std::string buf;
+  bool entity;
+  const Slice value = CachedValue(columns, &buf, &entity);
+  return follySkipList->Append(prev_key, key, value, seq, entity);
+}
+
+std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::Prepend(
+    const Slice& next_key, const Slice& key, const WideColumns& columns,
+    SequenceNumber seq) {
+  std::string buf;
+  bool entity;
+  const Slice value = CachedValue(columns, &buf, &entity);
+  return follySkipList->Prepend(next_key, key, value, seq, entity);
+}
+
+std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::InsertFirst(
+    const Slice& key, const WideColumns& columns, SequenceNumber seq) {
+  std::string buf;
+  bool entity;
+  const Slice value = CachedValue(columns, &buf, &entity);
+  return follySkipList->InsertFirst(key, value, seq, entity);
+}
+
+std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::InsertLast(
+    const Slice& key, const WideColumns& columns, SequenceNumber seq) {
+  std::string buf;
+  bool entity;
+  const Slice value = CachedValue(columns, &buf, &entity);
+  return follySkipList->InsertLast(key, value, seq, entity);
+}
+
+std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::InsertAbsent(
+    const Slice& key, SequenceNumber seq) {
+  return follySkipList->InsertAbsent(key, seq);
+}
+
+void OmniCache::MultiFind(
+    const std::vector<Slice>& keys, SequenceNumber read_seq,
+    const std::function<void(size_t, const FollyValue&)>& on_hit,
+    const std::function<void(size_t)>& on_absent) {
+  follySkipList->MultiFind(keys, read_seq, on_hit, on_absent);
+}
+
+void OmniCache::InsertBatch(
+    const std::vector<std::pair<Slice, const WideColumns*>>& entries,
+    SequenceNumber seq) {
+  std::vector<std::string> bufs(entries.size());
+  std::vector<FollyFill> fills(entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    fills[i].key = entries[i].first;
+    if (entries[i].second == nullptr) {
+      fills[i].absent = true;
+      continue;
+    }
+    fills[i].value =
+        CachedValue(*entries[i].second, &bufs[i], &fills[i].entity);
+  }
+  follySkipList->InsertBatch(fills, seq);
+}
+
+void OmniCache::ApplyPut(const Slice& key, const Slice& value,
+                         SequenceNumber seq, bool entity) {
+  follySkipList->ApplyPut(key, value, seq, entity);
+}
+
+void OmniCache::ApplyDelete(const Slice& key, SequenceNumber seq) {
+  follySkipList->ApplyDelete(key, seq);
+}
+
+void OmniCache::ApplyDeleteRange(const Slice& begin, const Slice& end,
+                                 SequenceNumber seq) {
+  follySkipList->ApplyDeleteRange(begin, end, seq);
 }
 
-std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::NewIterator() {
-  return follySkipList->NewIterator();
+void OmniCache::Invalidate(const Slice& key, SequenceNumber seq) {
+  follySkipList->ApplyInvalidate(key, seq);
+}
+
+void OmniCache::ApplyWriteBack(const Slice& key, SequenceNumber seq) {
+  follySkipList->ApplyWriteBack(key, seq);
+}
+
+void OmniCache::InvalidateRange(const Slice& smallest, const Slice& largest,
+                                SequenceNumber seq) {
+  follySkipList->ApplyInvalidateRange(smallest, largest, seq);
+}
+
+Status OmniCache::FlushDirty(const Slice& smallest, const Slice& largest) {
+  const Slice begin =
+      StripTimestampFromUserKey(smallest, follySkipList->ts_sz_);
+  const Slice end = StripTimestampFromUserKey(largest, follySkipList->ts_sz_);
+  return follySkipList->FlushDirty(&begin, &end);
+}
+
+Status OmniCache::FlushDirty() { return follySkipList->FlushDirty(); }
+
+std::unique_ptr<OmniCache::OmniCacheIterator> OmniCache::NewIterator(
+    SequenceNumber read_seq) {
+  return follySkipList->NewIterator(read_seq);
+}
+
+size_t OmniCache::ApproximateMemoryUsage() const {
+  return follySkipList->ApproximateMemoryUsage() + follySkipList->IdleBytes();
+}
+
+size_t OmniCache::EvictQueueDepth() const {
+  return follySkipList->EvictQueueDepth();
+}
+
+void OmniCache::SetCacheReservationManager(
+    std::shared_ptr<CacheReservationManager> cache_res_mgr) {
+  follySkipList->SetCacheReservationManager(std::move(cache_res_mgr));
+}
+
+Status SaveOmniCacheHotRanges(DB* db, ColumnFamilyHandle* column_family) {
+  if (column_family == nullptr) {
+    column_family = db->DefaultColumnFamily();
+  }
+  auto cfh = static_cast_with_check<ColumnFamilyHandleImpl>(column_family);
+  OmniCache* oc = cfh->cfd()->oc_;
+  if (oc == nullptr) {
+    return Status::NotSupported("column family has no OmniCache");
+  }
+  return oc->SaveHotRanges();
 }
 }  // namespace rocksdb
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "db/omnicache_log.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+#include "db/log_reader.h"
+#include "file/read_write_util.h"
+#include "file/sequence_file_reader.h"
+#include "file/writable_file_writer.h"
+#include "util/coding.h"
+#include "util/string_util.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+const char* const kFilePrefix = "OMNICACHE-";
+
+struct LogReporter : public log::Reader::Reporter {
+  Status* status;
+  void Corruption(size_t /*bytes*/, const Status& s) override {
+    if (status->ok()) {
+      *status = s;
+    }
+  }
+};
+}  // anonymous namespace
+
+OmniCacheLog::OmniCacheLog(FileSystem* fs, SystemClock* clock,
+                           const std::string& dbname, uint32_t cf_id)
+    : fs_(fs), clock_(clock), dbname_(dbname), cf_id_(cf_id) {}
+
+OmniCacheLog::~OmniCacheLog() { Close(false /* delete_files */); }
+
+IOStatus OmniCacheLog::Append(const Slice& key, const Slice& value,
+                              SequenceNumber seq, bool sync,
+                              uint64_t* log_number) {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (!status_.ok()) {
+    return status_;
+  }
+  PutVarint64(&pending_, seq);
+  PutLengthPrefixedSlice(&pending_, key);
+  PutLengthPrefixedSlice(&pending_, value);
+  pending_sync_ = pending_sync_ || sync;
+  const uint64_t ticket = ++appended_;
+  // A rotation can only move the entry to a later file.
+  const uint64_t number = std::max<uint64_t>(number_, 1);
+  inflight_.insert(number);
+  while (committed_ < ticket) {
+    if (writing_) {
+      cv_.wait(lock);
+      continue;
+    }
+    // Lead the next group. It takes everything queued so far, ours included.
+    std::string entries;
+    entries.swap(pending_);
+    const bool group_sync = pending_sync_;
+    pending_sync_ = false;
+    const uint64_t last = appended_;
+    writing_ = true;
+    lock.unlock();
+    IOStatus s = WriteGroup(entries, group_sync);
+    lock.lock();
+    if (!s.ok() && status_.ok()) {
+      status_ = s;
+      failed_from_ = committed_ + 1;
+    }
+    committed_ = last;
+    writing_ = false;
+    cv_.notify_all();
+  }
+  if (ticket >= failed_from_) {
+    inflight_.erase(inflight_.find(number));
+    return status_;
+  }
+  *log_number = number;
+  return IOStatus::OK();
+}
+
+void OmniCacheLog::Applied(uint64_t log_number) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = inflight_.find(log_number);
+  assert(it != inflight_.end());
+  inflight_.erase(it);
+}
+
+bool OmniCacheLog::HasObsoleteFiles() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return purge_pending_;
+}
+
+void OmniCacheLog::DeleteObsoleteFiles(uint64_t min_live) {
+  uint64_t begin;
+  uint64_t end;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    purge_pending_ = false;
+    // Never the file being written to.
+    end = std::min(min_live, number_);
+    if (!inflight_.empty()) {
+      end = std::min(end, *inflight_.begin());
+    }
+    begin = oldest_;
+    if (end <= begin) {
+      return;
+    }
+    oldest_ = end;
+  }
+  for (uint64_t number = begin; number < end; ++number) {
+    fs_->DeleteFile(FileName(dbname_, cf_id_, number), IOOptions(), nullptr)
+        .PermitUncheckedError();
+  }
+}
+
+void OmniCacheLog::Close(bool delete_files) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (writer_ != nullptr) {
+    writer_->Close(WriteOptions()).PermitUncheckedError();
+    writer_.reset();
+  }
+  if (!delete_files) {
+    return;
+  }
+  for (uint64_t number = oldest_; number <= number_; ++number) {
+    fs_->DeleteFile(FileName(dbname_, cf_id_, number), IOOptions(), nullptr)
+        .PermitUncheckedError();
+  }
+  oldest_ = number_ + 1;
+}
+
+IOStatus OmniCacheLog::WriteGroup(const std::string& entries, bool sync) {
+  IOStatus s;
+  if (writer_ == nullptr || writer_->file()->GetFileSize() >= kMaxFileSize) {
+    s = NewFile();
+  }
+  const WriteOptions write_options;
+  if (s.ok()) {
+    s = writer_->AddRecord(write_options, entries);
+  }
+  if (s.ok() && sync) {
+    IOOptions opts;
+    s = WritableFileWriter::PrepareIOOptions(write_options, opts);
+    if (s.ok()) {
+      s = writer_->file()->Sync(opts, false /* use_fsync */);
+    }
+  }
+  return s;
+}
+
+IOStatus OmniCacheLog::NewFile() {
+  if (writer_ != nullptr) {
+    // Entries not synced yet still reach the file on close.
+    IOStatus s = writer_->Close(WriteOptions());
+    writer_.reset();
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  uint64_t number;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    number = ++number_;
+    purge_pending_ = number > oldest_;
+  }
+  const std::string fname = FileName(dbname_, cf_id_, number);
+  const FileOptions file_options;
+  std::unique_ptr<FSWritableFile> file;
+  IOStatus s = NewWritableFile(fs_, fname, &file, file_options);
+  if (!s.ok()) {
+    return s;
+  }
+  std::unique_ptr<WritableFileWriter> file_writer(
+      new WritableFileWriter(std::move(file), fname, file_options, clock_));
+  writer_.reset(new log::Writer(std::move(file_writer), number,
+                                false /* recycle_log_files */));
+  return s;
+}
+
+std::string OmniCacheLog::FileName(const std::string& dbname, uint32_t cf_id,
+                                   uint64_t number) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "/%s%" PRIu32 "-%06" PRIu64, kFilePrefix, cf_id,
+           number);
+  return dbname + buf;
+}
+
+bool OmniCacheLog::ParseFileName(const std::string& fname, uint32_t* cf_id,
+                                 uint64_t* number) {
+  Slice rest(fname);
+  if (!rest.starts_with(kFilePrefix)) {
+    return false;
+  }
+  rest.remove_prefix(strlen(kFilePrefix));
+  uint64_t id;
+  if (!ConsumeDecimalNumber(&rest, &id) ||
+      id > std::numeric_limits<uint32_t>::max() || !rest.starts_with("-")) {
+    return false;
+  }
+  rest.remove_prefix(1);
+  if (!ConsumeDecimalNumber(&rest, number) || !rest.empty()) {
+    return false;
+  }
+  *cf_id = static_cast<uint32_t>(id);
+  return true;
+}
+
+Status OmniCacheLog::ReadFile(
+    FileSystem* fs, const std::string& fname,
+    const std::function<void(const Slice& key, const Slice& value,
+                             SequenceNumber seq)>& fn) {
+  std::unique_ptr<SequentialFileReader> file_reader;
+  {
+    std::unique_ptr<FSSequentialFile> file;
+    Status s = fs->NewSequentialFile(fname, FileOptions(), &file, nullptr);
+    if (!s.ok()) {
+      return s;
+    }
+    file_reader.reset(new SequentialFileReader(std::move(file), fname));
+  }
+  Status status;
+  LogReporter reporter;
+  reporter.status = &status;
+  log::Reader reader(nullptr, std::move(file_reader), &reporter,
+                     true /* checksum */, 0 /* log_num */);
+  Slice record;
+  std::string scratch;
+  while (status.ok() && reader.ReadRecord(&record, &scratch)) {
+    while (!record.empty()) {
+      uint64_t seq;
+      Slice key;
+      Slice value;
+      if (!GetVarint64(&record, &seq) ||
+          !GetLengthPrefixedSlice(&record, &key) ||
+          !GetLengthPrefixedSlice(&record, &value)) {
+        return Status::Corruption("bad OmniCache log entry", fname);
+      }
+      fn(key, value, seq);
+    }
+  }
+  return status;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "db/log_writer.h"
+#include "rocksdb/file_system.h"
+#include "rocksdb/io_status.h"
+#include "rocksdb/system_clock.h"
+#include "rocksdb/types.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// Write-back log of one column family's OmniCache.
+//
+// A Put that hits the cache only updates the cached entry; the value reaches
+// the LSM once the entry is evicted. Unless the WAL is disabled, such Puts
+// are appended here first, so a crash before the write-back does not lose
+// them. DBImpl::Open replays the entries that are still newer than the LSM
+// and deletes the files.
+//
+// Files are named <dbname>/OMNICACHE-<cf id>-<number>. Each record holds
+// one or more entries:
+//   seq: varint64, key: length-prefixed slice, value: length-prefixed slice
+// Concurrent appends are group committed: one thread writes, and syncs if
+// any of them asked for it, the entries of everyone queued behind it.
+class OmniCacheLog {
+ public:
+  // A new file is started once the current one grows past this.
+  static const uint64_t kMaxFileSize = 64 << 20;
+
+  OmniCacheLog(FileSystem* fs, SystemClock* clock, const std::string& dbname,
+               uint32_t cf_id);
+  ~OmniCacheLog();
+
+  // Returns once the entry is written, and synced if `sync`. On success
+  // `*log_number` is set to a file number at or below the one holding the
+  // entry, and the caller must call Applied() with it after updating the
+  // cache. Errors are sticky.
+  IOStatus Append(const Slice& key, const Slice& value, SequenceNumber seq,
+                  bool sync, uint64_t* log_number);
+  // The entry appended under `log_number` is now tracked by its cache node.
+  void Applied(uint64_t log_number);
+
+  // Whether rotation left files behind that may be deletable.
+  bool HasObsoleteFiles() const;
+  // Deletes the files below `min_live`, the oldest file a dirty cache entry
+  // still depends on. Files with appends in flight are kept.
+  void DeleteObsoleteFiles(uint64_t min_live);
+  // Closes the current file. With `delete_files`, every file is deleted;
+  // the caller has written all dirty entries back.
+  void Close(bool delete_files);
+
+  static std::string FileName(const std::string& dbname, uint32_t cf_id,
+                              uint64_t number);
+  static bool ParseFileName(const std::string& fname, uint32_t* cf_id,
+                            uint64_t* number);
+  // Calls `fn` for every entry in the file, in log order. A torn last
+  // record is ignored.
+  static Status ReadFile(
+      FileSystem* fs, const std::string& fname,
+      const std::function<void(const Slice& key, const Slice& value,
+                               SequenceNumber seq)>& fn);
+
+ private:
+  IOStatus WriteGroup(const std::string& entries, bool sync);
+  IOStatus NewFile();
+
+  FileSystem* const fs_;
+  SystemClock* const clock_;
+  const std::string dbname_;
+  const uint32_t cf_id_;
+
+  // Only touched by the thread writing the current group.
+  std::unique_ptr<log::Writer> writer_;
+
+  mutable std::mutex mu_;
+  std::condition_variable cv_;
+  // Entries queued for the next group.
+  std::string pending_;
+  bool pending_sync_ = false;
+  // Entries are numbered as they queue up; a group commits all of them up
+  // to the last one it took.
+  uint64_t appended_ = 0;
+  uint64_t committed_ = 0;
+  bool writing_ = false;
+  // First error, and the first entry it applies to.
+  IOStatus status_;
+  uint64_t failed_from_ = std::numeric_limits<uint64_t>::max();
+  // File being written to (0 before the first one), and the oldest file not
+  // yet deleted.
+  uint64_t number_ = 0;
+  uint64_t oldest_ = 1;
+  // Set by a rotation, cleared by DeleteObsoleteFiles().
+  bool purge_pending_ = false;
+  // Log numbers handed out by Append() and not yet Applied().
+  std::multiset<uint64_t> inflight_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,62 @@
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/omnicache_log.h"
+#include "gtest/gtest.h"
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(OmniCacheLogTest, AppendAndRead) {
+  Env* env = Env::Default();
+  const std::string dbname = test::PerThreadDBPath("omnicache_log_test");
+  ASSERT_OK(env->CreateDirIfMissing(dbname));
+  FileSystem* fs = env->GetFileSystem().get();
+  const std::string fname = OmniCacheLog::FileName(dbname, 7, 1);
+  uint32_t cf_id;
+  uint64_t number;
+  ASSERT_TRUE(OmniCacheLog::ParseFileName(
+      fname.substr(dbname.size() + 1), &cf_id, &number));
+  ASSERT_EQ(cf_id, 7u);
+  ASSERT_EQ(number, 1u);
+
+  {
+    OmniCacheLog log(fs, env->GetSystemClock().get(), dbname, 7);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&log, t] {
+        for (int i = 0; i < 100; ++i) {
+          auto key = std::to_string(t * 100 + i);
+          uint64_t log_number = 0;
+          ASSERT_OK(log.Append(key, key, i, i % 10 == 0, &log_number));
+          ASSERT_EQ(log_number, 1u);
+          log.Applied(log_number);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    log.Close(false /* delete_files */);
+  }
+
+  std::map<std::string, std::string> entries;
+  ASSERT_OK(OmniCacheLog::ReadFile(
+      fs, fname,
+      [&entries](const Slice& key, const Slice& value, SequenceNumber) {
+        entries[key.ToString()] = value.ToString();
+      }));
+  ASSERT_EQ(entries.size(), 400u);
+  ASSERT_EQ(entries["123"], "123");
+  ASSERT_OK(env->DeleteFile(fname));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,193 @@
+#include "db/omnicache_warm.h"
+
+#include <cinttypes>
+
+#include "db/log_reader.h"
+#include "db/log_writer.h"
+#include "file/read_write_util.h"
+#include "file/sequence_file_reader.h"
+#include "file/writable_file_writer.h"
+#include "memtable/follyskiplist.h"
+#include "monitoring/perf_counter.h"
+#include "rocksdb/db.h"
+#include "util/coding.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+namespace {
+const uint32_t kFromFirst = 1;
+const uint32_t kLinked = 2;
+
+struct LogReporter : public log::Reader::Reporter {
+  Status* status;
+  void Corruption(size_t /*bytes*/, const Status& s) override {
+    if (status->ok()) {
+      *status = s;
+    }
+  }
+};
+}  // anonymous namespace
+
+OmniCacheWarmer::OmniCacheWarmer(DB* db, ColumnFamilyData* cfd,
+                                 std::vector<OmniCacheHotRange> ranges)
+    : db_(db), stats_(cfd->ioptions()->stats), ranges_(std::move(ranges)) {
+  handle_.SetCFD(cfd);
+  const size_t threads = std::min(kThreads, ranges_.size());
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back([this] { Run(); });
+  }
+}
+
+OmniCacheWarmer::~OmniCacheWarmer() { Stop(); }
+
+void OmniCacheWarmer::Stop() {
+  stop_.store(true, std::memory_order_relaxed);
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void OmniCacheWarmer::Run() {
+  static PERFCOUNTER_DEF("/oc/warmup/", ranges);
+  static PERFCOUNTER_DEF_STAT("/oc/warmup/", keys, OMNICACHE_WARM_UP_KEYS);
+
+  const size_t ts_sz = handle_.GetComparator()->timestamp_size();
+  // The cache only serves reads at the latest timestamp.
+  const std::string max_ts(ts_sz, '\xff');
+  const Slice ts(max_ts);
+  ReadOptions read_options;
+  if (ts_sz > 0) {
+    read_options.timestamp = &ts;
+  }
+  size_t i;
+  while (!stop_.load(std::memory_order_relaxed) &&
+         (i = next_.fetch_add(1, std::memory_order_relaxed)) < ranges_.size()) {
+    const OmniCacheHotRange& range = ranges_[i];
+    PERFCOUNTER_INC(ranges);
+    if (range.keys.size() == 1 && !range.from_first && !range.linked) {
+      PinnableSlice value;
+      db_->Get(read_options, &handle_, range.keys[0], &value)
+          .PermitUncheckedError();
+      PERFCOUNTER_INC_STAT(keys, stats_);
+      continue;
+    }
+    // One iterator per range: omnicache_max_iterator_fills caps a single
+    // scan, not the whole warm-up. It also reads the latest version.
+    std::unique_ptr<Iterator> iter(db_->NewIterator(read_options, &handle_));
+    if (range.from_first) {
+      iter->SeekToFirst();
+    } else {
+      iter->Seek(range.keys[0]);
+    }
+    // One Next past the last key reads the gap after it.
+    size_t steps = range.keys.size() - 1 + (range.linked ? 1 : 0);
+    while (iter->Valid() && steps > 0 &&
+           !stop_.load(std::memory_order_relaxed)) {
+      iter->Next();
+      PERFCOUNTER_INC_STAT(keys, stats_);
+      --steps;
+    }
+  }
+}
+
+std::string OmniCacheWarmer::FileName(const std::string& dbname,
+                                      uint32_t cf_id) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "/OMNICACHE-%" PRIu32 "-WARM", cf_id);
+  return dbname + buf;
+}
+
+IOStatus OmniCacheWarmer::Save(FileSystem* fs, SystemClock* clock,
+                               const std::string& dbname, uint32_t cf_id,
+                               const FollySkipList& list) {
+  const std::string fname = FileName(dbname, cf_id);
+  const std::string tmp_fname = fname + ".tmp";
+  const FileOptions file_options;
+  std::unique_ptr<FSWritableFile> file;
+  IOStatus s = NewWritableFile(fs, tmp_fname, &file, file_options);
+  if (!s.ok()) {
+    return s;
+  }
+  std::unique_ptr<WritableFileWriter> file_writer(
+      new WritableFileWriter(std::move(file), tmp_fname, file_options, clock));
+  log::Writer writer(std::move(file_writer), 0 /* log_number */,
+                     false /* recycle_log_files */);
+  const WriteOptions write_options;
+  std::string record;
+  list.ForEachRange(kMaxRangeKeys, [&](const std::vector<std::string>& keys,
+                                       bool from_first, bool linked) {
+    if (!s.ok()) {
+      return;
+    }
+    record.clear();
+    PutVarint32(&record,
+                (from_first ? kFromFirst : 0) | (linked ? kLinked : 0));
+    PutVarint32(&record, static_cast<uint32_t>(keys.size()));
+    for (const auto& key : keys) {
+      PutLengthPrefixedSlice(&record, key);
+    }
+    s = writer.AddRecord(write_options, record);
+  });
+  if (s.ok()) {
+    IOOptions opts;
+    s = WritableFileWriter::PrepareIOOptions(write_options, opts);
+    if (s.ok()) {
+      s = writer.file()->Sync(opts, false /* use_fsync */);
+    }
+  }
+  IOStatus close_s = writer.Close(write_options);
+  if (s.ok()) {
+    s = close_s;
+  }
+  if (s.ok()) {
+    s = fs->RenameFile(tmp_fname, fname, IOOptions(), nullptr);
+  }
+  if (!s.ok()) {
+    fs->DeleteFile(tmp_fname, IOOptions(), nullptr).PermitUncheckedError();
+  }
+  return s;
+}
+
+Status OmniCacheWarmer::Load(FileSystem* fs, const std::string& fname,
+                             std::vector<OmniCacheHotRange>* ranges) {
+  std::unique_ptr<SequentialFileReader> file_reader;
+  {
+    std::unique_ptr<FSSequentialFile> file;
+    Status s = fs->NewSequentialFile(fname, FileOptions(), &file, nullptr);
+    if (!s.ok()) {
+      return s;
+    }
+    file_reader.reset(new SequentialFileReader(std::move(file), fname));
+  }
+  Status status;
+  LogReporter reporter;
+  reporter.status = &status;
+  log::Reader reader(nullptr, std::move(file_reader), &reporter,
+                     true /* checksum */, 0 /* log_num */);
+  Slice record;
+  std::string scratch;
+  while (status.ok() && reader.ReadRecord(&record, &scratch)) {
+    OmniCacheHotRange range;
+    uint32_t flags;
+    uint32_t count;
+    if (!GetVarint32(&record, &flags) || !GetVarint32(&record, &count) ||
+        count == 0) {
+      return Status::Corruption("bad OmniCache warm range", fname);
+    }
+    range.from_first = (flags & kFromFirst) != 0;
+    range.linked = (flags & kLinked) != 0;
+    range.keys.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      Slice key;
+      if (!GetLengthPrefixedSlice(&record, &key)) {
+        return Status::Corruption("bad OmniCache warm range", fname);
+      }
+      range.keys.push_back(key.ToString());
+    }
+    ranges->push_back(std::move(range));
+  }
+  return status;
+}
+
+}  // namespace ROCKSDB_NAMESPACE
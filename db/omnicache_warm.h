@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db/column_family.h"
+#include "rocksdb/file_system.h"
+#include "rocksdb/io_status.h"
+#include "rocksdb/system_clock.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class DB;
+class FollySkipList;
+
+// A run of adjacent cached keys saved for a warm restart.
+struct OmniCacheHotRange {
+  // Nothing precedes keys.front() in the column family.
+  bool from_first = false;
+  // The gap after keys.back() was cached as well.
+  bool linked = false;
+  std::vector<std::string> keys;
+};
+
+// Warm restart of one column family's OmniCache.
+//
+// On close the keys of every cached range (no values) are saved to
+// <dbname>/OMNICACHE-<cf id>-WARM, one record per range:
+//   flags: varint32, count: varint32, keys: length-prefixed slices
+// When the DB opens again, a few background threads replay the ranges as
+// reads through the DB: a Seek and Next per key, or a Get for a lone key.
+// The cache fills the way it would have for the original readers, and
+// values are always read from the LSM, so writes made while the file sat
+// on disk are never shadowed by a stale value.
+class OmniCacheWarmer {
+ public:
+  static const size_t kThreads = 4;
+  // Keys per saved range at most, longer ranges are split.
+  static const size_t kMaxRangeKeys = 1024;
+
+  // Replays `ranges` on background threads against `cfd` of `db`.
+  OmniCacheWarmer(DB* db, ColumnFamilyData* cfd,
+                  std::vector<OmniCacheHotRange> ranges);
+  ~OmniCacheWarmer();
+
+  // Abandons the ranges not yet replayed and joins the threads. Called
+  // before the column family goes away.
+  void Stop();
+
+  static std::string FileName(const std::string& dbname, uint32_t cf_id);
+  // Saves the ranges cached in `list`. The file is written under a
+  // temporary name and renamed over the previous one.
+  static IOStatus Save(FileSystem* fs, SystemClock* clock,
+                       const std::string& dbname, uint32_t cf_id,
+                       const FollySkipList& list);
+  static Status Load(FileSystem* fs, const std::string& fname,
+                     std::vector<OmniCacheHotRange>* ranges);
+
+ private:
+  void Run();
+
+  DB* const db_;
+  Statistics* const stats_;
+  ColumnFamilyHandleInternal handle_;
+  const std::vector<OmniCacheHotRange> ranges_;
+  // Next range to be replayed.
+  std::atomic<size_t> next_{0};
+  std::atomic<bool> stop_{false};
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace ROCKSDB_NAMESPACE
@@ -0,0 +1,52 @@
+#include <string>
+#include <vector>
+
+#include "db/omnicache_log.h"
+#include "db/omnicache_warm.h"
+#include "gtest/gtest.h"
+#include "memtable/follyskiplist.h"
+#include "rocksdb/env.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(OmniCacheWarmerTest, SaveAndLoad) {
+  Env* env = Env::Default();
+  const std::string dbname = test::PerThreadDBPath("omnicache_warm_test");
+  ASSERT_OK(env->CreateDirIfMissing(dbname));
+  FileSystem* fs = env->GetFileSystem().get();
+
+  FollySkipList skiplist(32, BytewiseComparator(), 1 << 20);
+  skiplist.InsertFirst("a", "a", 0);
+  skiplist.Append("a", "b", "b", 0);
+  skiplist.Insert("m", "m", 0);
+  skiplist.InsertLast("z", "z", 0);
+  ASSERT_OK(OmniCacheWarmer::Save(fs, env->GetSystemClock().get(), dbname, 3,
+                                  skiplist));
+
+  const std::string fname = OmniCacheWarmer::FileName(dbname, 3);
+  uint32_t cf_id;
+  uint64_t number;
+  // Not mistaken for a write-back log.
+  ASSERT_FALSE(OmniCacheLog::ParseFileName(fname.substr(dbname.size() + 1),
+                                           &cf_id, &number));
+  std::vector<OmniCacheHotRange> ranges;
+  ASSERT_OK(OmniCacheWarmer::Load(fs, fname, &ranges));
+  ASSERT_EQ(ranges.size(), 3u);
+  ASSERT_EQ(ranges[0].keys, std::vector<std::string>({"a", "b"}));
+  ASSERT_TRUE(ranges[0].from_first);
+  ASSERT_FALSE(ranges[0].linked);
+  ASSERT_EQ(ranges[1].keys, std::vector<std::string>({"m"}));
+  ASSERT_FALSE(ranges[1].from_first);
+  ASSERT_FALSE(ranges[1].linked);
+  ASSERT_EQ(ranges[2].keys, std::vector<std::string>({"z"}));
+  ASSERT_TRUE(ranges[2].linked);
+  ASSERT_OK(env->DeleteFile(fname));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
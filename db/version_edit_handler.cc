@@ -1122,16 +1122,82 @@ Status ManifestTailer::Initialize() {
 
 Status ManifestTailer::ApplyVersionEdit(VersionEdit& edit,
                                         ColumnFamilyData** cfd) {
+  std::vector<CatchUpCacheChange> changes;
+  if (Mode::kCatchUp == mode_) {
+    CollectCacheChanges(edit, &changes);
+  }
   Status s = VersionEditHandler::ApplyVersionEdit(edit, cfd);
   if (s.ok()) {
     assert(cfd);
     if (*cfd) {
       cfds_changed_.insert(*cfd);
+      for (auto& change : changes) {
+        cache_changes_.push_back(std::move(change));
+      }
     }
   }
   return s;
 }
 
+void ManifestTailer::CollectCacheChanges(
+    const VersionEdit& edit, std::vector<CatchUpCacheChange>* changes) {
+  ColumnFamilySet* cfd_set = version_set_->GetColumnFamilySet();
+  assert(cfd_set);
+  ColumnFamilyData* cfd = cfd_set->GetColumnFamily(edit.GetColumnFamily());
+  if (cfd == nullptr || cfd->IsDropped() || cfd->oc_ == nullptr) {
+    return;
+  }
+  const VersionEdit::NewFiles& new_files = edit.GetNewFiles();
+  const VersionEdit::DeletedFiles& deleted_files = edit.GetDeletedFiles();
+  if (deleted_files.empty()) {
+    // A flush, whose data the WAL replay may have applied already, or an
+    // ingestion, which has no WAL record.
+    for (const auto& new_file : new_files) {
+      const FileMetaData& f = new_file.second;
+      changes->push_back({cfd, f.smallest.user_key().ToString(),
+                          f.largest.user_key().ToString(),
+                          edit.HasLogNumber() ? f.fd.largest_seqno
+                                              : kMaxSequenceNumber});
+    }
+    return;
+  }
+  if (new_files.empty()) {
+    // DeleteFilesInRange(), or a compaction that dropped all its input.
+    const VersionStorageInfo* vstorage = cfd->current()->storage_info();
+    for (const auto& deleted_file : deleted_files) {
+      for (const FileMetaData* f : vstorage->LevelFiles(deleted_file.first)) {
+        if (f->fd.GetNumber() == deleted_file.second) {
+          changes->push_back({cfd, f->smallest.user_key().ToString(),
+                              f->largest.user_key().ToString(),
+                              kMaxSequenceNumber});
+          break;
+        }
+      }
+    }
+    return;
+  }
+  // Otherwise a compaction, which only changes the data if the primary ran a
+  // compaction filter. The secondary is opened with the same options, so
+  // take its own.
+  const ImmutableOptions* ioptions = cfd->ioptions();
+  if (ioptions->compaction_filter == nullptr &&
+      ioptions->compaction_filter_factory == nullptr) {
+    return;
+  }
+  for (const auto& new_file : new_files) {
+    const FileMetaData& f = new_file.second;
+    bool moved = false;
+    for (const auto& deleted_file : deleted_files) {
+      moved = moved || deleted_file.second == f.fd.GetNumber();
+    }
+    if (!moved) {
+      changes->push_back({cfd, f.smallest.user_key().ToString(),
+                          f.largest.user_key().ToString(),
+                          kMaxSequenceNumber});
+    }
+  }
+}
+
 Status ManifestTailer::OnColumnFamilyAdd(VersionEdit& edit,
                                          ColumnFamilyData** cfd) {
   if (Mode::kRecovery == mode_) {
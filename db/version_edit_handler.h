@@ -310,6 +310,8 @@ class ManifestTailer : public VersionEditHandlerPointInTime {
     return cfds_changed_;
   }
 
+  std::vector<CatchUpCacheChange>& GetCacheChanges() { return cache_changes_; }
+
  protected:
   Status Initialize() override;
 
@@ -324,6 +326,12 @@ class ManifestTailer : public VersionEditHandlerPointInTime {
   Status VerifyFile(ColumnFamilyData* cfd, const std::string& fpath, int level,
                     const FileMetaData& fmeta) override;
 
+  // Key spans of `edit` the OmniCache of its column family must drop. Called
+  // before the edit is applied, while its deleted files are still in the
+  // current version.
+  void CollectCacheChanges(const VersionEdit& edit,
+                           std::vector<CatchUpCacheChange>* changes);
+
   enum Mode : uint8_t {
     kRecovery = 0,
     kCatchUp = 1,
@@ -331,6 +339,7 @@ class ManifestTailer : public VersionEditHandlerPointInTime {
 
   Mode mode_;
   std::unordered_set<ColumnFamilyData*> cfds_changed_;
+  std::vector<CatchUpCacheChange> cache_changes_;
 };
 
 class DumpManifestHandler : public VersionEditHandler {
@@ -7441,7 +7441,8 @@ Status ReactiveVersionSet::ReadAndApply(
     InstrumentedMutex* mu,
     std::unique_ptr<log::FragmentBufferedReader>* manifest_reader,
     Status* manifest_read_status,
-    std::unordered_set<ColumnFamilyData*>* cfds_changed) {
+    std::unordered_set<ColumnFamilyData*>* cfds_changed,
+    std::vector<CatchUpCacheChange>* cache_changes) {
   assert(manifest_reader != nullptr);
   assert(cfds_changed != nullptr);
   mu->AssertHeld();
@@ -7458,6 +7459,12 @@ Status ReactiveVersionSet::ReadAndApply(
   if (s.ok()) {
     *cfds_changed = std::move(manifest_tailer_->GetUpdatedColumnFamilies());
   }
+  std::vector<CatchUpCacheChange>& changes =
+      manifest_tailer_->GetCacheChanges();
+  if (s.ok() && cache_changes != nullptr) {
+    *cache_changes = std::move(changes);
+  }
+  changes.clear();
 
   return s;
 }
@@ -1709,6 +1709,21 @@ class VersionSet {
   bool closed_;
 };
 
+// A key span whose data a MANIFEST catch-up changed behind the write path,
+// in a column family with an OmniCache. See
+// DBImplSecondary::TryCatchUpWithPrimary().
+struct CatchUpCacheChange {
+  ColumnFamilyData* cfd;
+  // User keys, both included.
+  std::string smallest;
+  std::string largest;
+  // Newest sequence number of the data in a flushed file, which the WAL
+  // replay may already have applied. kMaxSequenceNumber for changes without
+  // a sequence number of their own, or none the WAL carried: ingestion,
+  // deleted files, compaction filters.
+  SequenceNumber largest_seqno;
+};
+
 // ReactiveVersionSet represents a collection of versions of the column
 // families of the database. Users of ReactiveVersionSet, e.g. DBImplSecondary,
 // need to replay the MANIFEST (description log in older terms) in order to
@@ -1732,7 +1747,8 @@ class ReactiveVersionSet : public VersionSet {
       InstrumentedMutex* mu,
       std::unique_ptr<log::FragmentBufferedReader>* manifest_reader,
       Status* manifest_read_status,
-      std::unordered_set<ColumnFamilyData*>* cfds_changed);
+      std::unordered_set<ColumnFamilyData*>* cfds_changed,
+      std::vector<CatchUpCacheChange>* cache_changes = nullptr);
 
   Status Recover(const std::vector<ColumnFamilyDescriptor>& column_families,
                  std::unique_ptr<log::FragmentBufferedReader>* manifest_reader,
@@ -728,6 +728,14 @@ void WriteBatchInternal::SetAsLatestPersistentState(WriteBatch* b) {
   b->is_latest_persistent_state_ = true;
 }
 
+bool WriteBatchInternal::IsOmniCacheWriteBack(const WriteBatch* b) {
+  return b->is_omnicache_write_back_;
+}
+
+void WriteBatchInternal::SetAsOmniCacheWriteBack(WriteBatch* b) {
+  b->is_omnicache_write_back_ = true;
+}
+
 uint32_t WriteBatchInternal::Count(const WriteBatch* b) {
   return DecodeFixed32(b->rep_.data() + 8);
 }
@@ -1811,6 +1819,8 @@ class MemTableInserter : public WriteBatch::Handler {
 
   bool hint_per_batch_;
   bool hint_created_;
+  // Whether the batch being inserted is an OmniCache write-back
+  bool omnicache_write_back_ = false;
   // Hints for this batch
   using HintMap = std::unordered_map<MemTable*, void*>;
   using HintMapType = std::aligned_storage<sizeof(HintMap)>::type;
@@ -1955,6 +1965,9 @@ class MemTableInserter : public WriteBatch::Handler {
   }
 
   void set_log_number_ref(uint64_t log) { log_number_ref_ = log; }
+  void set_omnicache_write_back(bool write_back) {
+    omnicache_write_back_ = write_back;
+  }
   void set_prot_info(const WriteBatch::ProtectionInfo* prot_info) {
     prot_info_ = prot_info;
     prot_info_idx_ = 0;
@@ -2012,6 +2025,54 @@ class MemTableInserter : public WriteBatch::Handler {
     return true;
   }
 
+  // Keeps OmniCache coherent with a write that has just been added to the
+  // memtable at sequence_. Cached keys are user keys without timestamp.
+  void UpdateOmniCache(ValueType value_type, const Slice& key,
+                       const Slice& value) {
+    ColumnFamilyData* cfd = cf_mems_->current();
+    if (cfd == nullptr || cfd->oc_ == nullptr) {
+      return;
+    }
+    // Keys keep their timestamp: the cache compares it against the cached
+    // version's.
+    OmniCache* oc = cfd->oc_;
+    if (omnicache_write_back_ && value_type == kTypeValue) {
+      // The cache wrote the value itself and may hold a newer one by now.
+      oc->ApplyWriteBack(key, sequence_);
+      return;
+    }
+    if (!write_after_commit_) {
+      // WritePrepared and WriteUnprepared transactions add their writes at
+      // prepare time, before they are visible; the commit does not come
+      // through here. Only drop what the cache holds for the keys.
+      if (value_type == kTypeRangeDeletion) {
+        oc->InvalidateRange(key, value, sequence_);
+      } else {
+        oc->Invalidate(key, sequence_);
+      }
+      return;
+    }
+    switch (value_type) {
+      case kTypeValue:
+        oc->ApplyPut(key, value, sequence_);
+        break;
+      case kTypeWideColumnEntity:
+        oc->ApplyPut(key, value, sequence_, true /* entity */);
+        break;
+      case kTypeDeletion:
+      case kTypeSingleDeletion:
+      case kTypeDeletionWithTimestamp:
+        oc->ApplyDelete(key, sequence_);
+        break;
+      case kTypeRangeDeletion:
+        oc->ApplyDeleteRange(key, value, sequence_);
+        break;
+      default:
+        oc->Invalidate(key, sequence_);
+        break;
+    }
+  }
+
   Status PutCFImpl(uint32_t column_family_id, const Slice& key,
                    const Slice& value, ValueType value_type,
                    const ProtectionInfoKVOS64* kv_prot_info) {
@@ -2144,6 +2205,10 @@ class MemTableInserter : public WriteBatch::Handler {
       const bool kBatchBoundary = true;
       MaybeAdvanceSeq(kBatchBoundary);
     } else if (ret_status.ok()) {
+      // With an inplace_callback the stored value is not `value`.
+      const bool oc_value_known = !moptions->inplace_update_support ||
+                                  moptions->inplace_callback == nullptr;
+      UpdateOmniCache(oc_value_known ? value_type : kTypeMerge, key, value);
       MaybeAdvanceSeq();
       CheckMemtableFull();
     }
@@ -2222,6 +2287,7 @@ class MemTableInserter : public WriteBatch::Handler {
       const bool kBatchBoundary = true;
       MaybeAdvanceSeq(kBatchBoundary);
     } else if (ret_status.ok()) {
+      UpdateOmniCache(delete_type, key, value);
       MaybeAdvanceSeq();
       CheckMemtableFull();
     }
@@ -2610,6 +2676,7 @@ class MemTableInserter : public WriteBatch::Handler {
       const bool kBatchBoundary = true;
       MaybeAdvanceSeq(kBatchBoundary);
     } else if (ret_status.ok()) {
+      UpdateOmniCache(kTypeMerge, key, value);
       MaybeAdvanceSeq();
       CheckMemtableFull();
     }
@@ -2953,6 +3020,7 @@ Status WriteBatchInternal::InsertInto(
     }
     SetSequence(w->batch, inserter.sequence());
     inserter.set_log_number_ref(w->log_ref);
+    inserter.set_omnicache_write_back(IsOmniCacheWriteBack(w->batch));
     inserter.set_prot_info(w->batch->prot_info_.get());
     w->status = w->batch->Iterate(&inserter);
     if (!w->status.ok()) {
@@ -2983,6 +3051,7 @@ Status WriteBatchInternal::InsertInto(
                             batch_per_txn, hint_per_batch);
   SetSequence(writer->batch, sequence);
   inserter.set_log_number_ref(writer->log_ref);
+  inserter.set_omnicache_write_back(IsOmniCacheWriteBack(writer->batch));
   inserter.set_prot_info(writer->batch->prot_info_.get());
   Status s = writer->batch->Iterate(&inserter);
   assert(!seq_per_batch || batch_cnt != 0);
@@ -3005,6 +3074,7 @@ Status WriteBatchInternal::InsertInto(
                             ignore_missing_column_families, log_number, db,
                             concurrent_memtable_writes, batch->prot_info_.get(),
                             has_valid_writes, seq_per_batch, batch_per_txn);
+  inserter.set_omnicache_write_back(IsOmniCacheWriteBack(batch));
   Status s = batch->Iterate(&inserter);
   if (next_seq != nullptr) {
     *next_seq = inserter.sequence();
@@ -224,6 +224,12 @@ class WriteBatchInternal {
   static void SetAsLatestPersistentState(WriteBatch* b);
   static bool IsLatestPersistentState(const WriteBatch* b);
 
+  // The batch writes dirty OmniCache entries back. Its Puts leave the
+  // cached entries alone: the cache decides itself whether an entry is
+  // clean once the write is done, see FollySkipList::CleanIfStaged().
+  static void SetAsOmniCacheWriteBack(WriteBatch* b);
+  static bool IsOmniCacheWriteBack(const WriteBatch* b);
+
   static void SetDefaultColumnFamilyTimestampSize(WriteBatch* wb,
                                                   size_t default_cf_ts_sz);
 
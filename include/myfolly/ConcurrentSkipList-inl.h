@@ -23,6 +23,7 @@
 #include <memory>
 #include <mutex>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <boost/random.hpp>
@@ -32,7 +33,7 @@
 #include <folly/Memory.h>
 #include <folly/ThreadLocal.h>
 #include <folly/synchronization/MicroSpinLock.h>
-#include <utilities/persistent_cache/lrulist.h>
+#include <memtable/clock.h>
 #include <memtable/es.h>
 
 namespace folly {
@@ -43,7 +44,7 @@ class csl_iterator;
 
 template <typename T>
 // ESElmeent
-class SkipListNode: public rocksdb::LRUElement<SkipListNode<T>> {
+class SkipListNode: public rocksdb::ClockElement<SkipListNode<T>> {
   enum : uint16_t {
     IS_HEAD_NODE = 1,
     MARKED_FOR_REMOVAL = (1 << 1),
@@ -268,6 +269,11 @@ class NodeRecycler<
         NodeType::destroy(alloc_, node);
       }
     }
+    if (retired_) {
+      for (auto& r : *retired_) {
+        r.second(r.first);
+      }
+    }
   }
 
   void add(NodeType* node) {
@@ -281,6 +287,18 @@ class NodeRecycler<
     dirty_.store(true, std::memory_order_relaxed);
   }
 
+  // Like add(), for data a node swapped out: `deleter(p)` runs once no
+  // accessor that may still see `p` is left.
+  void retire(void* p, void (*deleter)(void*)) {
+    std::lock_guard<MicroSpinLock> g(lock_);
+    if (retired_.get() == nullptr) {
+      retired_ = std::make_unique<std::vector<Retired>>();
+    }
+    retired_->emplace_back(p, deleter);
+    DCHECK_GT(refs(), 0);
+    dirty_.store(true, std::memory_order_relaxed);
+  }
+
   int addRef() { return refs_.fetch_add(1, std::memory_order_acq_rel); }
 
   int releaseRef() {
@@ -293,6 +311,7 @@ class NodeRecycler<
     }
 
     std::unique_ptr<std::vector<NodeType*>> newNodes;
+    std::unique_ptr<std::vector<Retired>> newRetired;
     int ret;
     {
       // The order at which we lock, add, swap, is very important for
@@ -305,6 +324,7 @@ class NodeRecycler<
         // so no more new nodes can be added, even though new accessors may be
         // added after this.
         newNodes.swap(nodes_);
+        newRetired.swap(retired_);
         dirty_.store(false, std::memory_order_relaxed);
       }
     }
@@ -315,6 +335,11 @@ class NodeRecycler<
         NodeType::destroy(alloc_, node);
       }
     }
+    if (newRetired) {
+      for (auto& r : *newRetired) {
+        r.second(r.first);
+      }
+    }
     return ret;
   }
 
@@ -323,9 +348,12 @@ class NodeRecycler<
  private:
   int refs() const { return refs_.load(std::memory_order_relaxed); }
 
+  typedef std::pair<void*, void (*)(void*)> Retired;
+
   std::unique_ptr<std::vector<NodeType*>> nodes_;
+  std::unique_ptr<std::vector<Retired>> retired_;
   std::atomic<int32_t> refs_; // current number of visitors to the list
-  std::atomic<bool> dirty_; // whether *nodes_ is non-empty
+  std::atomic<bool> dirty_; // whether *nodes_ or *retired_ is non-empty
   MicroSpinLock lock_; // protects access to *nodes_
   NodeAlloc alloc_;
 };
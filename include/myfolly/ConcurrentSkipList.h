@@ -171,9 +171,12 @@ class ConcurrentSkipList {
         head_(NodeType::create(recycler_.alloc(), height, value_type(), true)) {
   }
 
-  explicit ConcurrentSkipList(const T& data, int height)
-      : recycler_(),
-        head_(NodeType::create(recycler_.alloc(), height, data, true)) {}
+  explicit ConcurrentSkipList(const T& data, int height,
+                              const Comp& comp = Comp(),
+                              const NodeAlloc& alloc = NodeAlloc())
+      : recycler_(alloc),
+        head_(NodeType::create(recycler_.alloc(), height, data, true)),
+        comp_(comp) {}
 
   // Convenience function to get an Accessor to a new instance.
   static Accessor create(int height, const NodeAlloc& alloc) {
@@ -198,9 +201,10 @@ class ConcurrentSkipList {
     return std::make_shared<ConcurrentSkipList>(height);
   }
 
-  static std::shared_ptr<SkipListType> createInstance(const T& data,
-                                                      int height = 1) {
-    return std::make_shared<ConcurrentSkipList>(data, height);
+  static std::shared_ptr<SkipListType> createInstance(
+      const T& data, int height = 1, const Comp& comp = Comp(),
+      const NodeAlloc& alloc = NodeAlloc()) {
+    return std::make_shared<ConcurrentSkipList>(data, height, comp, alloc);
   }
 
   NodeType* createNode(const T& data, int height) {
@@ -210,6 +214,13 @@ class ConcurrentSkipList {
   size_t size() const { return size_.load(std::memory_order_relaxed); }
   bool empty() const { return size() == 0; }
 
+  // Frees `p` with `deleter` once every accessor that may still read it is
+  // gone, the way removed nodes are recycled. For data that a node swaps
+  // out under its readers. The caller holds an accessor.
+  void retire(void* p, void (*deleter)(void*)) {
+    recycler_.retire(p, deleter);
+  }
+
   //===================================================================
   // Below are implementation details.
   // Please see ConcurrentSkipList::Accessor for stdlib-like APIs.
@@ -228,20 +239,24 @@ class ConcurrentSkipList {
   }
 
  public:
-  static bool greater(const value_type& data, const NodeType* node) {
-    return node && Comp()(node->data(), data);
+  // The comparator may carry state (e.g. a rocksdb::Comparator), so these
+  // are members rather than static.
+  bool greater(const value_type& data, const NodeType* node) const {
+    return node && comp_(node->data(), data);
   }
 
-  static bool less(const value_type& data, const NodeType* node) {
-    return (node == nullptr) || Comp()(data, node->data());
+  bool less(const value_type& data, const NodeType* node) const {
+    return (node == nullptr) || comp_(data, node->data());
   }
 
-  static int findInsertionPoint(
+  const Comp& comparator() const { return comp_; }
+
+  int findInsertionPoint(
       NodeType* cur,
       int cur_layer,
       const value_type& data,
       NodeType* preds[],
-      NodeType* succs[]) {
+      NodeType* succs[]) const {
     int foundLayer = -1;
     NodeType* pred = cur;
     NodeType* foundNode = nullptr;
@@ -338,7 +353,7 @@ class ConcurrentSkipList {
         while (FOLLY_UNLIKELY(!nodeFound->fullyLinked())) {
         }
         if (doAppend) {
-          preds[0]->data().sentinel_ = false;
+          preds[0]->data().SetSentinel(false);
         }
         return std::make_pair(nodeFound, 0);
       }
@@ -368,7 +383,7 @@ class ConcurrentSkipList {
       }
 
       if (doAppend) {
-        pred0->data().sentinel_ = false;
+        pred0->data().SetSentinel(false);
       }
 
       newNode->setFullyLinked();
@@ -388,6 +403,13 @@ class ConcurrentSkipList {
   }
 
   bool remove(const value_type& data) {
+    return remove_if(data, [](const value_type&) { return true; });
+  }
+
+  // Same as remove(), but only if `pred` holds for the node's data. It is
+  // checked under the node's lock, right before the node is marked.
+  template <typename Pred>
+  bool remove_if(const value_type& data, Pred pred) {
     NodeType* nodeToDelete = nullptr;
     ScopedLocker nodeGuard;
     bool isMarked = false;
@@ -405,7 +427,7 @@ class ConcurrentSkipList {
         nodeToDelete = succs[layer];
         nodeHeight = nodeToDelete->height();
         nodeGuard = nodeToDelete->acquireGuard();
-        if (nodeToDelete->markedForRemoval()) {
+        if (nodeToDelete->markedForRemoval() || !pred(nodeToDelete->data())) {
           return false;
         }
         nodeToDelete->setMarkedForRemoval();
@@ -595,6 +617,7 @@ class ConcurrentSkipList {
   detail::NodeRecycler<NodeType, NodeAlloc> recycler_;
   std::atomic<NodeType*> head_;
   std::atomic<size_t> size_{0};
+  Comp comp_;
 };
 
 template <typename T, typename Comp, typename NodeAlloc, int MAX_HEIGHT>
@@ -822,6 +845,12 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Skipper {
 
   bool good() const { return succs_[0] != nullptr; }
 
+  // The node data() refers to.
+  NodeType* node() const { return succs_[0]; }
+
+  // The last node before node(), as of the last move.
+  NodeType* pred() const { return preds_[0]; }
+
   int maxLayer() const { return headHeight_ - 1; }
 
   int curHeight() const {
@@ -860,12 +889,13 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Skipper {
 
     int lyr = hints_[layer];
     int max_layer = maxLayer();
-    while (SkipListType::greater(data, succs_[lyr]) && lyr < max_layer) {
+    const SkipListType* sl = accessor_.skiplist();
+    while (sl->greater(data, succs_[lyr]) && lyr < max_layer) {
       ++lyr;
     }
     hints_[layer] = lyr; // update the hint
 
-    int foundLayer = SkipListType::findInsertionPoint(
+    int foundLayer = sl->findInsertionPoint(
         preds_[lyr], lyr, data, preds_, succs_);
     if (foundLayer < 0) {
       return false;
@@ -6,42 +6,186 @@
 #define ROCKSDB_OMNICACHE_H
 
 #include "comparator.h"
+#include "types.h"
+#include "wide_columns.h"
 #include "memtable/follyskiplist.h"
 
 namespace rocksdb {
 
+class CacheReservationManager;
+class ColumnFamilyData;
+class ColumnFamilyHandle;
+class DB;
+class OmniCacheLog;
+class OmniCacheWarmer;
+
+// The cache is ordered by the column family's comparator. With user-defined
+// timestamps it holds the latest version of each key: lookup keys (Seek) do
+// not carry a timestamp, keys passed to fills and write hooks do, and only
+// reads at the maximum timestamp may use it, see ServesReadsAt().
 struct OmniCache {
   typedef FollySkipList::Iterator OmniCacheIterator;
 
-  FollySkipList* follySkipList;
+  FollySkipList* follySkipList = nullptr;
+  // Write-back log of Put hits, see WriteBack(). Set up by SetWriteBack().
+  std::unique_ptr<OmniCacheLog> log_;
+  // Replays the ranges saved by the last close, see StartWarmUp().
+  std::unique_ptr<OmniCacheWarmer> warmer_;
+  std::atomic<bool> warm_restart_{false};
+  // Set by WriteBack(), seen by DBImpl::HoldOmniCacheWriteBacks(); cleared
+  // by DBImpl::FenceOmniCacheWriteBacks() once the dirty entries are out.
+  std::atomic<bool> write_back_pending_{false};
 
-  explicit OmniCache(const ColumnFamilyOptions& cf_options);
+  // Cache events are counted in `stats` (may be null), the DB's statistics.
+  OmniCache(const ColumnFamilyOptions& cf_options, size_t capacity,
+            Statistics* stats = nullptr);
   ~OmniCache();
-  static bool Enabled();
 
-  std::unique_ptr<OmniCacheIterator> Seek(const Slice& key);
-  std::unique_ptr<FollySkipList::Iterator> Insert(const Slice& key,
-                                                  const Slice& value);
-  std::unique_ptr<FollySkipList::Iterator> Append(const Slice& key,
-                                                  const Slice& value);
+  // Where evicted write-back entries go. Must be set before the column
+  // family is handed out to readers and writers.
+  void SetWriteBack(DB* db, uint32_t cf_id);
+  // Stops the background evictor and writes all dirty entries back, then
+  // deletes the write-back log. With `drop` (the column family is being
+  // dropped) the dirty entries are discarded instead. Called before the DB
+  // or column family goes away; the cache stays readable. On close, with
+  // omnicache_warm_restart, the cached ranges are saved for the next open.
+  void Close(bool drop = false);
 
-  std::unique_ptr<OmniCacheIterator> NewIterator();
-};
+  // Saves the keys of the cached ranges for a warm restart, see
+  // OmniCacheWarmer. Requires SetWriteBack().
+  Status SaveHotRanges();
+  // Starts reading the ranges saved by the last close of `cfd` back into
+  // the cache in the background, if omnicache_warm_restart is set and there
+  // are any.
+  void StartWarmUp(DB* db, ColumnFamilyData* cfd);
 
-struct OmniCacheEnv {
-  const size_t DEFAULT_MAXSIZE = 1ULL << 23;
-  const std::string DEFAULT_PERF_SERVER = "localhost:50051";
+  // A Put that hit the cached entry at `iter`. The value is logged first
+  // unless `opt.disableWAL`, and synced if `opt.sync`, so it survives a
+  // crash the same way a WAL write would. It reaches the LSM when the entry
+  // is evicted or the DB closes. Incomplete if the entry was removed in the
+  // meantime; the caller then writes the value through the LSM.
+  Status WriteBack(const WriteOptions& opt, OmniCacheIterator* iter,
+                   const Slice& value, SequenceNumber seq);
 
-  bool enabled = false;
-  size_t maxsize = DEFAULT_MAXSIZE;
-  bool perfEnabled = false;
-  std::string perfServer = DEFAULT_PERF_SERVER;
+  size_t GetCapacity() const;
+  void SetCapacity(size_t capacity);
+  // See ColumnFamilyOptions::omnicache_admission_min_frequency.
+  void SetAdmissionMinFrequency(uint64_t min_frequency);
+  // See ColumnFamilyOptions::omnicache_replacement_policy.
+  void SetReplacementPolicy(OmniCacheReplacementPolicy policy);
+  // See ColumnFamilyOptions::omnicache_pin_value_min_size.
+  void SetPinValueMinSize(uint64_t min_size);
+  // See ColumnFamilyOptions::omnicache_warm_restart.
+  void SetWarmRestart(bool warm_restart);
 
-  OmniCacheEnv();
+  // Hands the value of a hit to `value`: shared buffers are pinned, with a
+  // reference released by `value`'s cleanup, smaller values are copied. For
+  // an entity that is the value of its default column. `timestamp`, if
+  // given, gets the timestamp of the same version. `current` is the buffer
+  // a lookup checked, see OmniCacheIterator::Current().
+  static void PinValue(const FollyValue& current, PinnableSlice* value,
+                       std::string* timestamp = nullptr);
+  // Same for GetEntity(): the columns of an entity, or a plain value as the
+  // default column.
+  static Status PinColumns(const FollyValue& current,
+                           PinnableWideColumns* columns,
+                           std::string* timestamp = nullptr);
 
-  static OmniCacheEnv& GetOmniCacheEnv();
+  // Whether a read at timestamp `read_ts` (nullptr: none given) may be
+  // served or filled from the cache.
+  bool ServesReadsAt(const Slice* read_ts) const;
+
+  // Entries that became valid after `read_seq` are treated as misses.
+  // Readers without a snapshot pass kMaxSequenceNumber.
+  std::unique_ptr<OmniCacheIterator> Seek(const Slice& key,
+                                          SequenceNumber read_seq);
+  // Fills take the `columns` the caller read: just the default column is
+  // cached as a plain value, anything else as a serialized entity.
+  // `seq` is the sequence number the value was read at. The fill is dropped
+  // if a write newer than `seq` may have bypassed the cache.
+  std::unique_ptr<FollySkipList::Iterator> Insert(const Slice& key,
+                                                  const WideColumns& columns,
+                                                  SequenceNumber seq);
+  // Extends the range that ends at `prev_key`, the key the caller read
+  // right before `key`.
+  std::unique_ptr<FollySkipList::Iterator> Append(const Slice& prev_key,
+                                                  const Slice& key,
+                                                  const WideColumns& columns,
+                                                  SequenceNumber seq);
+  // Extends the range that starts at `next_key`, the key the caller read
+  // right after `key` in a reverse scan.
+  std::unique_ptr<FollySkipList::Iterator> Prepend(const Slice& next_key,
+                                                   const Slice& key,
+                                                   const WideColumns& columns,
+                                                   SequenceNumber seq);
+  // `key` is the first (last) key of the column family, so later
+  // SeekToFirst (SeekToLast) calls can be served from the cache.
+  std::unique_ptr<FollySkipList::Iterator> InsertFirst(
+      const Slice& key, const WideColumns& columns, SequenceNumber seq);
+  std::unique_ptr<FollySkipList::Iterator> InsertLast(
+      const Slice& key, const WideColumns& columns, SequenceNumber seq);
+  // `key` (without timestamp) was read as not found at `seq`. Later
+  // lookups of it hit a negative entry, see
+  // OmniCacheIterator::KnownAbsent(). A fill appending to `key` makes the
+  // gap up to the appended key known empty as well.
+  std::unique_ptr<FollySkipList::Iterator> InsertAbsent(const Slice& key,
+                                                        SequenceNumber seq);
+  // Batched point lookups for MultiGet. `keys` (without timestamp) are
+  // sorted by the column family's comparator; `on_hit(i, value)` is called
+  // for every cached keys[i] visible at `read_seq`, `on_absent(i)` for
+  // every keys[i] the cache knows does not exist.
+  void MultiFind(const std::vector<Slice>& keys, SequenceNumber read_seq,
+                 const std::function<void(size_t, const FollyValue&)>& on_hit,
+                 const std::function<void(size_t)>& on_absent = nullptr);
+  // Fills the results of a batch of point lookups read at `seq` at once.
+  // nullptr columns stand for a key that was not found.
+  void InsertBatch(
+      const std::vector<std::pair<Slice, const WideColumns*>>& entries,
+      SequenceNumber seq);
+  // Write path hooks, called by MemTableInserter once a write at `seq` has
+  // been added to the memtable.
+  // With `entity`, `value` is the serialized entity of a PutEntity.
+  void ApplyPut(const Slice& key, const Slice& value, SequenceNumber seq,
+                bool entity = false);
+  void ApplyDelete(const Slice& key, SequenceNumber seq);
+  void ApplyDeleteRange(const Slice& begin, const Slice& end,
+                        SequenceNumber seq);
+  // Drops `key` for writes whose resulting value is not known here.
+  void Invalidate(const Slice& key, SequenceNumber seq);
+  // A Put of the cache's own write-back, see
+  // WriteBatchInternal::SetAsOmniCacheWriteBack().
+  void ApplyWriteBack(const Slice& key, SequenceNumber seq);
+
+  // Coherence hooks for changes that bypass the write path: file ingestion
+  // and import, DeleteFilesInRange(), compaction filters. The data in
+  // [smallest, largest] (user keys, both included) changed and is visible
+  // to reads at `seq` or later; fills read before that are dropped. Call it
+  // once the new SuperVersion is installed.
+  void InvalidateRange(const Slice& smallest, const Slice& largest,
+                       SequenceNumber seq);
+  // Writes the dirty entries in [smallest, largest] back through the WAL,
+  // so that a change about to replace the span is ordered after them.
+  Status FlushDirty(const Slice& smallest, const Slice& largest);
+  // Same for every dirty entry, see DBImpl::FenceOmniCacheWriteBacks().
+  Status FlushDirty();
+
+  std::unique_ptr<OmniCacheIterator> NewIterator(SequenceNumber read_seq);
+
+  // Bytes held by keys, values and skiplist nodes, including node memory
+  // freed by evictions and kept for later fills.
+  size_t ApproximateMemoryUsage() const;
+  // Dirty entries the background evictor has yet to write back.
+  size_t EvictQueueDepth() const;
+  // Charge ApproximateMemoryUsage() against a shared cache.
+  void SetCacheReservationManager(
+      std::shared_ptr<CacheReservationManager> cache_res_mgr);
 };
 
+// Saves the keys cached by `column_family`'s OmniCache now, instead of only
+// when the DB closes, to be read back when it next opens with
+// omnicache_warm_restart. NotSupported if the column family has no cache.
+Status SaveOmniCacheHotRanges(DB* db, ColumnFamilyHandle* column_family);
+
 }  // namespace rocksdb
 
 #endif  // ROCKSDB_OMNICACHE_H
@@ -63,6 +63,15 @@ struct DbPath;
 
 using FileTypeSet = SmallEnumSet<FileType, FileType::kBlobFile>;
 
+// How the OmniCache picks the entries to evict, see
+// ColumnFamilyOptions::omnicache_replacement_policy.
+enum class OmniCacheReplacementPolicy : uint8_t {
+  kClock = 0x0,       // Evict entries not read since the last sweep
+  kFrequency = 0x1,   // Evict entries with the lowest recent read rate
+  kRoundRobin = 0x2,  // Evict in key order, ignoring reads
+  kAdaptive = 0x3,    // Switch between kClock and kFrequency online
+};
+
 struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // The function recovers options to a previous version. Only 4.6 or later
   // versions are supported.
@@ -344,6 +353,84 @@ struct ColumnFamilyOptions : public AdvancedColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   uint32_t memtable_max_range_deletions = 0;
 
+  // Byte budget of this column family's OmniCache, the range-aware result
+  // cache in front of the LSM. 0 means no cache.
+  //
+  // A Put to a cached key only updates the cache (a write-back) while the
+  // DB has no live snapshot, iterator on a cached column family or MultiGet
+  // of one; while there is any, Puts write through. Taking a snapshot first
+  // writes the pending write-backs of all column families to the LSM, an
+  // iterator or MultiGet those of its own.
+  //
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API for column families
+  // opened with an OmniCache; enabling it on other column families takes a
+  // reopen.
+  size_t omnicache_capacity = 0;
+
+  // Scan resistance for the OmniCache. Once the cache is full, a key not
+  // cached yet is only added if it was read at least this many times
+  // recently, counting the read that would add it (a TinyLFU frequency
+  // sketch; values above 16 act as 16). 2 keeps out keys read only once,
+  // such as those of a long scan. 0 adds every key read.
+  //
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API
+  uint64_t omnicache_admission_min_frequency = 0;
+
+  // Maximum number of keys one iterator may add to the OmniCache; later
+  // misses are served from the LSM without being cached. 0 means no limit.
+  //
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API; applies to iterators
+  // created afterwards.
+  uint64_t omnicache_max_iterator_fills = 0;
+
+  // Replacement policy of the OmniCache. kClock suits point reads of a
+  // shifting hot set; kFrequency keeps keys that are read over and over
+  // through scans that touch everything once; kRoundRobin is the cheapest
+  // and suits pure scans. kAdaptive remembers recently evicted keys for
+  // both kClock and kFrequency and follows whichever of the two would have
+  // missed less lately.
+  //
+  // Default: kClock
+  //
+  // Dynamically changeable through SetOptions() API
+  OmniCacheReplacementPolicy omnicache_replacement_policy =
+      OmniCacheReplacementPolicy::kClock;
+
+  // Get and MultiGet hits on OmniCache values of at least this many bytes
+  // pin the cached (immutable, reference counted) buffer in the returned
+  // PinnableSlice instead of copying the value. 0 copies every value.
+  //
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API; applies to values
+  // cached or updated afterwards.
+  uint64_t omnicache_pin_value_min_size = 0;
+
+  // Save the keys of the OmniCache's ranges when the DB closes, and read
+  // them back into the cache in the background when it opens again, so the
+  // cache does not start cold. Values are re-read from the DB, not saved.
+  // See also SaveOmniCacheHotRanges().
+  //
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool omnicache_warm_restart = false;
+
+  // Second tier for the OmniCache: clean entries it evicts are spilled here
+  // in runs of adjacent keys, and a Seek that falls into a spilled run brings
+  // the run back. Typically a CompressedSecondaryCache (see
+  // NewCompressedSecondaryCache()), which may be shared with other column
+  // families.
+  //
+  // Default: nullptr (evicted entries are dropped)
+  std::shared_ptr<SecondaryCache> omnicache_secondary_cache = nullptr;
+
   // Create ColumnFamilyOptions with default values for all fields
   ColumnFamilyOptions();
   // Create ColumnFamilyOptions from Options
@@ -526,6 +526,32 @@ enum Tickers : uint32_t {
   // Number of FS reads avoided due to scan prefetching
   PREFETCH_HITS,
 
+  // OmniCache statistics, counting the events of the DB's own caches.
+  // # of iterator Seek, SeekForPrev, SeekToFirst and SeekToLast calls served
+  // from OmniCache, and # that had to read the LSM
+  OMNICACHE_ITER_SEEK_HIT,
+  OMNICACHE_ITER_SEEK_MISS,
+  // Same for iterator Next and Prev calls
+  OMNICACHE_ITER_NEXT_HIT,
+  OMNICACHE_ITER_NEXT_MISS,
+  // # of fills refused by the admission filter
+  OMNICACHE_ADMISSION_REJECTED,
+  // # of fills dropped because the cache was over its hard limit
+  OMNICACHE_FILL_DROPPED,
+  // # of entries evicted, and # of evicted keys seen again soon enough to
+  // count as misses caused by eviction
+  OMNICACHE_EVICTED,
+  OMNICACHE_GHOST_HITS,
+  // # of dirty entries written back to the DB
+  OMNICACHE_WRITTEN_BACK,
+  // # of runs spilled to the secondary cache, brought back from it, and
+  // found gone when looked up
+  OMNICACHE_SPILLED_CHUNKS,
+  OMNICACHE_SPILL_PROMOTED_CHUNKS,
+  OMNICACHE_SPILL_LOST_CHUNKS,
+  // # of keys read back by warm restarts
+  OMNICACHE_WARM_UP_KEYS,
+
   TICKER_ENUM_MAX
 };
 
@@ -659,6 +685,10 @@ enum Histograms : uint32_t {
   // system's prefetch) from the end of SST table during block based table open
   TABLE_OPEN_PREFETCH_TAIL_READ_BYTES,
 
+  // Dirty OmniCache entries of a column family evicted but not yet written
+  // back, sampled at each write-back
+  OMNICACHE_EVICT_QUEUE_DEPTH,
+
   HISTOGRAM_ENUM_MAX
 };
 
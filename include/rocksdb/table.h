@@ -380,7 +380,20 @@ struct BlockBasedTableOptions {
   // (iii) Compatible existing behavior:
   // Same as kDisabled.
   //
-  // (e) Other CacheEntryRole
+  // (e) CacheEntryRole::kOmniCache
+  // (i) If kEnabled:
+  // Charge the bytes held by OmniCache (keys, values and skiplist nodes).
+  // When such memory exceeds the avaible space left in the block cache at
+  // some point (i.e, causing a cache full under
+  // `LRUCacheOptions::strict_capacity_limit` = true), OmniCache evicts
+  // entries instead of growing.
+  // (ii) If kDisabled:
+  // Does not charge the memory usage mentioned above; OmniCache is only
+  // bounded by its own byte budget (omnicache_capacity).
+  // (iii) Compatible existing behavior:
+  // Same as kDisabled.
+  //
+  // (f) Other CacheEntryRole
   // Not supported.
   // `Status::kNotSupported` will be returned if
   // `CacheEntryRoleOptions::charged` is set to {`kEnabled`, `kDisabled`}.
@@ -478,6 +478,10 @@ class WriteBatch : public WriteBatchBase {
   // more details.
   bool is_latest_persistent_state_ = false;
 
+  // Does the batch carry dirty OmniCache entries back to the LSM? Refer to
+  // WriteBatchInternal::SetAsOmniCacheWriteBack().
+  bool is_omnicache_write_back_ = false;
+
   // False if all keys are from column families that disable user-defined
   // timestamp OR UpdateTimestamps() has been called at least once.
   // This flag will be set to true if any of the above Put(), Delete(),
@@ -5267,6 +5267,32 @@ class TickerTypeJni {
         return -0x52;
       case ROCKSDB_NAMESPACE::Tickers::PREFETCH_HITS:
         return -0x53;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_SEEK_HIT:
+        return -0x55;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_SEEK_MISS:
+        return -0x56;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_NEXT_HIT:
+        return -0x57;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_NEXT_MISS:
+        return -0x58;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ADMISSION_REJECTED:
+        return -0x59;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_FILL_DROPPED:
+        return -0x5A;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_EVICTED:
+        return -0x5B;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_GHOST_HITS:
+        return -0x5C;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_WRITTEN_BACK:
+        return -0x5D;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_SPILLED_CHUNKS:
+        return -0x5E;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_SPILL_PROMOTED_CHUNKS:
+        return -0x5F;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_SPILL_LOST_CHUNKS:
+        return -0x60;
+      case ROCKSDB_NAMESPACE::Tickers::OMNICACHE_WARM_UP_KEYS:
+        return -0x61;
       case ROCKSDB_NAMESPACE::Tickers::TICKER_ENUM_MAX:
         // -0x54 is the max value at this time. Since these values are exposed
         // directly to Java clients, we'll keep the value the same till the next
@@ -5732,6 +5758,32 @@ class TickerTypeJni {
         // ticker value. But we aren't yet in a position to fix it since the
         // number of tickers doesn't fit in the Java representation (jbyte).
         return ROCKSDB_NAMESPACE::Tickers::TICKER_ENUM_MAX;
+      case -0x55:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_SEEK_HIT;
+      case -0x56:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_SEEK_MISS;
+      case -0x57:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_NEXT_HIT;
+      case -0x58:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ITER_NEXT_MISS;
+      case -0x59:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_ADMISSION_REJECTED;
+      case -0x5A:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_FILL_DROPPED;
+      case -0x5B:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_EVICTED;
+      case -0x5C:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_GHOST_HITS;
+      case -0x5D:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_WRITTEN_BACK;
+      case -0x5E:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_SPILLED_CHUNKS;
+      case -0x5F:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_SPILL_PROMOTED_CHUNKS;
+      case -0x60:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_SPILL_LOST_CHUNKS;
+      case -0x61:
+        return ROCKSDB_NAMESPACE::Tickers::OMNICACHE_WARM_UP_KEYS;
 
       default:
         // undefined/default
@@ -5876,6 +5928,8 @@ class HistogramTypeJni {
         return 0x3C;
       case ROCKSDB_NAMESPACE::Histograms::TABLE_OPEN_PREFETCH_TAIL_READ_BYTES:
         return 0x3D;
+      case ROCKSDB_NAMESPACE::Histograms::OMNICACHE_EVICT_QUEUE_DEPTH:
+        return 0x3F;
       case ROCKSDB_NAMESPACE::Histograms::HISTOGRAM_ENUM_MAX:
         // 0x3D for backwards compatibility on current minor version.
         return 0x3E;
@@ -6023,6 +6077,8 @@ class HistogramTypeJni {
       case 0x3E:
         // 0x1F for backwards compatibility on current minor version.
         return ROCKSDB_NAMESPACE::Histograms::HISTOGRAM_ENUM_MAX;
+      case 0x3F:
+        return ROCKSDB_NAMESPACE::Histograms::OMNICACHE_EVICT_QUEUE_DEPTH;
 
       default:
         // undefined/default
@@ -210,6 +210,11 @@ public enum HistogramType {
    */
   TABLE_OPEN_PREFETCH_TAIL_READ_BYTES((byte) 0x3D),
 
+  /**
+   * Dirty OmniCache entries evicted but not yet written back.
+   */
+  OMNICACHE_EVICT_QUEUE_DEPTH((byte) 0x3F),
+
   // 0x3E for backwards compatibility on current minor version.
   HISTOGRAM_ENUM_MAX((byte) 0x3E);
 
@@ -876,6 +876,71 @@ public enum TickerType {
 
     PREFETCH_HITS((byte) -0x53),
 
+    /**
+     * # of iterator seeks served from OmniCache.
+     */
+    OMNICACHE_ITER_SEEK_HIT((byte) -0x55),
+
+    /**
+     * # of iterator seeks that missed OmniCache.
+     */
+    OMNICACHE_ITER_SEEK_MISS((byte) -0x56),
+
+    /**
+     * # of iterator Next and Prev calls served from OmniCache.
+     */
+    OMNICACHE_ITER_NEXT_HIT((byte) -0x57),
+
+    /**
+     * # of iterator Next and Prev calls that missed OmniCache.
+     */
+    OMNICACHE_ITER_NEXT_MISS((byte) -0x58),
+
+    /**
+     * # of OmniCache fills refused by the admission filter.
+     */
+    OMNICACHE_ADMISSION_REJECTED((byte) -0x59),
+
+    /**
+     * # of OmniCache fills dropped over the hard limit.
+     */
+    OMNICACHE_FILL_DROPPED((byte) -0x5A),
+
+    /**
+     * # of OmniCache entries evicted.
+     */
+    OMNICACHE_EVICTED((byte) -0x5B),
+
+    /**
+     * # of evicted OmniCache keys looked up again soon after.
+     */
+    OMNICACHE_GHOST_HITS((byte) -0x5C),
+
+    /**
+     * # of dirty OmniCache entries written back to the DB.
+     */
+    OMNICACHE_WRITTEN_BACK((byte) -0x5D),
+
+    /**
+     * # of OmniCache runs spilled to the secondary cache.
+     */
+    OMNICACHE_SPILLED_CHUNKS((byte) -0x5E),
+
+    /**
+     * # of OmniCache runs brought back from the secondary cache.
+     */
+    OMNICACHE_SPILL_PROMOTED_CHUNKS((byte) -0x5F),
+
+    /**
+     * # of spilled OmniCache runs found gone when looked up.
+     */
+    OMNICACHE_SPILL_LOST_CHUNKS((byte) -0x60),
+
+    /**
+     * # of keys read back by OmniCache warm restarts.
+     */
+    OMNICACHE_WARM_UP_KEYS((byte) -0x61),
+
     TICKER_ENUM_MAX((byte) -0x54);
 
     private final byte value;
@@ -0,0 +1,129 @@
+#ifndef ROCKSDB_ADAPTIVE_POLICY_H
+#define ROCKSDB_ADAPTIVE_POLICY_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "rocksdb/options.h"
+
+namespace rocksdb {
+
+// Ghost list
+//
+// Hashes of recently evicted keys. Direct-mapped on the hash: a newer ghost
+// overwrites an older one in its slot, so once the list holds about as many
+// keys as it has slots it forgets them in roughly FIFO order. Lock free; a
+// lost race only loses a ghost.
+class GhostList {
+ public:
+  // `capacity` slots, rounded up to a power of two.
+  explicit GhostList(size_t capacity) {
+    size_t slots = 64;
+    while (slots < capacity) {
+      slots <<= 1;
+    }
+    mask_ = slots - 1;
+    slots_.reset(new std::atomic<uint64_t>[slots]);
+    for (size_t i = 0; i < slots; ++i) {
+      slots_[i].store(kEmpty, std::memory_order_relaxed);
+    }
+  }
+
+  void Add(uint64_t hash) {
+    slots_[hash & mask_].store(Tag(hash), std::memory_order_relaxed);
+  }
+
+  // Whether `hash` is a ghost. It is dropped, so each one counts once.
+  bool Take(uint64_t hash) {
+    uint64_t expected = Tag(hash);
+    return slots_[hash & mask_].compare_exchange_strong(
+        expected, kEmpty, std::memory_order_relaxed);
+  }
+
+  size_t ApproximateMemoryUsage() const {
+    return (mask_ + 1) * sizeof(uint64_t);
+  }
+
+ private:
+  static const uint64_t kEmpty = 0;
+
+  static uint64_t Tag(uint64_t hash) { return hash | 1; }
+
+  size_t mask_;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+// Adaptive replacement
+//
+// Picks kClock or kFrequency for each sweep, after ARC: both policies keep a
+// ghost list of the keys they evicted, and a key filled again while it is
+// still a ghost is a miss that the policy evicting it caused. Every such
+// miss moves a bias towards the other policy, and the sign of the bias
+// picks the next one. Scans flushing out a hot set shift it to kFrequency,
+// a hot set moving on shifts it back to kClock. The bias is bounded, so
+// following a shift takes at most kMaxBias misses however long the
+// previous phase lasted.
+class AdaptivePolicy {
+ public:
+  static constexpr int64_t kMaxBias = 64;
+
+  // Ghost lists of about `capacity` keys each, the number of keys cached.
+  explicit AdaptivePolicy(size_t capacity)
+      : recency_ghosts_(capacity), frequency_ghosts_(capacity) {}
+
+  OmniCacheReplacementPolicy Current() const {
+    return bias_.load(std::memory_order_relaxed) >= 0
+               ? OmniCacheReplacementPolicy::kClock
+               : OmniCacheReplacementPolicy::kFrequency;
+  }
+
+  // A node picked by `policy` (as returned by Current()) was evicted.
+  void OnEvict(uint64_t hash, OmniCacheReplacementPolicy policy) {
+    if (policy == OmniCacheReplacementPolicy::kFrequency) {
+      frequency_ghosts_.Add(hash);
+    } else {
+      recency_ghosts_.Add(hash);
+    }
+  }
+
+  // A key not cached was filled. Returns whether it was a ghost.
+  bool OnFill(uint64_t hash) {
+    if (recency_ghosts_.Take(hash)) {
+      Shift(-1);
+      return true;
+    }
+    if (frequency_ghosts_.Take(hash)) {
+      Shift(1);
+      return true;
+    }
+    return false;
+  }
+
+  size_t ApproximateMemoryUsage() const {
+    return recency_ghosts_.ApproximateMemoryUsage() +
+           frequency_ghosts_.ApproximateMemoryUsage();
+  }
+
+ private:
+  void Shift(int64_t delta) {
+    int64_t bias = bias_.load(std::memory_order_relaxed);
+    int64_t next;
+    do {
+      next = std::max(-kMaxBias, std::min(kMaxBias, bias + delta));
+    } while (next != bias &&
+             !bias_.compare_exchange_weak(bias, next,
+                                          std::memory_order_relaxed));
+  }
+
+  GhostList recency_ghosts_;
+  GhostList frequency_ghosts_;
+  // >= 0 picks kClock.
+  std::atomic<int64_t> bias_{0};
+};
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_ADAPTIVE_POLICY_H
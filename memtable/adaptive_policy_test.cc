@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include "memtable/adaptive_policy.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(AdaptivePolicyTest, GhostHits) {
+  AdaptivePolicy adaptive(1024);
+  ASSERT_EQ(adaptive.Current(), OmniCacheReplacementPolicy::kClock);
+
+  // A key evicted by kClock is read again.
+  adaptive.OnEvict(1, OmniCacheReplacementPolicy::kClock);
+  adaptive.OnEvict(2, OmniCacheReplacementPolicy::kClock);
+  ASSERT_FALSE(adaptive.OnFill(3));
+  ASSERT_TRUE(adaptive.OnFill(1));
+  // Each ghost counts once.
+  ASSERT_FALSE(adaptive.OnFill(1));
+  ASSERT_EQ(adaptive.Current(), OmniCacheReplacementPolicy::kFrequency);
+
+  adaptive.OnEvict(100, OmniCacheReplacementPolicy::kFrequency);
+  ASSERT_TRUE(adaptive.OnFill(100));
+  ASSERT_EQ(adaptive.Current(), OmniCacheReplacementPolicy::kClock);
+
+  // The bias is bounded: a long kFrequency phase is undone quickly.
+  for (uint64_t h = 1000; h < 1000 + 4 * AdaptivePolicy::kMaxBias; ++h) {
+    adaptive.OnEvict(h, OmniCacheReplacementPolicy::kClock);
+    ASSERT_TRUE(adaptive.OnFill(h));
+  }
+  for (uint64_t h = 0; h < AdaptivePolicy::kMaxBias; ++h) {
+    adaptive.OnEvict(h << 20, OmniCacheReplacementPolicy::kFrequency);
+    ASSERT_TRUE(adaptive.OnFill(h << 20));
+  }
+  ASSERT_EQ(adaptive.Current(), OmniCacheReplacementPolicy::kClock);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
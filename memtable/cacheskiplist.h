@@ -10,9 +10,9 @@
 #include <thread>
 #include <vector>
 
+#include "monitoring/perf_counter.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/debug.h"
-#include "rocksdb/perf_data_client.h"
 
 namespace rocksdb {
 
@@ -118,9 +118,9 @@ struct CacheSkipListStats {
 
 #define PERF_COUNTER_PREFIX "/oc/skiplist/"
 
-  PERFCOUNTER_DEF_T(std::atomic<size_t>, PERF_COUNTER_PREFIX, length_);
-  PERFCOUNTER_DEF_T(std::atomic<size_t>, PERF_COUNTER_PREFIX, keySize_);
-  PERFCOUNTER_DEF_T(std::atomic<size_t>, PERF_COUNTER_PREFIX, valueSize_);
+  PERFCOUNTER_DEF_T(size_t, PERF_COUNTER_PREFIX, length_);
+  PERFCOUNTER_DEF_T(size_t, PERF_COUNTER_PREFIX, keySize_);
+  PERFCOUNTER_DEF_T(size_t, PERF_COUNTER_PREFIX, valueSize_);
   PERFCOUNTER_DEF(PERF_COUNTER_PREFIX, insertCount_);
   PERFCOUNTER_DEF(PERF_COUNTER_PREFIX, appendCount_);
   PERFCOUNTER_DEF(PERF_COUNTER_PREFIX, evictCount_);
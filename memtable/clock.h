@@ -0,0 +1,167 @@
+#ifndef ROCKSDB_CLOCK_H
+#define ROCKSDB_CLOCK_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+
+namespace rocksdb {
+
+// CLOCK element definition
+//
+// Any object that needs to be part of the CLOCK algorithm should extend this
+// class. A hit only updates one byte of the node, there is no list to
+// maintain: a reference bit for recency, and a small hit count that each
+// sweep pass halves, i.e. the single exponential smoothing of es.h with
+// alpha 1/2, for frequency.
+template <class T>
+struct ClockElement {
+  static const uint8_t kReferenced = 0x80;
+  static const uint8_t kMaxFrequency = 0x0f;
+
+  explicit ClockElement() : clock_ref_(0) {}
+
+  // Called on every cache hit. Skip the store once both the bit and the
+  // count are saturated, so hot nodes do not bounce their cache line
+  // between readers.
+  inline void Touch() {
+    const uint8_t ref = clock_ref_.load(std::memory_order_relaxed);
+    const uint8_t frequency = ref & kMaxFrequency;
+    if (ref != (kReferenced | kMaxFrequency)) {
+      clock_ref_.store(
+          kReferenced | (frequency < kMaxFrequency ? frequency + 1 : frequency),
+          std::memory_order_relaxed);
+    }
+  }
+
+  // One sweep pass: clear the bit, halve the count and return both as they
+  // were before.
+  inline uint8_t Age() {
+    const uint8_t ref = clock_ref_.load(std::memory_order_relaxed);
+    if (ref != 0) {
+      clock_ref_.store((ref & kMaxFrequency) / 2, std::memory_order_relaxed);
+    }
+    return ref;
+  }
+
+  std::atomic<uint8_t> clock_ref_;
+};
+
+// Sharded CLOCK sweeper
+//
+// The level-0 list of the skiplist is the clock itself, so victims come out
+// in key order and a sweep evicts runs of adjacent keys instead of punching
+// holes all over the cached ranges. The replacement policy only decides
+// which of the nodes passed over are victims:
+//  - kClock: nodes not read since the previous pass (reference bit clear),
+//  - kFrequency: nodes whose smoothed hit count has decayed to zero,
+//  - kRoundRobin: every node, whatever its reads.
+// Every policy ages the nodes it passes over the same way, so switching
+// policies keeps the read history. Each shard owns a hand (the key it
+// stopped at) behind its own mutex. Evicting threads start at a shard picked
+// from their thread id and never wait: a busy shard is skipped, and if all
+// of them are busy someone else is already evicting.
+template <class SkipListType>
+class ClockSweeper {
+ public:
+  typedef typename SkipListType::NodeType NodeType;
+  typedef typename SkipListType::value_type ValueType;
+
+  static const size_t kNumShards = 16;
+
+  // Collect up to `max_victims` nodes that `policy` would evict; it must
+  // not be kAdaptive, the caller resolves that. The caller must hold an
+  // accessor on `sl` for as long as it uses the returned nodes.
+  void Sweep(SkipListType* sl, size_t max_victims,
+             std::vector<NodeType*>* victims,
+             OmniCacheReplacementPolicy policy =
+                 OmniCacheReplacementPolicy::kClock) {
+    const size_t start =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) % kNumShards;
+    for (size_t i = 0; i < kNumShards; ++i) {
+      Shard& shard = shards_[(start + i) % kNumShards];
+      std::unique_lock<std::mutex> lock(shard.mutex_, std::try_to_lock);
+      if (lock.owns_lock()) {
+        SweepShard(sl, &shard, max_victims, policy, victims);
+        return;
+      }
+    }
+  }
+
+ private:
+  struct Shard {
+    std::mutex mutex_;
+    std::string hand_;
+  };
+
+  // Whether a node whose metadata was `ref` before this pass is a victim.
+  static bool IsVictim(uint8_t ref, OmniCacheReplacementPolicy policy) {
+    switch (policy) {
+      case OmniCacheReplacementPolicy::kFrequency:
+        return (ref & NodeType::kMaxFrequency) == 0;
+      case OmniCacheReplacementPolicy::kRoundRobin:
+        return true;
+      default:
+        return (ref & NodeType::kReferenced) == 0;
+    }
+  }
+
+  // Passes after which every node is a victim unless read in between.
+  static size_t MaxPasses(OmniCacheReplacementPolicy policy) {
+    switch (policy) {
+      case OmniCacheReplacementPolicy::kFrequency:
+        // 15 -> 7 -> 3 -> 1 -> 0.
+        return 5;
+      case OmniCacheReplacementPolicy::kRoundRobin:
+        return 1;
+      default:
+        return 2;
+    }
+  }
+
+  void SweepShard(SkipListType* sl, Shard* shard, size_t max_victims,
+                  OmniCacheReplacementPolicy policy,
+                  std::vector<NodeType*>* victims) {
+    const size_t max_scan = MaxPasses(policy) * sl->size() + 1;
+    NodeType* head = sl->head_.load(std::memory_order_acquire);
+    NodeType* node = head->next();
+    if (!shard->hand_.empty()) {
+      node = sl->lower_bound(ValueType(Slice(shard->hand_), Slice()));
+    }
+    bool wrapped = false;
+    for (size_t scanned = 0;
+         victims->size() < max_victims && scanned < max_scan;) {
+      // The tail node is the only one without a successor.
+      if (node == nullptr || node->skip(0) == nullptr) {
+        if (wrapped) {
+          break;
+        }
+        wrapped = true;
+        node = head->next();
+        continue;
+      }
+      ++scanned;
+      if (!node->markedForRemoval() && IsVictim(node->Age(), policy)) {
+        victims->push_back(node);
+      }
+      node = node->next();
+    }
+    if (node == nullptr || node->skip(0) == nullptr) {
+      shard->hand_.clear();
+    } else {
+      shard->hand_ = node->data().Key();
+    }
+  }
+
+  Shard shards_[kNumShards];
+};
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_CLOCK_H
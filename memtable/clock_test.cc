@@ -0,0 +1,109 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "memtable/clock.h"
+#include "memtable/follyskiplist.h"
+#include "rocksdb/comparator.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+class ClockSweeperTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    skiplist = new FollySkipList(32, BytewiseComparator(), 1ULL << 20);
+  }
+
+  void TearDown() override { delete skiplist; }
+
+  void InsertRange(int x, int count) {
+    for (int i = x; i < x + count; ++i) {
+      auto s = std::to_string(i);
+      if (i == x) {
+        skiplist->Insert(s, s, 0);
+      } else {
+        skiplist->Append(s, s, 0);
+      }
+    }
+  }
+
+  FollySkipList* skiplist;
+};
+
+TEST_F(ClockSweeperTest, ClockSweep) {
+  typedef FollySkipList::SkipListType SkipListType;
+  InsertRange(10, 10);
+
+  SkipListType::Accessor accessor(skiplist->skiplist_);
+  ClockSweeper<SkipListType> clock;
+  std::vector<FollySkipList::NodeType*> victims;
+  auto keys = [&victims]() {
+    std::vector<std::string> xs;
+    for (auto* victim : victims) {
+      xs.push_back(victim->data().Key());
+    }
+    return xs;
+  };
+
+  // Fresh nodes are referenced: the first pass only clears their bits, and
+  // victims then come out in key order.
+  clock.Sweep(skiplist->skiplist_.get(), 3, &victims);
+  ASSERT_EQ(keys(), std::vector<std::string>({"10", "11", "12"}));
+
+  // The hand resumes where it stopped and gives "14" a second chance.
+  skiplist->Seek("14");
+  victims.clear();
+  clock.Sweep(skiplist->skiplist_.get(), 3, &victims);
+  ASSERT_EQ(keys(), std::vector<std::string>({"13", "15", "16"}));
+}
+
+TEST_F(ClockSweeperTest, ReplacementPolicies) {
+  typedef FollySkipList::SkipListType SkipListType;
+  InsertRange(10, 4);
+
+  SkipListType::Accessor accessor(skiplist->skiplist_);
+  // "11" is read over and over.
+  for (int i = 0; i < 3; ++i) {
+    skiplist->Seek("11");
+  }
+  ClockSweeper<SkipListType> clock;
+  std::vector<FollySkipList::NodeType*> victims;
+  auto keys = [&victims]() {
+    std::vector<std::string> xs;
+    for (auto* victim : victims) {
+      xs.push_back(victim->data().Key());
+    }
+    return xs;
+  };
+
+  // Unlike the reference bit, its hit count outlasts a second pass.
+  clock.Sweep(skiplist->skiplist_.get(), 3, &victims,
+              OmniCacheReplacementPolicy::kFrequency);
+  ASSERT_EQ(keys(), std::vector<std::string>({"10", "12", "13"}));
+  for (const auto& key : keys()) {
+    skiplist->Remove(key);
+  }
+
+  // Without reads in between, it goes on the next pass.
+  victims.clear();
+  clock.Sweep(skiplist->skiplist_.get(), 3, &victims,
+              OmniCacheReplacementPolicy::kFrequency);
+  ASSERT_EQ(keys(), std::vector<std::string>({"11"}));
+  skiplist->Remove("11");
+
+  // Round robin ignores reads.
+  InsertRange(20, 2);
+  skiplist->Seek("20");
+  victims.clear();
+  clock.Sweep(skiplist->skiplist_.get(), 2, &victims,
+              OmniCacheReplacementPolicy::kRoundRobin);
+  ASSERT_EQ(keys(), std::vector<std::string>({"20", "21"}));
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,14 +1,38 @@
 #ifndef ROCKSDB_FOLLYSKIPLIST_H
 #define ROCKSDB_FOLLYSKIPLIST_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+
 #include "myfolly/ConcurrentSkipList.h"
-#include "folly/concurrency/container/LockFreeRingBuffer.h"
 #include "rocksdb/comparator.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/db.h"
-#include "utilities/persistent_cache/lrulist.h"
+#include "memtable/adaptive_policy.h"
+#include "memtable/clock.h"
 #include "memtable/es.h"
+#include "memtable/frequency_sketch.h"
+#include "memtable/point_index.h"
+#include "memtable/slab_allocator.h"
+#include "memtable/spill_tier.h"
+#include "monitoring/perf_counter.h"
+#include "cache/cache_reservation_manager.h"
 #include "cache/lru_cache.h"
+#include "db/dbformat.h"
+#include "db/write_batch_internal.h"
+#include "logging/logging.h"
 
 #define SENTINEL ((char*)0xdeadbeefdeadbeef)
 #define SENTINEL_STR "sentinel"
@@ -18,161 +42,428 @@ namespace rocksdb {
 
 struct FollyKVComparator;
 
+class FollyValue;
+
+struct FollyValueUnref {
+  void operator()(const FollyValue* v) const;
+};
+typedef std::unique_ptr<const FollyValue, FollyValueUnref> FollyValueHandle;
+
+/**
+ * FollyValue
+ *
+ * An immutable value buffer. A cached value is never written to: a write
+ * swaps in a new buffer and retires the old one to the skiplist's recycler,
+ * which drops it once no accessor that may still read it is left, like a
+ * removed node (see FollySkipList::SetValue()). Readers holding an accessor
+ * thus use a value without locks or copies; a reader keeping it beyond its
+ * accessor takes a reference.
+ *
+ * Whatever describes the value lives in the buffer too, so a reader always
+ * sees a value together with its own kind and version.
+ */
+class FollyValue {
+ public:
+  // One reference, held by the entry. Hits may pin a `pinnable` buffer
+  // instead of copying it. `ts` is the timestamp of the cached version, if
+  // the column family uses them.
+  static FollyValue* New(const Slice& value, bool pinnable, bool entity,
+                         bool absent, const Slice& ts) {
+    assert(ts.size() <= std::numeric_limits<uint16_t>::max());
+    void* mem = ::operator new(sizeof(FollyValue) + ts.size() + value.size());
+    FollyValue* v = new (mem) FollyValue(value.size(), pinnable, entity,
+                                         absent, ts.size());
+    memcpy(v->Buf(), ts.data(), ts.size());
+    memcpy(v->Buf() + ts.size(), value.data(), value.size());
+    return v;
+  }
+
+  // Stands in for the null buffer of an entry: an empty plain value without
+  // timestamp. Never freed.
+  static const FollyValue* Empty() {
+    static const FollyValue empty(0, false, false, false, 0);
+    return &empty;
+  }
+
+  void Ref() const { refs_.fetch_add(1, std::memory_order_relaxed); }
+  void Unref() const {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      this->~FollyValue();
+      ::operator delete(const_cast<FollyValue*>(this));
+    }
+  }
+  // Recycler callback for a retired buffer.
+  static void Release(void* v) { static_cast<FollyValue*>(v)->Unref(); }
+
+  Slice Value() const {
+    return Slice(const_cast<FollyValue*>(this)->Buf() + ts_size_, size_);
+  }
+  bool Pinnable() const { return pinnable_; }
+  // A wide-column entity in WideColumnSerialization format, not a plain
+  // value.
+  bool Entity() const { return entity_; }
+  // Of a negative entry: the key was read as not existing. It has no value
+  // and is never handed to readers, but like any entry it may own the gap
+  // after it.
+  bool Absent() const { return absent_; }
+  // Timestamp of the cached version, empty without user-defined timestamps.
+  Slice Timestamp() const {
+    return Slice(const_cast<FollyValue*>(this)->Buf(), ts_size_);
+  }
+
+  // A reference to this buffer if hits may pin it, nullptr if they copy the
+  // value. The caller holds an accessor.
+  FollyValueHandle Share() const;
+  // A reference to this buffer regardless, for a reader that keeps using
+  // it after letting go of its accessor.
+  FollyValueHandle Hold() const;
+
+ private:
+  FollyValue(size_t size, bool pinnable, bool entity, bool absent,
+             size_t ts_size)
+      : refs_(1),
+        pinnable_(pinnable),
+        entity_(entity),
+        absent_(absent),
+        ts_size_(static_cast<uint16_t>(ts_size)),
+        size_(size) {}
+  // The timestamp and then the value follow the header in the same
+  // allocation.
+  char* Buf() { return reinterpret_cast<char*>(this + 1); }
+
+  mutable std::atomic<uint32_t> refs_;
+  bool pinnable_ : 1;
+  bool entity_ : 1;
+  bool absent_ : 1;
+  uint16_t ts_size_;
+  size_t size_;
+};
+
+inline void FollyValueUnref::operator()(const FollyValue* v) const {
+  v->Unref();
+}
+
+inline FollyValueHandle FollyValue::Share() const {
+  return pinnable_ ? Hold() : nullptr;
+}
+
+inline FollyValueHandle FollyValue::Hold() const {
+  Ref();
+  return FollyValueHandle(this);
+}
+
+// The buffer of an entry: nullptr for an empty value. Copies of an entry
+// share the buffer.
+class FollyValueSlot {
+ public:
+  FollyValueSlot() : v_(nullptr) {}
+  FollyValueSlot(const FollyValueSlot& other) : v_(other.Share()) {}
+  FollyValueSlot& operator=(const FollyValueSlot& other) {
+    if (this != &other) {
+      Drop(v_.exchange(other.Share(), std::memory_order_acq_rel));
+    }
+    return *this;
+  }
+  FollyValueSlot(FollyValueSlot&& other) noexcept
+      : v_(other.v_.exchange(nullptr, std::memory_order_relaxed)) {}
+  FollyValueSlot& operator=(FollyValueSlot&& other) noexcept {
+    if (this != &other) {
+      Drop(v_.exchange(other.v_.exchange(nullptr, std::memory_order_relaxed),
+                       std::memory_order_acq_rel));
+    }
+    return *this;
+  }
+  ~FollyValueSlot() { Drop(v_.load(std::memory_order_relaxed)); }
+
+  // Never nullptr, see FollyValue::Empty().
+  const FollyValue* Load() const {
+    const FollyValue* v = v_.load(std::memory_order_acquire);
+    return v != nullptr ? v : FollyValue::Empty();
+  }
+  // Returns the old buffer, which readers may still be using.
+  FollyValue* Exchange(FollyValue* v) {
+    return v_.exchange(v, std::memory_order_acq_rel);
+  }
+
+ private:
+  FollyValue* Share() const {
+    FollyValue* v = v_.load(std::memory_order_acquire);
+    if (v != nullptr) {
+      v->Ref();
+    }
+    return v;
+  }
+  static void Drop(const FollyValue* v) {
+    if (v != nullptr) {
+      v->Unref();
+    }
+  }
+
+  std::atomic<FollyValue*> v_;
+};
+
 /**
  * FollyKV
  */
 struct FollyKV {
   friend std::ostream& operator<<(std::ostream& os, const FollyKV& node) {
     os << "NodePtr: " << &node << " Key: " << node.Key()
-       << " Value: " << node.Value();
-    if (node.sentinel_) {
+       << " Value: " << node.Value().ToString();
+    if (node.IsSentinel()) {
       os << "(Sentinel)";
     }
+    if (node.Absent()) {
+      os << "(Absent)";
+    }
     return os;
   }
+  // Set once, readers use it without locks. For column families with
+  // user-defined timestamps, the key of a cached entry carries the timestamp
+  // of the version the node was added for (has_ts_), see Timestamp() for
+  // the cached one; lookup keys do not.
   std::string key_;
-  std::string value_;
-  bool sentinel_;
-  bool dirty_;
-
-  FollyKV() : key_(), value_(), sentinel_(true), dirty_(false) {}
+  // Swapped, never written to, see FollyValue.
+  FollyValueSlot value_;
+  // Flags and versions below are changed by writers while readers use the
+  // entry, see the accessors.
+  std::atomic<bool> sentinel_;
+  std::atomic<bool> dirty_;
+  // Sorts after every key, see FollyKVComparator.
+  bool tail_;
+  bool has_ts_;
+  // prefix_ holds the first 8 bytes of the user key, big-endian and zero
+  // padded, if the comparator orders keys bytewise.
+  bool abbreviated_;
+  uint64_t prefix_;
+  // Sequence number from which this entry is valid. It covers both the value
+  // and, unless this is a sentinel, the gap up to the next node. A reader at
+  // sequence `s` may only use the entry if seq_ <= s. Writers raise it
+  // before they swap in the buffer of a newer version, so a reader that
+  // takes the buffer first and checks seq_ afterwards never pairs a new
+  // value with an old sequence number, see Iterator::Capture().
+  std::atomic<SequenceNumber> seq_;
+  // OmniCacheLog file holding the latest write-back value of a dirty entry,
+  // 0 if it was not logged.
+  std::atomic<uint64_t> log_number_;
+
+  FollyKV() : FollyKV(std::string(), std::string(), true) {}
   FollyKV(const Slice& key, const Slice& value)
-      : key_(key.data(), key.size()),
-        value_(value.data(), value.size()),
-        sentinel_(false), dirty_(false) {}
+      : FollyKV(key, value, false, 0) {}
   FollyKV(const Slice& key, const Slice& value, bool sentinel)
+      : FollyKV(key, value, sentinel, 0) {}
+  FollyKV(const Slice& key, const Slice& value, bool sentinel,
+          SequenceNumber seq)
       : key_(key.data(), key.size()),
-        value_(value.data(), value.size()),
-        sentinel_(sentinel), dirty_(false) {}
+        sentinel_(sentinel), dirty_(false), tail_(false), has_ts_(false),
+        abbreviated_(false), prefix_(0), seq_(seq), log_number_(0) {
+    ExchangeValue(value, 0);
+  }
   FollyKV(const std::string& key, const std::string& value, bool sentinel)
-      : key_(key), value_(value), sentinel_(sentinel), dirty_(false) {}
+      : FollyKV(Slice(key), Slice(value), sentinel, 0) {}
 
-  bool IsSentinel() const { return this->sentinel_; }
+  bool IsSentinel() const {
+    return sentinel_.load(std::memory_order_acquire);
+  }
+  void SetSentinel(bool sentinel) {
+    sentinel_.store(sentinel, std::memory_order_release);
+  }
+  SequenceNumber Seq() const { return seq_.load(std::memory_order_acquire); }
+  bool VisibleAt(SequenceNumber seq) const { return Seq() <= seq; }
+  // seq_ only moves forward.
+  void RaiseSeq(SequenceNumber seq) {
+    SequenceNumber cur = seq_.load(std::memory_order_relaxed);
+    while (cur < seq && !seq_.compare_exchange_weak(
+                            cur, seq, std::memory_order_release,
+                            std::memory_order_relaxed)) {
+    }
+  }
+  bool Dirty() const { return dirty_.load(std::memory_order_acquire); }
+  void SetDirty(bool dirty) {
+    dirty_.store(dirty, std::memory_order_release);
+  }
+  uint64_t LogNumber() const {
+    return log_number_.load(std::memory_order_acquire);
+  }
+  void SetLogNumber(uint64_t log_number) {
+    log_number_.store(log_number, std::memory_order_release);
+  }
 
-  std::string& Key() { return this->key_; }
-  std::string& Value() { return this->value_; }
   const std::string& Key() const { return this->key_; }
-  const std::string& Value() const { return this->value_; }
+  // The buffer in place, valid while the caller holds an accessor. A reader
+  // that needs more than one of the accessors below takes it once.
+  const FollyValue& Current() const { return *value_.Load(); }
+  Slice Value() const { return Current().Value(); }
+  bool Entity() const { return Current().Entity(); }
+  bool Absent() const { return Current().Absent(); }
+  Slice Timestamp() const { return Current().Timestamp(); }
+
+  // Swaps in a new buffer holding `value` and returns the old one. Values of
+  // at least `pin_min_size` bytes (0: none) may be pinned by hits. `value`
+  // is ignored if `absent`.
+  FollyValue* ExchangeValue(const Slice& value, size_t pin_min_size,
+                            bool entity = false, bool absent = false,
+                            const Slice& ts = Slice()) {
+    const Slice v = absent ? Slice() : value;
+    FollyValue* buf = nullptr;
+    if (!v.empty() || entity || absent || !ts.empty()) {
+      buf = FollyValue::New(v, pin_min_size > 0 && v.size() >= pin_min_size,
+                            entity, absent, ts);
+    }
+    return value_.Exchange(buf);
+  }
+
+  // A reference to the value's buffer if hits may pin it, nullptr if they
+  // copy the value. The caller holds an accessor.
+  FollyValueHandle SharedValue() const { return Current().Share(); }
 
-  // Copy ctors
+  // Probes and nodes being built are copied, never an entry readers use.
   FollyKV(const FollyKV& other)
-      : key_(other.key_), value_(other.value_), sentinel_(other.sentinel_), dirty_(other.dirty_) {}
-  // copy assignment
+      : key_(other.key_),
+        value_(other.value_),
+        sentinel_(other.IsSentinel()),
+        dirty_(other.Dirty()),
+        tail_(other.tail_),
+        has_ts_(other.has_ts_),
+        abbreviated_(other.abbreviated_),
+        prefix_(other.prefix_),
+        seq_(other.Seq()),
+        log_number_(other.LogNumber()) {}
   FollyKV& operator=(const FollyKV& other) {
     if (this != &other) {
       key_ = other.key_;
       value_ = other.value_;
-      sentinel_ = other.sentinel_;
-      dirty_ = other.dirty_;
+      CopyFlags(other);
     }
     return *this;
   }
-  // move ctor
   FollyKV(FollyKV&& other) noexcept
       : key_(std::move(other.key_)),
         value_(std::move(other.value_)),
-        sentinel_(other.sentinel_), dirty_(other.dirty_) {}
-  // move assignment
+        sentinel_(other.IsSentinel()),
+        dirty_(other.Dirty()),
+        tail_(other.tail_),
+        has_ts_(other.has_ts_),
+        abbreviated_(other.abbreviated_),
+        prefix_(other.prefix_),
+        seq_(other.Seq()),
+        log_number_(other.LogNumber()) {}
   FollyKV& operator=(FollyKV&& other) noexcept {
     if (this != &other) {
       key_ = std::move(other.key_);
       value_ = std::move(other.value_);
-      sentinel_ = other.sentinel_;
-      dirty_ = other.dirty_;
+      CopyFlags(other);
     }
     return *this;
   }
 
-};  // struct FollyKV
-
-extern DB* pDBImpl;
-
-
-template <class T>
-struct RRList {
-  typedef folly::ConcurrentSkipList<FollyKV, FollyKVComparator>::NodeType NodeType;
- public:
-  RRList(NodeType* head) : head_(head), ptr_(head) {}
-
-  NodeType* head_;
-  NodeType* ptr_;
-  inline void Push(T* const t) { }
-  inline void Unlink(T* const t) { }
-
-  inline T* Pop() {
-    if (ptr_ == nullptr) {
-      ptr_ = head_;
-    }
-    if (ptr_ == head_) {
-      ptr_ = ptr_->next();
-    }
-    NodeType* ret = ptr_;
-    ptr_ = ptr_->next();
-
-    static uint64_t counter = 0;
-    if (counter ++ % 1048576 == 0) {
-      fprintf(stderr, "poped for %lu times\n", counter);
-    }
-
-    return ret;
+ private:
+  void CopyFlags(const FollyKV& other) {
+    SetSentinel(other.IsSentinel());
+    SetDirty(other.Dirty());
+    tail_ = other.tail_;
+    has_ts_ = other.has_ts_;
+    abbreviated_ = other.abbreviated_;
+    prefix_ = other.prefix_;
+    seq_.store(other.Seq(), std::memory_order_release);
+    SetLogNumber(other.LogNumber());
   }
+};  // struct FollyKV
 
-  inline void Touch(T* const t) {}
-
-  inline bool IsEmpty() const { return false; }
-
+// A read result for FollySkipList::InsertBatch(). With `entity`, `value`
+// is a serialized wide-column entity.
+struct FollyFill {
+  Slice key;
+  Slice value;
+  bool entity = false;
+  // `key` was not found; `value` is ignored.
+  bool absent = false;
 };
-extern LRUList<folly::ConcurrentSkipList<FollyKV, FollyKVComparator>::NodeType> *lru_list;
 
 /**
  * FollyKVComparator
+ *
+ * Orders entries like the column family's comparator, without timestamps:
+ * the cache holds one entry per user key. Abbreviated keys are compared by
+ * prefix first, so most comparisons never reach the key strings.
  */
 struct FollyKVComparator {
  public:
-  bool operator()(const FollyKV& node, const FollyKV& data) const {
-    return node.Key() < data.Key();
+  FollyKVComparator() : FollyKVComparator(BytewiseComparator()) {}
+  explicit FollyKVComparator(const Comparator* ucmp)
+      : ucmp_(ucmp),
+        ts_sz_(ucmp->timestamp_size()),
+        order_(ucmp == BytewiseComparator() ||
+                       ucmp == BytewiseComparatorWithU64Ts()
+                   ? kBytewise
+                   : ucmp == ReverseBytewiseComparator() ||
+                             ucmp == ReverseBytewiseComparatorWithU64Ts()
+                         ? kReverseBytewise
+                         : kOther) {}
+
+  bool operator()(const FollyKV& a, const FollyKV& b) const {
+    return Compare(a, b) < 0;
   }
-};
-
-
-template <typename T>
-class MyAllocator {
- private:
-  using Self = MyAllocator<T>;
-
- public:
-  using value_type = T;
-
-  constexpr MyAllocator() = default;
 
-  constexpr MyAllocator(MyAllocator const&) = default;
-
-  template <typename U, std::enable_if_t<!std::is_same<U, T>::value, int> = 0>
-  constexpr MyAllocator(MyAllocator<U> const&) noexcept {}
-
-  T* allocate(size_t count) {
-    auto const p = std::malloc(sizeof(T) * count);
-    return static_cast<T*>(p);
-  }
-  void deallocate(T* p, size_t count) {
-    sizedFree(p, count * sizeof(T));
+  int Compare(const FollyKV& a, const FollyKV& b) const {
+    if (a.tail_ || b.tail_) {
+      return static_cast<int>(a.tail_) - static_cast<int>(b.tail_);
+    }
+    if (a.abbreviated_ && b.abbreviated_ && a.prefix_ != b.prefix_) {
+      const int r = a.prefix_ < b.prefix_ ? -1 : 1;
+      return order_ == kReverseBytewise ? -r : r;
+    }
+    return ucmp_->CompareWithoutTimestamp(a.Key(), a.has_ts_, b.Key(),
+                                          b.has_ts_);
   }
 
-  friend bool operator==(Self const&, Self const&) noexcept { return true; }
-  friend bool operator!=(Self const&, Self const&) noexcept { return false; }
-};
+  // Fill in the comparison fields of `kv`. `has_ts`: its key carries a
+  // timestamp, if the column family uses them.
+  void Prepare(FollyKV* kv, bool has_ts) const {
+    kv->has_ts_ = has_ts && ts_sz_ > 0;
+    if (order_ == kOther) {
+      return;
+    }
+    const Slice ukey = kv->has_ts_
+                           ? StripTimestampFromUserKey(kv->Key(), ts_sz_)
+                           : Slice(kv->Key());
+    uint64_t prefix = 0;
+    const size_t n = std::min(ukey.size(), sizeof(prefix));
+    for (size_t i = 0; i < n; ++i) {
+      prefix |= static_cast<uint64_t>(static_cast<uint8_t>(ukey[i]))
+                << (56 - 8 * i);
+    }
+    kv->prefix_ = prefix;
+    kv->abbreviated_ = true;
+  }
 
-extern Cache::CacheItemHelper helper1_wos;
+  const Comparator* user_comparator() const { return ucmp_; }
+  size_t timestamp_size() const { return ts_sz_; }
 
+ private:
+  enum Order { kBytewise, kReverseBytewise, kOther };
 
+  const Comparator* ucmp_;
+  size_t ts_sz_;
+  Order order_;
+};
 
 /**
  * FollySkipList
  */
 struct FollySkipList {
-  typedef folly::ConcurrentSkipList<FollyKV, FollyKVComparator> SkipListType;
+  typedef folly::ConcurrentSkipList<FollyKV, FollyKVComparator,
+                                    SlabNodeAllocator<char>>
+      SkipListType;
   typedef SkipListType::NodeType NodeType;
   typedef SkipListType::Accessor Accessor;
+  typedef PointIndex<NodeType> IndexType;
+
+  // Nodes collected per sweep.
+  static const size_t kEvictBatch = 1024;
+  // Dirty victims are written back in batches of about this size.
+  static const size_t kWriteBackBatchBytes = 4 << 20;
+  // How long the evictor waits after a run that could not evict anything.
+  static constexpr std::chrono::milliseconds kEvictRetryInterval{100};
 
     struct Iterator {
       typedef FollySkipList::NodeType NodeType;
@@ -181,175 +472,1614 @@ struct FollySkipList {
 
      public:
       Iterator(std::shared_ptr<SkipListType> skipList, NodeType* ptr, FollySkipList* fsl)
-          : accessor_(std::move(skipList)), ptr_(ptr), valid_(true), fsl_(fsl) {}
+          : accessor_(std::in_place, std::move(skipList)), ptr_(ptr),
+            valid_(ptr != nullptr), fsl_(fsl),
+            read_seq_(kMaxSequenceNumber) {
+        if (valid_) {
+          Capture();
+        }
+      }
 
       Iterator(const Accessor& accessor, NodeType* ptr, FollySkipList* fsl)
-          : accessor_(accessor), ptr_(ptr), valid_(true), fsl_(fsl) {
+          : accessor_(accessor), ptr_(ptr), valid_(ptr != nullptr), fsl_(fsl),
+            read_seq_(kMaxSequenceNumber) {
+        if (valid_) {
+          Capture();
+        }
+      }
 
+      // Entries (and the gaps between them) that became valid after `seq`
+      // are reported as not valid, so the caller falls back to the LSM.
+      void SetReadSequence(SequenceNumber seq) { read_seq_ = seq; }
+
+      // Lets go of the accessor until the next positioning call, which
+      // finds the current entry again by its key. A long-lived reader such
+      // as a DBIter calls it between operations, so it does not keep
+      // removed nodes and retired values from being reclaimed. Key(),
+      // Value(), Current() and Data() may not be used while paused.
+      void Pause() {
+        if (!accessor_.has_value()) {
+          return;
+        }
+        if (ptr_ != nullptr && valid_) {
+          const FollyKV& data = ptr_->data();
+          const Slice key =
+              data.has_ts_ ? StripTimestampFromUserKey(data.Key(), fsl_->ts_sz_)
+                           : Slice(data.Key());
+          paused_key_.assign(key.data(), key.size());
+        } else {
+          valid_ = false;
+        }
+        ptr_ = nullptr;
+        value_ = nullptr;
+        accessor_.reset();
       }
 
+      // Stepping onto the tail is a miss: the caller asks the LSM whether
+      // the scan really ends there. Negative entries are stepped over.
       void Next() {
-        if (ptr_ && valid_) {
-          valid_ = !ptr_->data().IsSentinel();
+        Resume();
+        while (ptr_ && valid_) {
+          valid_ = !ptr_->data().IsSentinel() &&
+                   ptr_->data().VisibleAt(read_seq_);
           ptr_ = ptr_->next();
-          lru_list->Touch(ptr_);
+          valid_ = valid_ && ptr_ != fsl_->tail_ && Capture();
+          ptr_->Touch();
+          if (!valid_ || !value_->Absent()) {
+            break;
+          }
         }
       }
 
+      // The gap before an entry belongs to its predecessor, so a step back
+      // needs the same checks as Next() on that node. back() may lag behind
+      // a concurrent insert, hence the next() check.
+      void Prev() {
+        Resume();
+        while (ptr_ && valid_) {
+          NodeType* prev = ptr_->back();
+          valid_ = prev != fsl_->Head() && prev->next() == ptr_ &&
+                   !prev->data().IsSentinel();
+          ptr_ = prev;
+          valid_ = valid_ && Capture();
+          if (!valid_) {
+            break;
+          }
+          ptr_->Touch();
+          if (!value_->Absent()) {
+            break;
+          }
+        }
+      }
+
+      // `key` is a user key without timestamp. Only a cached value is a
+      // hit; KnownAbsent() tells whether the cache knows `key` does not
+      // exist.
       void Seek(const Slice& key) {
-        FollyKV node(key, std::string(""));
+        Acquire();
         ptr_ = fsl_->Seek(key);
-        valid_ = ptr_->data().key_ == key;
+        if (fsl_->IsEntry(ptr_, key)) {
+          const bool visible = Capture();
+          const bool absent = value_->Absent();
+          valid_ = visible && !absent;
+          absent_ = visible && absent;
+        } else {
+          valid_ = false;
+          absent_ = fsl_->CoversGap(ptr_, read_seq_);
+        }
+      }
+
+      // Whether the last Seek() found a negative entry for its key, or a
+      // known gap around it.
+      bool KnownAbsent() const { return absent_; }
+
+      // First entry at or after `key` (without timestamp), if the cache
+      // knows that no key lies between the two.
+      void LowerBound(const Slice& key) {
+        Seek(key);
+        if (absent_) {
+          // From the negative entry or the node owning the gap.
+          valid_ = true;
+          Next();
+        }
+      }
+
+      // Last entry at or before `key` (without timestamp). Without an exact
+      // match, the gap after the entry must cover `key`.
+      void SeekForPrev(const Slice& key) {
+        Acquire();
+        ptr_ = fsl_->Seek(key);
+        valid_ = ptr_ != fsl_->Head() && Capture() &&
+                 (fsl_->IsEntry(ptr_, key) || !ptr_->data().IsSentinel());
+        if (valid_ && value_->Absent()) {
+          Prev();
+        }
+      }
+
+      // Only valid if a fill recorded that nothing precedes the first entry,
+      // see FollySkipList::InsertFirst().
+      void SeekToFirst() {
+        Acquire();
+        NodeType* head = fsl_->Head();
+        valid_ = !head->data().IsSentinel() &&
+                 head->data().VisibleAt(read_seq_);
+        ptr_ = head->next();
+        valid_ = valid_ && ptr_ != fsl_->tail_ && Capture();
+        if (valid_) {
+          ptr_->Touch();
+          if (value_->Absent()) {
+            Next();
+          }
+        }
+      }
+
+      // Only valid if a fill recorded that nothing follows the last entry,
+      // see FollySkipList::InsertLast().
+      void SeekToLast() {
+        Acquire();
+        ptr_ = fsl_->tail_->back();
+        valid_ = ptr_ != fsl_->Head() && ptr_->next() == fsl_->tail_ &&
+                 !ptr_->data().IsSentinel() && Capture();
+        if (valid_) {
+          ptr_->Touch();
+          if (value_->Absent()) {
+            Prev();
+          }
+        }
       }
 
       bool Valid() const { return valid_; }
-      std::string& Key() const { return ptr_->data().Key(); }
-      std::string& Value() const { return ptr_->data().Value(); }
+      // With user-defined timestamps, the timestamp of the cached version
+      // is Data().Timestamp().
+      const std::string& Key() const { return ptr_->data().Key(); }
+      Slice Value() const { return value_->Value(); }
+      // The buffer of the version the positioning call checked; a writer
+      // may have swapped in a newer one since. Use it rather than
+      // Data().Current().
+      const FollyValue& Current() const { return *value_; }
+      const FollyKV& Data() const { return ptr_->data(); }
+      SequenceNumber Seq() const { return ptr_->data().Seq(); }
+
+      // Write-back update of the current entry. `log_number` is the
+      // OmniCacheLog file the value was appended to, 0 if it was not. An
+      // unlogged update keeps the entry pinned to its last logged value.
+      // Returns false, leaving the entry alone, if it is being removed: the
+      // value has to go to the LSM then.
+      bool Update(const Slice& value, SequenceNumber seq,
+                  uint64_t log_number = 0) {
+        FollyKV& data = ptr_->data();
+        FollyValue* old;
+        {
+          // remove() marks the node under the same lock.
+          auto guard = ptr_->acquireGuard();
+          if (ptr_->markedForRemoval()) {
+            return false;
+          }
+          data.RaiseSeq(seq);
+          old = data.ExchangeValue(
+              value, fsl_->pin_value_min_size_.load(std::memory_order_relaxed),
+              false /* entity */, false /* absent */, data.Timestamp());
+          value_ = &data.Current();
+          if (log_number != 0) {
+            data.SetLogNumber(log_number);
+          }
+          data.SetDirty(true);
+        }
+        fsl_->RetireValue(old, value.size());
+        return true;
+      }
 
      private:
-      Accessor accessor_;
+      // Takes the buffer of the current entry and then checks whether it
+      // is visible at read_seq_. In this order the buffer is never newer
+      // than the version checked, see FollyKV::seq_.
+      bool Capture() {
+        value_ = &ptr_->data().Current();
+        return ptr_->data().VisibleAt(read_seq_);
+      }
+
+      void Acquire() {
+        if (!accessor_.has_value()) {
+          accessor_.emplace(fsl_->skiplist_);
+        }
+      }
+
+      // Back on the entry Pause() left, if it is still cached. Whether its
+      // gap may be used is checked on the way, as always.
+      void Resume() {
+        if (accessor_.has_value()) {
+          return;
+        }
+        Acquire();
+        if (valid_) {
+          ptr_ = fsl_->FindEntry(paused_key_);
+          valid_ = ptr_ != nullptr;
+        }
+      }
+
+      // Empty while paused.
+      std::optional<Accessor> accessor_;
       NodeType* ptr_;
+      // Buffer taken by Capture(), kept alive by the accessor.
+      const FollyValue* value_ = nullptr;
       bool valid_;
+      bool absent_ = false;
       FollySkipList *fsl_;
+      SequenceNumber read_seq_;
+      // User key (without timestamp) of the entry to resume at.
+      std::string paused_key_;
     };
 
   // don't hold a accessor, make GC possible
   std::shared_ptr<SkipListType> skiplist_;
-  size_t  maxSize_;
+  // Where the nodes come from. Node memory freed by evictions stays there
+  // for later fills, see IdleBytes().
+  std::shared_ptr<SlabAllocator> slab_;
+  // Byte budget for keys, values and skiplist nodes.
+  std::atomic<size_t> maxSize_;
+  std::atomic<size_t> usage_{0};
+  // Optional charge against a shared cache (CacheEntryRole::kOmniCache).
+  // Synced lazily, once usage drifts by at least one dummy entry.
+  std::shared_ptr<CacheReservationManager> cache_res_mgr_;
+  std::atomic<size_t> reserved_usage_{0};
+  std::atomic<bool> reservation_full_{false};
+  // Fill fences: highest sequence numbers of writes that may have changed
+  // data behind the cache's back, see FillAllowed(). A write of a single
+  // key raises the stripe of its key, a range write range_fence_; both
+  // raise fill_fence_, which guards the gaps between keys.
+  struct alignas(CACHE_LINE_SIZE) FillFenceStripe {
+    std::atomic<SequenceNumber> seq{0};
+  };
+  static const size_t kFillFenceStripes = 64;
+  std::array<FillFenceStripe, kFillFenceStripes> key_fences_;
+  std::atomic<SequenceNumber> range_fence_{0};
+  std::atomic<SequenceNumber> fill_fence_{0};
+  // Spans changed outside the write path (ApplyInvalidateRange()), fenced
+  // at span_fence_ instead of range_fence_, so point fills elsewhere go on.
+  // Only spans of the latest fence are kept: once it is raised, readers
+  // have moved past the older ones, which are folded into range_fence_.
+  static const size_t kMaxSpanFences = 64;
+  mutable std::mutex span_fences_mu_;
+  std::vector<std::pair<std::string, std::string>> span_fences_;
+  std::atomic<SequenceNumber> span_fence_{0};
+  // Eviction order. Hits only update a byte on the node; the policy decides
+  // what the sweep makes of it.
+  ClockSweeper<SkipListType> clock_;
+  std::atomic<OmniCacheReplacementPolicy> replacement_policy_{
+      OmniCacheReplacementPolicy::kClock};
+  // Ghost lists of kAdaptive, sized like the sketch.
+  AdaptivePolicy adaptive_;
+  // Point lookups of cached keys skip the descent.
+  IndexType index_;
+  // Recent reads by key, for admission. Sized for kSketchBytesPerKey byte
+  // entries at the initial capacity.
+  static const size_t kSketchBytesPerKey = 128;
+  FrequencySketch sketch_;
+  // 0 admits every fill, see Admit().
+  std::atomic<uint32_t> admission_min_frequency_{0};
+  // Values at least this large are kept in shared buffers, 0 for none.
+  std::atomic<size_t> pin_value_min_size_{0};
+  // Where clean victims go, if a secondary cache is set.
+  SpillTier spill_;
 //  std::shared_ptr<Cache> cache =  NewLRUCache(32 * 1048576);
 
-  folly::LockFreeRingBuffer<WriteBatch*> ringbuf_ =
-      folly::LockFreeRingBuffer<WriteBatch*>(32);
-
-  FollySkipList(int maxLevel, const Comparator* cmp, size_t maxsize)
-      : maxSize_(maxsize) {
+  // Background eviction. The evictor wakes up once usage crosses maxSize_
+  // (the high watermark) and sweeps until it is back under lowWatermark_.
+  // Fills are dropped above hardWatermark_, so a slow evictor cannot let
+  // the cache grow without bound.
+  std::atomic<size_t> lowWatermark_;
+  std::atomic<size_t> hardWatermark_;
+  std::atomic<bool> evict_pending_{false};
+  // Dirty victims waiting for their write-back.
+  std::atomic<size_t> queue_depth_{0};
+  // Whether the last write-back failed. Only touched by the evictor.
+  bool write_back_failing_ = false;
+  bool shutdown_ = false;
+  std::mutex evict_mu_;
+  std::condition_variable evict_cv_;
+  std::thread evictor_;
+  // Write-back target. Until it is set, dirty entries are never evicted.
+  std::atomic<DB*> db_{nullptr};
+  uint32_t cf_id_ = 0;
+  // User-defined timestamp size of the column family, 0 if none.
+  const size_t ts_sz_;
+  // The DB's statistics, may be null.
+  Statistics* const stats_;
+  // Sorts after every key. The gap before it belongs to the last entry:
+  // unless that one is a sentinel, nothing follows it.
+  NodeType* tail_ = nullptr;
+
+  FollySkipList(int maxLevel, const Comparator* cmp, size_t maxsize,
+                Statistics* stats = nullptr)
+      : adaptive_(std::min<size_t>(
+            std::max<size_t>(maxsize / kSketchBytesPerKey, 1024), 1 << 20)),
+        sketch_(std::min<size_t>(
+            std::max<size_t>(maxsize / kSketchBytesPerKey, 1024), 1 << 22)),
+        spill_(cmp, cmp->timestamp_size(), stats),
+        ts_sz_(cmp->timestamp_size()),
+        stats_(stats) {
+    SetCapacity(maxsize);
     FollyKV headKV(std::string(""), std::string(), true);
     FollyKV tailKV(std::string(TAIL), std::string(), true);
+    tailKV.tail_ = true;
 
-    skiplist_ = SkipListType::createInstance(headKV, maxLevel);
+    slab_ = std::make_shared<SlabAllocator>();
+    skiplist_ = SkipListType::createInstance(
+        headKV, maxLevel, FollyKVComparator(cmp),
+        SlabNodeAllocator<char>(slab_));
 
     auto headNode = skiplist_.get()->head_.load();
     auto tailNode = skiplist_->createNode(tailKV, 1);
     headNode->setSkip(0, tailNode);
     tailNode->setBack(headNode);
+    tail_ = tailNode;
 
-    lru_list = new LRUList<NodeType>();
+    evictor_ = std::thread([this]() { BGEvict(); });
+  }
+
+  ~FollySkipList() { StopEvictor(); }
 
-    // create a thread to run LRUEvict
-    std::thread([this]() {
-      while (true) {
-        WriteOptions wopt;
-        auto cursor = ringbuf_.currentHead();
-        WriteBatch *pBatch = nullptr;
-        ringbuf_.waitAndTryRead(pBatch, cursor);
-        assert(pBatch);
-        pDBImpl->Write(wopt, pBatch);
+  void StopEvictor() {
+    {
+      std::lock_guard<std::mutex> lock(evict_mu_);
+      if (shutdown_) {
+        return;
       }
-    }).detach();
+      shutdown_ = true;
+    }
+    evict_cv_.notify_one();
+    evictor_.join();
+    db_.store(nullptr, std::memory_order_release);
+  }
+
+  void SetWriteBack(DB* db, uint32_t cf_id) {
+    cf_id_ = cf_id;
+    db_.store(db, std::memory_order_release);
+  }
 
+  size_t GetCapacity() const {
+    return maxSize_.load(std::memory_order_relaxed);
+  }
+
+  // Takes effect on the next insert; shrinking wakes the evictor.
+  void SetCapacity(size_t maxsize) {
+    lowWatermark_.store(maxsize - maxsize / 8, std::memory_order_relaxed);
+    hardWatermark_.store(maxsize + maxsize / 4, std::memory_order_relaxed);
+    maxSize_.store(maxsize, std::memory_order_relaxed);
+    MaybeScheduleEviction();
+  }
+
+  // Under memory pressure (above the low watermark), keys are only added
+  // once the sketch has seen them read at least `min_frequency` times,
+  // counting the read being filled. 0 turns admission off.
+  void SetAdmissionMinFrequency(uint64_t min_frequency) {
+    admission_min_frequency_.store(
+        static_cast<uint32_t>(std::min<uint64_t>(
+            min_frequency, FrequencySketch::kMaxCount + 1)),
+        std::memory_order_relaxed);
+  }
+
+  // Applies from the next sweep on. Nodes keep their read history.
+  void SetReplacementPolicy(OmniCacheReplacementPolicy policy) {
+    replacement_policy_.store(policy, std::memory_order_relaxed);
+  }
+
+  // The policy for the next sweep, kAdaptive resolved.
+  OmniCacheReplacementPolicy SweepPolicy() const {
+    const OmniCacheReplacementPolicy policy =
+        replacement_policy_.load(std::memory_order_relaxed);
+    return policy == OmniCacheReplacementPolicy::kAdaptive ? adaptive_.Current()
+                                                           : policy;
+  }
+
+  // Applies to values cached or updated from now on.
+  void SetPinValueMinSize(uint64_t min_size) {
+    pin_value_min_size_.store(
+        static_cast<size_t>(std::min<uint64_t>(
+            min_size, std::numeric_limits<size_t>::max())),
+        std::memory_order_relaxed);
+  }
+
+  // Spill clean victims to `secondary` instead of dropping them. Must be
+  // called before the cache is used.
+  void SetSecondaryCache(std::shared_ptr<SecondaryCache> secondary) {
+    spill_.SetSecondaryCache(std::move(secondary));
+  }
+
+  // A lookup key: a user key without timestamp.
+  FollyKV Probe(const Slice& user_key) const {
+    FollyKV kv(user_key, Slice());
+    skiplist_->comparator().Prepare(&kv, false /* has_ts */);
+    return kv;
+  }
+
+  // An entry as stored. With user-defined timestamps, `key` carries the
+  // timestamp of the cached version.
+  FollyKV Entry(const Slice& key, const Slice& value, SequenceNumber seq,
+                bool entity = false, bool absent = false) const {
+    FollyKV kv(key, Slice(), true, seq);
+    // Not shared yet: there is no old buffer to retire.
+    kv.ExchangeValue(value, pin_value_min_size_.load(std::memory_order_relaxed),
+                     entity, absent, TimestampOf(key));
+    skiplist_->comparator().Prepare(&kv, true /* has_ts */);
+    return kv;
+  }
+
+  // The head holds no entry; unless it is a sentinel, nothing precedes the
+  // first one.
+  NodeType* Head() const {
+    return skiplist_->head_.load(std::memory_order_acquire);
+  }
+
+  // Whether `node` is the cached entry of `user_key`.
+  bool IsEntry(const NodeType* node, const Slice& user_key) const {
+    return node != Head() &&
+           skiplist_->comparator().Compare(node->data(), Probe(user_key)) == 0;
+  }
+
+  // Whether a key after `node`, the last node before it, is known not to
+  // exist for readers at `read_seq`: the gap after `node` is known. For the
+  // head that means the key precedes the first entry.
+  bool CoversGap(const NodeType* node, SequenceNumber read_seq) const {
+    const FollyKV& data = node->data();
+    return !data.IsSentinel() && data.VisibleAt(read_seq);
+  }
+
+  // Timestamp of a stored key, empty without user-defined timestamps.
+  Slice TimestampOf(const Slice& key) const {
+    return ts_sz_ > 0 ? ExtractTimestampFromUserKey(key, ts_sz_) : Slice();
+  }
+
+  // The key of the version `value` holds, the entry's buffer: the node's
+  // key only carries the timestamp of the version it was added for.
+  std::string VersionKey(const FollyKV& data, const FollyValue& value) const {
+    if (!data.has_ts_) {
+      return data.Key();
+    }
+    std::string key =
+        StripTimestampFromUserKey(data.Key(), ts_sz_).ToString();
+    const Slice ts = value.Timestamp();
+    key.append(ts.data(), ts.size());
+    return key;
+  }
+
+  // Whether a write of `key` (with timestamp) replaces the cached version
+  // in `data` for readers at the latest timestamp.
+  bool IsNewerVersion(const Slice& key, const FollyKV& data) const {
+    return ts_sz_ == 0 ||
+           skiplist_->comparator().user_comparator()->CompareTimestamp(
+               TimestampOf(key), data.Timestamp()) >= 0;
+  }
+
+  // The cache holds the latest version of each key, so with user-defined
+  // timestamps it can only serve (and be filled by) reads at the maximum
+  // timestamp.
+  bool ServesReadsAt(const Slice* read_ts) const {
+    if (ts_sz_ == 0) {
+      return true;
+    }
+    if (read_ts == nullptr || read_ts->size() != ts_sz_) {
+      return false;
+    }
+    const std::string max_ts(ts_sz_, '\xff');
+    return skiplist_->comparator().user_comparator()->CompareTimestamp(
+               *read_ts, max_ts) >= 0;
+  }
+
+  // The caller holds an accessor. Cached keys are found through index_,
+  // everything else takes the skiplist descent.
+  // The live node of `user_key` (without timestamp), nullptr if it is not
+  // cached. Unlike Seek(), not counted as a read.
+  NodeType* FindEntry(const Slice& user_key) const {
+    NodeType* node = index_.Lookup(IndexType::Hash(user_key));
+    if (node == nullptr || !IsEntry(node, user_key)) {
+      node = skiplist_->find(Probe(user_key));
+    }
+    return node != nullptr && !node->markedForRemoval() ? node : nullptr;
   }
 
   NodeType* Seek(const Slice& key) {
-    FollyKV node(key, std::string(""));
-
-    // Point Hash
-//    auto handle = static_cast<LRUHandle*>(cache->Lookup(key));
-//    if (handle != nullptr) {
-//      NodeType* result = static_cast<NodeType*>(handle->value);
-//      cache->Release(handle);
-//    }
-
-    // Skip List
-    NodeType* pNode = skiplist_->seek(node);
-    // Evict
+    const uint64_t hash = IndexType::Hash(key);
+    NodeType* pNode = index_.Lookup(hash);
+    if (pNode != nullptr && !pNode->markedForRemoval() && IsEntry(pNode, key)) {
+      pNode->Touch();
+      RecordRead(hash);
+      return pNode;
+    }
+    pNode = skiplist_->seek(Probe(key));
+    if (spill_.MayHoldChunks() && !IsEntry(pNode, key) &&
+        pNode->data().IsSentinel() && Promote(key)) {
+      pNode = skiplist_->seek(Probe(key));
+    }
     if (pNode != skiplist_.get()->head_) {
-      lru_list->Touch(pNode);
+      pNode->Touch();
     }
-    // Refill Point Hash
-//    cache->Insert(key, pNode, &helper1_wos, sizeof(pNode));
     return pNode;
   }
 
-  bool ShouldEvict() { return skiplist_->size() * 1000 > maxSize_; }
+  // Brings back the spilled chunk covering `key` (without timestamp), if
+  // any. The entries and the gaps between them are valid from the current
+  // fill fence on: every write since the chunk was spilled either dropped
+  // it or comes after this. The caller holds an accessor.
+  bool Promote(const Slice& key) {
+    if (usage_.load(std::memory_order_relaxed) >
+        hardWatermark_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    return spill_.Promote(key, [this](const SpillTier::ChunkView& entries) {
+      const SequenceNumber seq = fill_fence_.load();
+      NodeType* prev = nullptr;
+      for (const auto& entry : entries) {
+        NodeType* p = Fill(entry.first, entry.second, seq, false);
+        p->Touch();
+        if (prev != nullptr && prev->next() == p) {
+          FollyKV& data = prev->data();
+          data.RaiseSeq(seq);
+          data.SetSentinel(false);
+        }
+        prev = p;
+      }
+    });
+  }
+
+  // Collects runs of clean, adjacent victims with plain values for the
+  // spill tier. Runs on evictor_ only, before the victims are evicted.
+  void SpillVictims(const std::vector<NodeType*>& victims) {
+    spill_.Spill([&](std::vector<SpillTier::Chunk>* chunks) {
+      SpillTier::Chunk run;
+      size_t run_bytes = 0;
+      NodeType* prev = nullptr;
+      auto close_run = [&] {
+        if (!run.empty()) {
+          chunks->push_back(std::move(run));
+          run.clear();
+        }
+        run_bytes = 0;
+        prev = nullptr;
+      };
+      for (NodeType* node : victims) {
+        const FollyKV& data = node->data();
+        const FollyValue& value = data.Current();
+        if (data.Dirty() || value.Entity() || value.Absent() ||
+            node->markedForRemoval()) {
+          close_run();
+          continue;
+        }
+        // Only a known gap may join two entries.
+        if (prev != nullptr &&
+            (prev->next() != node || prev->data().IsSentinel())) {
+          close_run();
+        }
+        run.emplace_back(VersionKey(data, value), value.Value().ToString());
+        run_bytes += data.Key().size() + value.Value().size();
+        prev = node;
+        if (run.size() >= SpillTier::kMaxChunkKeys ||
+            run_bytes >= SpillTier::kMaxChunkBytes) {
+          close_run();
+        }
+      }
+      close_run();
+    });
+  }
+
+  // Hits count as reads for admission. Misses are counted by the fill that
+  // follows them.
+  void RecordRead(uint64_t hash) {
+    if (admission_min_frequency_.load(std::memory_order_relaxed) != 0) {
+      sketch_.Increment(hash);
+    }
+  }
 
-  void EvictWrite(const FollyKV& data) {
-    pDBImpl->Put_OC_Delete(data.Key(), data.Value());
+  // Whether a fill of `user_key` may go ahead, see
+  // SetAdmissionMinFrequency(). Keys already cached are always refreshed.
+  // The caller holds an accessor.
+  bool Admit(const Slice& user_key) {
+    static PERFCOUNTER_DEF_STAT("/oc/admission/", rejected,
+                                OMNICACHE_ADMISSION_REJECTED);
+    const uint32_t min_frequency =
+        admission_min_frequency_.load(std::memory_order_relaxed);
+    if (min_frequency == 0) {
+      return true;
+    }
+    const uint64_t hash = IndexType::Hash(user_key);
+    sketch_.Increment(hash);
+    if (usage_.load(std::memory_order_relaxed) <=
+            lowWatermark_.load(std::memory_order_relaxed) ||
+        sketch_.Estimate(hash) >= min_frequency) {
+      return true;
+    }
+    NodeType* pNode = index_.Lookup(hash);
+    if (pNode != nullptr && !pNode->markedForRemoval() &&
+        IsEntry(pNode, user_key)) {
+      return true;
+    }
+    PERFCOUNTER_INC_STAT(rejected, stats_);
+    return false;
+  }
+
+  bool ShouldEvict() const {
+    return usage_.load(std::memory_order_relaxed) >
+               maxSize_.load(std::memory_order_relaxed) ||
+           reservation_full_.load(std::memory_order_relaxed);
+  }
+
+  bool BelowLowWatermark(size_t pending) const {
+    const size_t usage = usage_.load(std::memory_order_relaxed);
+    const size_t low = lowWatermark_.load(std::memory_order_relaxed);
+    return usage <= low + pending &&
+           !reservation_full_.load(std::memory_order_relaxed);
+  }
+
+  // Dirty victims evicted but not yet written back to the DB.
+  size_t EvictQueueDepth() const {
+    return queue_depth_.load(std::memory_order_relaxed);
   }
 
-  void LRUEvict() {
-    ColumnFamilyHandle* default_cf_ = pDBImpl->DefaultColumnFamily();
-//    Cache* pCache = cache.get();
-    WriteBatch batch(1152 * 1024, 0 /* max_bytes */, 0, 0 /* default_cf_ts_sz */);
-    // Pre-allocate size of write batch conservatively.
-    // 8 bytes are taken by header, 4 bytes for count, 1 byte for type,
-    // and we allocate 11 extra bytes for key length, as well as value length.
-//    WriteBatch* batch = nullptr;
-    for (int i = 0; i < 1024; ++i) {
-      if (lru_list->IsEmpty()) {
+  // Same, summed over all caches, for the perf server.
+  static PerfCounter<>& QueueDepthCounter() {
+    static PERFCOUNTER_DEF("/oc/evict/", queue_depth);
+    return queue_depth;
+  }
+
+  // Fills dropped above hardWatermark_.
+  static PerfCounter<>& FillDroppedCounter() {
+    static PERFCOUNTER_DEF_STAT("/oc/evict/", fill_dropped,
+                                OMNICACHE_FILL_DROPPED);
+    return fill_dropped;
+  }
+
+  // Cheap enough for every insert: only the first caller over the high
+  // watermark takes the mutex.
+  void MaybeScheduleEviction() {
+    if (ShouldEvict() && !evict_pending_.exchange(true)) {
+      std::lock_guard<std::mutex> lock(evict_mu_);
+      evict_cv_.notify_one();
+    }
+  }
+
+  static size_t NodeCharge(const NodeType* node) {
+    return SlabAllocator::ClassSize(
+               sizeof(NodeType) +
+               node->height() * sizeof(std::atomic<NodeType*>)) +
+           IndexType::kEntryCharge + node->data().Key().size() +
+           node->data().Value().size();
+  }
+
+  // What the cache holds, which eviction keeps within the budget.
+  size_t ApproximateMemoryUsage() const {
+    return usage_.load(std::memory_order_relaxed);
+  }
+  // Node memory freed by evictions and kept for the next fills.
+  size_t IdleBytes() const { return slab_->IdleBytes(); }
+
+  void SetCacheReservationManager(
+      std::shared_ptr<CacheReservationManager> cache_res_mgr) {
+    cache_res_mgr_ = std::move(cache_res_mgr);
+    UpdateReservation(true /* force */);
+  }
+
+  void Charge(size_t bytes) {
+    usage_.fetch_add(bytes, std::memory_order_relaxed);
+    UpdateReservation();
+    MaybeScheduleEviction();
+  }
+
+  void Release(size_t bytes) {
+    usage_.fetch_sub(bytes, std::memory_order_relaxed);
+    UpdateReservation();
+  }
+
+  // Replace a cached value, keeping the byte accounting in step. Readers
+  // may still hold the old buffer, so it goes to the recycler with the
+  // removed nodes. The caller holds an accessor.
+  void SetValue(FollyKV& data, const Slice& value, bool entity, bool absent,
+                const Slice& ts) {
+    FollyValue* old = data.ExchangeValue(
+        value, pin_value_min_size_.load(std::memory_order_relaxed), entity,
+        absent, ts);
+    RetireValue(old, absent ? 0 : value.size());
+  }
+
+  // Second half of SetValue(), for callers that swap the buffer themselves:
+  // retires `old` (may be nullptr) and charges the new value's size.
+  void RetireValue(FollyValue* old, size_t new_size) {
+    size_t old_size = 0;
+    if (old != nullptr) {
+      old_size = old->Value().size();
+      skiplist_->retire(old, FollyValue::Release);
+    }
+    if (new_size >= old_size) {
+      Charge(new_size - old_size);
+    } else {
+      Release(old_size - new_size);
+    }
+  }
+
+  void UpdateReservation(bool force = false) {
+    if (cache_res_mgr_ == nullptr) {
+      return;
+    }
+    const size_t usage = usage_.load(std::memory_order_relaxed);
+    size_t reserved = reserved_usage_.load(std::memory_order_relaxed);
+    const size_t drift = usage > reserved ? usage - reserved : reserved - usage;
+    if (!force &&
+        drift < CacheReservationManagerImpl<
+                    CacheEntryRole::kOmniCache>::GetDummyEntrySize()) {
+      return;
+    }
+    // One thread syncs at a time; the others keep going.
+    if (!reserved_usage_.compare_exchange_strong(reserved, usage)) {
+      return;
+    }
+    // Idle node memory grows as usage shrinks: charge both.
+    Status s =
+        cache_res_mgr_->UpdateCacheReservation(usage + slab_->IdleBytes());
+    // A full shared cache (strict_capacity_limit) means we have to shrink.
+    reservation_full_.store(!s.ok(), std::memory_order_relaxed);
+  }
+
+  // Raise the fill fences to `seq`. Writes that may have changed data
+  // behind the cache's back must call this before probing the cache for
+  // it: this one for a range of keys, or keys not known here, ...
+  void RaiseFillFence(SequenceNumber seq) {
+    RaiseFence(&range_fence_, seq);
+    RaiseFence(&fill_fence_, seq);
+  }
+  // ... and this one for a single key (without timestamp).
+  void RaiseFillFence(const Slice& user_key, SequenceNumber seq) {
+    RaiseFence(&KeyFence(user_key), seq);
+    RaiseFence(&fill_fence_, seq);
+  }
+
+  // A fill read at `seq` is only safe if no write it may have missed
+  // happened after it. A fill that claims the gap next to its key can miss
+  // a write anywhere ...
+  bool FillAllowed(SequenceNumber seq) const {
+    return fill_fence_.load() <= seq;
+  }
+  // ... and the same for the span [user_begin, user_end] (both included,
+  // without timestamp).
+  void RaiseFillFence(const Slice& user_begin, const Slice& user_end,
+                      SequenceNumber seq) {
+    RaiseFence(&fill_fence_, seq);
+    std::lock_guard<std::mutex> lock(span_fences_mu_);
+    const SequenceNumber cur = span_fence_.load();
+    if (seq < cur) {
+      RaiseFence(&range_fence_, seq);
+      return;
+    }
+    if (span_fences_.size() == kMaxSpanFences) {
+      // Too many spans: fence off every key instead.
+      RaiseFence(&range_fence_, seq);
+      span_fences_.clear();
+      return;
+    }
+    if (seq > cur) {
+      // Folded before they go, see FillAllowed().
+      RaiseFence(&range_fence_, cur);
+      span_fences_.clear();
+    }
+    span_fences_.emplace_back(user_begin.ToString(), user_end.ToString());
+    span_fence_.store(seq);
+  }
+  // ... one of `user_key` alone only a write of that key, a range write or
+  // a change of a span it falls into. The spans are checked first: one
+  // that goes is folded into range_fence_ before.
+  bool FillAllowed(const Slice& user_key, SequenceNumber seq) const {
+    return !InFencedSpan(user_key, seq) && KeyFence(user_key).load() <= seq &&
+           range_fence_.load() <= seq;
+  }
+  bool InFencedSpan(const Slice& user_key, SequenceNumber seq) const {
+    if (span_fence_.load() <= seq) {
+      return false;
+    }
+    const Comparator* ucmp = skiplist_->comparator().user_comparator();
+    std::lock_guard<std::mutex> lock(span_fences_mu_);
+    for (const auto& span : span_fences_) {
+      if (ucmp->CompareWithoutTimestamp(user_key, false, span.first, false) >=
+              0 &&
+          ucmp->CompareWithoutTimestamp(user_key, false, span.second,
+                                        false) <= 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::atomic<SequenceNumber>& KeyFence(const Slice& user_key) {
+    return key_fences_[IndexType::Hash(user_key) % kFillFenceStripes].seq;
+  }
+  const std::atomic<SequenceNumber>& KeyFence(const Slice& user_key) const {
+    return key_fences_[IndexType::Hash(user_key) % kFillFenceStripes].seq;
+  }
+
+  static void RaiseFence(std::atomic<SequenceNumber>* fence,
+                         SequenceNumber seq) {
+    SequenceNumber cur = fence->load(std::memory_order_relaxed);
+    while (cur < seq && !fence->compare_exchange_weak(cur, seq)) {
+    }
+  }
+
+  void BGEvict() {
+    std::unique_lock<std::mutex> lock(evict_mu_);
+    while (true) {
+      evict_cv_.wait(lock, [this] { return shutdown_ || evict_pending_; });
+      if (shutdown_) {
+        return;
+      }
+      lock.unlock();
+      const bool stalled = !EvictToLowWatermark();
+      lock.lock();
+      if (stalled) {
+        // E.g. every victim is dirty and the DB refuses writes. Sweeping the
+        // same victims again right away would only burn the CPU.
+        evict_cv_.wait_for(lock, kEvictRetryInterval,
+                           [this] { return shutdown_; });
+        if (shutdown_) {
+          return;
+        }
+      }
+      evict_pending_ = false;
+      lock.unlock();
+      // Inserts that raced with the run may already be over again.
+      MaybeScheduleEviction();
+      lock.lock();
+    }
+  }
+
+  // A dirty entry and the buffer whose value is on its way to the LSM. The
+  // reference keeps the buffer from being reused, see CleanIfStaged().
+  struct StagedWriteBack {
+    NodeType* node;
+    FollyValueHandle value;
+  };
+
+  // The write-back of `staged` has reached the memtable: the entry is clean
+  // again, unless a write-back hit swapped in a newer value meanwhile. Under
+  // the node's lock, like Iterator::Update().
+  void CleanIfStaged(NodeType* node, const FollyValue* staged) {
+    auto guard = node->acquireGuard();
+    FollyKV& data = node->data();
+    if (&data.Current() == staged) {
+      data.SetDirty(false);
+      data.SetLogNumber(0);
+    }
+  }
+
+  // Remove an unreferenced node picked by the sweep and close the range
+  // before it.
+  bool EvictNode(NodeType* victim) {
+    static PERFCOUNTER_DEF_STAT("/oc/evict/", evicted, OMNICACHE_EVICTED);
+    victim->back()->data().SetSentinel(true);
+    const size_t charge = NodeCharge(victim);
+    if (!RemoveNode(victim->data(), true /* only_clean */)) {
+      // Someone else removed it first, or it was dirtied meanwhile.
+      return false;
+    }
+    Release(charge);
+    PERFCOUNTER_INC_STAT(evicted, stats_);
+    return true;
+  }
+
+  // Runs on evictor_ only. Returns false if usage is still above the low
+  // watermark and nothing could be evicted.
+  bool EvictToLowWatermark() {
+    static PERFCOUNTER_DEF("/oc/evict/", runs);
+    PERFCOUNTER_INC(runs);
+    DB* db = db_.load(std::memory_order_acquire);
+    size_t evicted = 0;
+    // Keeps the victims alive until we are done with them.
+    SkipListType::Accessor accessor(skiplist_);
+    WriteBatch batch;
+    WriteBatchInternal::SetAsOmniCacheWriteBack(&batch);
+    // Dirty victims stay cached until their write-back has reached the
+    // memtable, so readers never fall through to an older value in the LSM.
+    std::vector<StagedWriteBack> dirty;
+    std::unordered_set<NodeType*> staged;
+    size_t staged_bytes = 0;
+    std::vector<NodeType*> victims;
+    while (!BelowLowWatermark(staged_bytes)) {
+      victims.clear();
+      const bool adaptive =
+          replacement_policy_.load(std::memory_order_relaxed) ==
+          OmniCacheReplacementPolicy::kAdaptive;
+      const OmniCacheReplacementPolicy policy = SweepPolicy();
+      clock_.Sweep(skiplist_.get(), kEvictBatch, &victims, policy);
+      if (spill_.Enabled()) {
+        SpillVictims(victims);
+      }
+      size_t progress = 0;
+      for (NodeType* victim : victims) {
+        FollyKV& data = victim->data();
+        if (!data.Dirty()) {
+          const uint64_t hash = IndexHash(data);
+          if (EvictNode(victim)) {
+            ++progress;
+            ++evicted;
+            if (adaptive) {
+              adaptive_.OnEvict(hash, policy);
+            }
+          }
+        } else if (db != nullptr && staged.insert(victim).second) {
+          ++progress;
+          FollyValueHandle value = data.Current().Hold();
+          WriteBatchInternal::Put(&batch, cf_id_, VersionKey(data, *value),
+                                  value->Value());
+          dirty.push_back({victim, std::move(value)});
+          staged_bytes += NodeCharge(victim);
+          queue_depth_.fetch_add(1, std::memory_order_relaxed);
+          QueueDepthCounter().Inc(1);
+        }
+      }
+      if (batch.GetDataSize() >= kWriteBackBatchBytes) {
+        const size_t flushed = FlushWriteBack(db, &batch, &dirty);
+        evicted += flushed;
+        if (flushed == 0) {
+          // Every staged node was dirtied again, or the write failed; try
+          // later.
+          break;
+        }
+        staged.clear();
+        staged_bytes = 0;
+      }
+      if (progress == 0) {
+        // Nothing left to evict this round.
         break;
       }
-      auto victim = lru_list->Pop();
+    }
+    evicted += FlushWriteBack(db, &batch, &dirty);
+    return evicted > 0 || BelowLowWatermark(0);
+  }
 
-      victim->back()->data().sentinel_ = true;
+  // One coalesced write for all staged victims, then drop them. Returns
+  // the number of nodes evicted.
+  size_t FlushWriteBack(DB* db, WriteBatch* batch,
+                        std::vector<StagedWriteBack>* dirty) {
+    static PERFCOUNTER_DEF("/oc/evict/", write_batches);
+    static PERFCOUNTER_DEF_STAT("/oc/evict/", written_back,
+                                OMNICACHE_WRITTEN_BACK);
+    if (batch->Count() > 0) {
+      RecordInHistogram(stats_, OMNICACHE_EVICT_QUEUE_DEPTH,
+                        queue_depth_.load(std::memory_order_relaxed));
+      // Through the WAL, so the OmniCacheLog files of the victims can go.
+      // On failure the victims stay dirty and cached.
+      const Status s = db->Write(WriteOptions(), batch);
+      PERFCOUNTER_INC(write_batches);
+      if (s.ok()) {
+        written_back.Record(stats_, batch->Count());
+        write_back_failing_ = false;
+      } else if (!write_back_failing_) {
+        // Once per streak of failures; the evictor keeps retrying.
+        write_back_failing_ = true;
+        ROCKS_LOG_WARN(db->GetDBOptions().info_log,
+                       "OmniCache write-back of column family %" PRIu32
+                       " failed: %s",
+                       cf_id_, s.ToString().c_str());
+      }
+      if (s.ok()) {
+        for (const StagedWriteBack& w : *dirty) {
+          CleanIfStaged(w.node, w.value.get());
+        }
+      }
+      batch->Clear();
+    }
+    size_t evicted = 0;
+    for (const StagedWriteBack& w : *dirty) {
+      // Still dirty means a write-back hit swapped in a newer value after
+      // we staged ours; the node stays cached until the next round.
+      if (!w.node->data().Dirty() && EvictNode(w.node)) {
+        ++evicted;
+      }
+    }
+    queue_depth_.fetch_sub(dirty->size(), std::memory_order_relaxed);
+    QueueDepthCounter().Dec(dirty->size());
+    dirty->clear();
+    return evicted;
+  }
 
-      FollyKV& data = victim->data();
-      if (data.dirty_) {
-//        if (batch == nullptr) {
-//          batch = new WriteBatch(1152 * 2, 0 /* max_bytes */, 0,
-//                                 0 /* default_cf_ts_sz */);
-//        }
-        std::string wkey;
-        std::string wval;
-        wkey.assign(data.Key().data(), data.Key().size());
-        wval.assign(data.Value().data(), data.Value().size());
-        batch.Put(default_cf_, wkey, wval);
+  // Writes every dirty entry back through the WAL, e.g. before the DB
+  // closes, or only those in [*begin, *end] (user keys without timestamp).
+  // The entries stay cached.
+  Status FlushDirty(const Slice* begin = nullptr, const Slice* end = nullptr) {
+    DB* db = db_.load(std::memory_order_acquire);
+    if (db == nullptr) {
+      return Status::OK();
+    }
+    const FollyKVComparator& cmp = skiplist_->comparator();
+    FollyKV end_node = Probe(end != nullptr ? *end : Slice());
+    SkipListType::Accessor accessor(skiplist_);
+    WriteBatch batch;
+    WriteBatchInternal::SetAsOmniCacheWriteBack(&batch);
+    std::vector<StagedWriteBack> staged;
+    auto write = [&] {
+      Status ws = db->Write(WriteOptions(), &batch);
+      if (ws.ok()) {
+        for (const StagedWriteBack& w : staged) {
+          CleanIfStaged(w.node, w.value.get());
+        }
+      }
+      batch.Clear();
+      staged.clear();
+      return ws;
+    };
+    Status s;
+    NodeType* node = begin != nullptr ? skiplist_->lower_bound(Probe(*begin))
+                                      : skiplist_->head_.load()->next();
+    // The tail node is the only one without a successor.
+    for (; s.ok() && node != nullptr && node->skip(0) != nullptr &&
+           (end == nullptr || !cmp(end_node, node->data()));
+         node = node->next()) {
+      FollyKV& data = node->data();
+      if (!data.Dirty() || node->markedForRemoval()) {
+        continue;
+      }
+      FollyValueHandle value = data.Current().Hold();
+      // With timestamps, under the version the value belongs to.
+      WriteBatchInternal::Put(&batch, cf_id_, VersionKey(data, *value),
+                              value->Value());
+      staged.push_back({node, std::move(value)});
+      if (batch.GetDataSize() >= kWriteBackBatchBytes) {
+        s = write();
+      }
+    }
+    if (s.ok() && batch.Count() > 0) {
+      s = write();
+    }
+    return s;
+  }
+
+  // Oldest OmniCacheLog file a dirty entry still depends on, or the max
+  // uint64_t if there is none. Walks the whole list.
+  uint64_t MinDirtyLogNumber() const {
+    SkipListType::Accessor accessor(skiplist_);
+    uint64_t min_live = std::numeric_limits<uint64_t>::max();
+    for (NodeType* node = skiplist_->head_.load()->next();
+         node->skip(0) != nullptr; node = node->next()) {
+      const FollyKV& data = node->data();
+      // Update() sets the log number before the flag.
+      if (!data.Dirty()) {
+        continue;
+      }
+      const uint64_t log_number = data.LogNumber();
+      if (log_number != 0) {
+        min_live = std::min(min_live, log_number);
+      }
+    }
+    return min_live;
+  }
+
+  // Calls `fn(user_keys, from_first, linked)` for every cached range in key
+  // order, in chunks of at most `max_keys` keys (without timestamps).
+  // `from_first`: nothing precedes the first key. `linked`: the gap after
+  // the last key is known too, it reaches the next chunk or the end of the
+  // column family. Walks the whole list.
+  void ForEachRange(
+      size_t max_keys,
+      const std::function<void(const std::vector<std::string>&, bool, bool)>&
+          fn) const {
+    SkipListType::Accessor accessor(skiplist_);
+    NodeType* head = skiplist_->head_.load();
+    bool from_first = !head->data().IsSentinel();
+    std::vector<std::string> user_keys;
+    for (NodeType* node = head->next(); node->skip(0) != nullptr;
+         node = node->next()) {
+      if (node->markedForRemoval()) {
+        continue;
+      }
+      const FollyKV& data = node->data();
+      // A negative entry only tells that its gap is empty, which the keys
+      // around it already do.
+      if (!data.Absent()) {
+        user_keys.push_back(
+            (data.has_ts_ ? StripTimestampFromUserKey(data.Key(), ts_sz_)
+                          : Slice(data.Key()))
+                .ToString());
+      }
+      if (data.IsSentinel() || user_keys.size() >= max_keys) {
+        if (!user_keys.empty()) {
+          fn(user_keys, from_first, !data.IsSentinel());
+          user_keys.clear();
+        }
+        from_first = false;
       }
-//      pCache->Erase(data.Key());
-      skiplist_.get()->remove(data);
     }
-    WriteOptions wopt;
-    wopt.disableWAL =true;
-    pDBImpl->Write(wopt, &batch);
-    //    if (batch) {
-//      ringbuf_.write(batch);
-//    }
+    if (!user_keys.empty()) {
+      // The last entry was not a sentinel, nothing follows it.
+      fn(user_keys, from_first, true);
+    }
+  }
+
+  // Which gap next to the filled key the caller read as empty, if any.
+  enum class Link {
+    kNone,
+    // The one from `neighbor`, the key read right before it (nullptr: from
+    // whatever node precedes it).
+    kAfter,
+    // The one up to `neighbor`, the key read right after it in a reverse
+    // scan.
+    kBefore,
+    // Nothing precedes the key.
+    kFirst,
+    // Nothing follows the key.
+    kLast,
+  };
+
+  // With `entity`, `value` is a serialized wide-column entity.
+  std::unique_ptr<Iterator> Insert(const Slice& key, const Slice& value,
+                                   SequenceNumber seq, bool entity = false) {
+    return doInsert(key, value, seq, Link::kNone, nullptr, entity);
+  }
+
+  std::unique_ptr<Iterator> Append(const Slice& key, const Slice& value,
+                                   SequenceNumber seq) {
+    return doInsert(key, value, seq, Link::kAfter);
   }
 
-  std::unique_ptr<Iterator> Insert(const Slice& key, const Slice& value) {
-    return doInsert(key, value, false);
+  // Extends the range only if the node before `key` is still `prev_key`,
+  // the key the caller read last. The evictor may have taken it since.
+  std::unique_ptr<Iterator> Append(const Slice& prev_key, const Slice& key,
+                                   const Slice& value, SequenceNumber seq,
+                                   bool entity = false) {
+    return doInsert(key, value, seq, Link::kAfter, &prev_key, entity);
   }
 
-  std::unique_ptr<Iterator> Append(const Slice& key, const Slice& value) {
-    return doInsert(key, value, true);
+  // Extends the range that starts at `next_key` backwards, if the node
+  // after `key` is still `next_key`.
+  std::unique_ptr<Iterator> Prepend(const Slice& next_key, const Slice& key,
+                                    const Slice& value, SequenceNumber seq,
+                                    bool entity = false) {
+    return doInsert(key, value, seq, Link::kBefore, &next_key, entity);
   }
 
-  std::unique_ptr<Iterator> doInsert(const Slice& key, const Slice& value, bool doAppend) {
-    if (ShouldEvict()) {
-      LRUEvict();
-      doAppend = false;
+  // `key` is the first key of the column family, as read by SeekToFirst.
+  std::unique_ptr<Iterator> InsertFirst(const Slice& key, const Slice& value,
+                                        SequenceNumber seq,
+                                        bool entity = false) {
+    return doInsert(key, value, seq, Link::kFirst, nullptr, entity);
+  }
+
+  // `key` is the last key of the column family, as read by SeekToLast.
+  std::unique_ptr<Iterator> InsertLast(const Slice& key, const Slice& value,
+                                       SequenceNumber seq,
+                                       bool entity = false) {
+    return doInsert(key, value, seq, Link::kLast, nullptr, entity);
+  }
+
+  // A negative entry: `key` was read as not existing at `seq`. Lookups of
+  // `key` are then answered from the cache; once a fill appends to it, so
+  // are lookups up to the next key. Not kept for column families with
+  // user-defined timestamps, where entries carry the version's timestamp.
+  std::unique_ptr<Iterator> InsertAbsent(const Slice& key,
+                                         SequenceNumber seq) {
+    if (ts_sz_ > 0) {
+      return NewIterator();
+    }
+    return doInsert(key, Slice(), seq, Link::kNone, nullptr, false, true);
+  }
+
+  std::unique_ptr<Iterator> doInsert(const Slice& key, const Slice& value,
+                                     SequenceNumber seq, Link link,
+                                     const Slice* neighbor = nullptr,
+                                     bool entity = false,
+                                     bool absent = false) {
+    const Slice user_key = StripTimestampFromUserKey(key, ts_sz_);
+    // A fill linked to a neighbour claims the gap between the two as well.
+    const bool claims_gap = link != Link::kNone;
+    auto allowed = [&] {
+      return claims_gap ? FillAllowed(seq) : FillAllowed(user_key, seq);
+    };
+    if (!allowed()) {
+      return NewIterator();
+    }
+    if (usage_.load(std::memory_order_relaxed) >
+        hardWatermark_.load(std::memory_order_relaxed)) {
+      // The evictor is behind. Fills are optional, the reader already has
+      // its value.
+      FillDroppedCounter().Record(stats_);
+      return NewIterator();
+    }
+    SkipListType::Accessor accessor(skiplist_);
+    if (!Admit(user_key)) {
+      return NewIterator();
+    }
+    NodeType* p = Fill(key, value, seq,
+                       link == Link::kAfter && neighbor == nullptr, entity,
+                       absent);
+    // The node owning the gap, if the caller's read still matches it.
+    NodeType* owner = nullptr;
+    switch (link) {
+      case Link::kNone:
+        break;
+      case Link::kAfter:
+        if (neighbor == nullptr ||
+            IsEntry(p->back(), StripTimestampFromUserKey(*neighbor, ts_sz_))) {
+          owner = p->back();
+        }
+        break;
+      case Link::kFirst:
+        if (p->back() == Head()) {
+          owner = p->back();
+        }
+        break;
+      case Link::kBefore:
+        if (IsEntry(p->next(), StripTimestampFromUserKey(*neighbor, ts_sz_))) {
+          owner = p;
+        }
+        break;
+      case Link::kLast:
+        if (p->next() == tail_) {
+          owner = p;
+        }
+        break;
+    }
+    if (owner != nullptr) {
+      // The gap is only known empty as of `seq`.
+      FollyKV& data = owner->data();
+      data.RaiseSeq(seq);
+      data.SetSentinel(false);
+    }
+    p->Touch();
+
+    if (!allowed()) {
+      // Lost the race against a write that did not see our node.
+      Remove(user_key, true /* only_clean */);
+      return NewIterator();
+    }
+    auto iter = std::make_unique<Iterator>(skiplist_, p, this);
+    iter->SetReadSequence(seq);
+    return iter;
+  }
+
+  // Point lookup results read at `seq`, e.g. the misses of a MultiGet: one
+  // accessor for the whole batch. Like Insert(), but no iterators are
+  // handed back. Each key is checked against the fence of its own stripe.
+  void InsertBatch(const std::vector<FollyFill>& entries,
+                   SequenceNumber seq) {
+    if (entries.empty()) {
+      return;
+    }
+    if (usage_.load(std::memory_order_relaxed) >
+        hardWatermark_.load(std::memory_order_relaxed)) {
+      FillDroppedCounter().Record(stats_);
+      return;
     }
-    FollyKV node{key, value, true};
     SkipListType::Accessor accessor(skiplist_);
+    std::vector<Slice> filled;
+    filled.reserve(entries.size());
+    for (const auto& entry : entries) {
+      if (entry.absent && ts_sz_ > 0) {
+        // See InsertAbsent().
+        continue;
+      }
+      const Slice user_key = StripTimestampFromUserKey(entry.key, ts_sz_);
+      if (FillAllowed(user_key, seq) && Admit(user_key)) {
+        Fill(entry.key, entry.value, seq, false /* doAppend */, entry.entity,
+             entry.absent)
+            ->Touch();
+        filled.push_back(user_key);
+      }
+    }
+    for (const Slice& user_key : filled) {
+      if (!FillAllowed(user_key, seq)) {
+        Remove(user_key, true /* only_clean */);
+      }
+    }
+  }
+
+  // Adds `key` or refreshes its entry. A fill never overrides a write-back
+  // value or a newer version. The caller holds an accessor.
+  NodeType* Fill(const Slice& key, const Slice& value, SequenceNumber seq,
+                 bool doAppend, bool entity = false, bool absent = false) {
+    FollyKV node = Entry(key, value, seq, entity, absent);
     auto [p, added] = skiplist_->addOrGetData(node, doAppend);
     if (!added) {
-      p->data().Value() = node.Value();
-      p->data().dirty_ = true;
+      FollyKV& data = p->data();
+      FollyValue* old = nullptr;
+      bool refreshed = false;
+      {
+        // A write-back hit must not come in between the check and the swap,
+        // see Iterator::Update().
+        auto guard = p->acquireGuard();
+        if (!data.Dirty() && data.Seq() < seq && IsNewerVersion(key, data)) {
+          // Published before the buffer, see FollyKV::seq_.
+          data.RaiseSeq(seq);
+          old = data.ExchangeValue(
+              value, pin_value_min_size_.load(std::memory_order_relaxed),
+              entity, absent, TimestampOf(key));
+          refreshed = true;
+        }
+      }
+      if (refreshed) {
+        RetireValue(old, absent ? 0 : value.size());
+      }
     } else {
       assert(p->data().Key() != "");
-      lru_list->Push(p);
+      static PERFCOUNTER_DEF_STAT("/oc/evict/", ghost_hits,
+                                  OMNICACHE_GHOST_HITS);
+      Charge(NodeCharge(p));
+      const uint64_t hash = IndexHash(p->data());
+      index_.Insert(hash, p);
+      if (replacement_policy_.load(std::memory_order_relaxed) ==
+              OmniCacheReplacementPolicy::kAdaptive &&
+          adaptive_.OnFill(hash)) {
+        PERFCOUNTER_INC_STAT(ghost_hits, stats_);
+      }
     }
-    lru_list->Touch(p);
+    return p;
+  }
 
-    return std::make_unique<Iterator>(skiplist_, p, this);
+  // Point lookups of `keys` (without timestamp), sorted by the column
+  // family's comparator. Each search resumes from where the previous one
+  // stopped, so a batch costs one descent plus the distance between
+  // neighbouring keys. `on_hit(i, value)` is called with the buffer of
+  // every keys[i] cached and visible at `read_seq`; `value` is only valid
+  // during the call. `on_absent(i)`, if given, for every keys[i] the cache
+  // knows does not exist at `read_seq`, see Iterator::KnownAbsent().
+  void MultiFind(const std::vector<Slice>& keys, SequenceNumber read_seq,
+                 const std::function<void(size_t, const FollyValue&)>& on_hit,
+                 const std::function<void(size_t)>& on_absent = nullptr) {
+    SkipListType::Skipper skipper(skiplist_);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      const bool found = skipper.to(Probe(keys[i]));
+      if (!skipper.good()) {
+        continue;
+      }
+      NodeType* node = skipper.node();
+      const FollyKV& data = node->data();
+      if (!found) {
+        // A node being removed may still hold keys[i].
+        if (on_absent && !node->markedForRemoval() &&
+            CoversGap(skipper.pred(), read_seq)) {
+          on_absent(i);
+        }
+        continue;
+      }
+      // The buffer before its version, see Iterator::Capture().
+      const FollyValue& value = data.Current();
+      if (data.VisibleAt(read_seq)) {
+        node->Touch();
+        RecordRead(IndexType::Hash(keys[i]));
+        if (!value.Absent()) {
+          on_hit(i, value);
+        } else if (on_absent) {
+          on_absent(i);
+        }
+      }
+    }
   }
 
+  // Drop `key` (without timestamp) from the cache and close the range
+  // around it. With `only_clean`, a dirty entry stays.
+  bool Remove(const Slice& key, bool only_clean = false) {
+    FollyKV node = Probe(key);
+    SkipListType::Accessor accessor(skiplist_);
+    NodeType* pNode = skiplist_->find(node);
+    if (pNode == nullptr) {
+      return false;
+    }
+    pNode->back()->data().SetSentinel(true);
+    const size_t charge = NodeCharge(pNode);
+    if (!RemoveNode(node, only_clean)) {
+      return false;
+    }
+    Release(charge);
+    return true;
+  }
+
+  // Unlinks the node matching `kv` and unpublishes it from index_. The
+  // caller holds an accessor. With `only_clean`, a dirty node stays; that
+  // is checked under the node lock Iterator::Update() takes, so a
+  // write-back hit either lands before the check or fails on the mark.
+  bool RemoveNode(const FollyKV& kv, bool only_clean = false) {
+    const uint64_t hash = IndexHash(kv);
+    if (!skiplist_->remove_if(kv, [only_clean](const FollyKV& data) {
+          return !only_clean || !data.Dirty();
+        })) {
+      return false;
+    }
+    index_.Erase(hash);
+    return true;
+  }
+
+  uint64_t IndexHash(const FollyKV& kv) const {
+    return IndexType::Hash(kv.has_ts_
+                               ? StripTimestampFromUserKey(kv.Key(), ts_sz_)
+                               : Slice(kv.Key()));
+  }
+
+  // Returns the node holding `key`, or the node a new `key` would follow.
+  // Nodes that are being removed are skipped so the caller never marks a
+  // node that is about to disappear.
+  NodeType* SeekLive(const FollyKV& node) {
+    NodeType* pNode;
+    while ((pNode = skiplist_->seek(node))->markedForRemoval()) {
+    }
+    return pNode;
+  }
+
+  // Write path hooks. Each one raises the fill fences before touching the
+  // skiplist, see FillAllowed(). Keys carry their timestamp, if any.
+
+  // A committed Put (PutEntity with `entity`) at `seq`: refresh a cached
+  // key in place, otherwise stop the range that would contain it from
+  // claiming the gap.
+  void ApplyPut(const Slice& key, const Slice& value, SequenceNumber seq,
+                bool entity = false) {
+    const Slice user_key = StripTimestampFromUserKey(key, ts_sz_);
+    RaiseFillFence(user_key, seq);
+    SpillTier::WriteGuard spill_guard(&spill_, user_key);
+    FollyKV node = Probe(user_key);
+    SkipListType::Accessor accessor(skiplist_);
+    NodeType* pNode = SeekLive(node);
+    FollyKV& data = pNode->data();
+    if (IsEntry(pNode, user_key)) {
+      if (!IsNewerVersion(key, data)) {
+        // Below the cached version's timestamp, the cache is unaffected.
+        return;
+      }
+      FollyValue* old;
+      {
+        // Against Iterator::Update() and CleanIfStaged().
+        auto guard = pNode->acquireGuard();
+        data.RaiseSeq(seq);
+        old = data.ExchangeValue(
+            value, pin_value_min_size_.load(std::memory_order_relaxed), entity,
+            false /* absent */, TimestampOf(key));
+        // The memtable now holds a newer value than any pending write-back.
+        data.SetDirty(false);
+        data.SetLogNumber(0);
+      }
+      RetireValue(old, value.size());
+    } else {
+      data.SetSentinel(true);
+    }
+  }
+
+  // A Put at `seq` that wrote a dirty entry back, see FlushWriteBack() and
+  // FlushDirty(). The entry is left alone: it may hold a newer write-back
+  // value by now. The writer cleans it once the write is done, see
+  // CleanIfStaged().
+  void ApplyWriteBack(const Slice& key, SequenceNumber seq) {
+    const Slice user_key = StripTimestampFromUserKey(key, ts_sz_);
+    RaiseFillFence(user_key, seq);
+    // A chunk holding the key was spilled before it was dirtied.
+    spill_.Drop(user_key);
+  }
+
+  // A committed Delete/SingleDelete at `seq`. The range stays contiguous for
+  // current readers, but snapshots older than `seq` must not skip the key.
+  void ApplyDelete(const Slice& key, SequenceNumber seq) {
+    const Slice user_key = StripTimestampFromUserKey(key, ts_sz_);
+    RaiseFillFence(user_key, seq);
+    SpillTier::WriteGuard spill_guard(&spill_, user_key);
+    FollyKV node = Probe(user_key);
+    SkipListType::Accessor accessor(skiplist_);
+    NodeType* pNode = skiplist_->find(node);
+    if (pNode == nullptr || !IsNewerVersion(key, pNode->data())) {
+      return;
+    }
+    FollyKV& pred = pNode->back()->data();
+    pred.RaiseSeq(seq);
+    // The predecessor's gap now runs on to the victim's successor.
+    if (pNode->data().IsSentinel()) {
+      pred.SetSentinel(true);
+    }
+    const size_t charge = NodeCharge(pNode);
+    if (RemoveNode(node)) {
+      Release(charge);
+    }
+  }
+
+  // A committed DeleteRange [begin, end) at `seq`. All cached keys in the
+  // range are cut out in a single level-0 walk; the predecessor keeps its
+  // link, valid from `seq`. With timestamps, versions newer than the range
+  // tombstone stay.
+  void ApplyDeleteRange(const Slice& begin, const Slice& end,
+                        SequenceNumber seq) {
+    RaiseFillFence(seq);
+    const Slice user_begin = StripTimestampFromUserKey(begin, ts_sz_);
+    const Slice user_end = StripTimestampFromUserKey(end, ts_sz_);
+    SpillTier::WriteGuard spill_guard(&spill_, user_begin, &user_end);
+    FollyKV begin_node = Probe(user_begin);
+    FollyKV end_node = Probe(user_end);
+    const FollyKVComparator& cmp = skiplist_->comparator();
+    SkipListType::Accessor accessor(skiplist_);
+    NodeType* pNode = skiplist_->lower_bound(begin_node);
+    if (pNode == nullptr || pNode->skip(0) == nullptr ||
+        !cmp(pNode->data(), end_node)) {
+      return;
+    }
+    FollyKV& pred = pNode->back()->data();
+    pred.RaiseSeq(seq);
+    std::vector<NodeType*> victims;
+    // The tail node is the only one without a successor.
+    for (; pNode->skip(0) != nullptr && cmp(pNode->data(), end_node);
+         pNode = pNode->next()) {
+      if (IsNewerVersion(begin, pNode->data())) {
+        victims.push_back(pNode);
+      }
+    }
+    // Gaps inside the range are known empty now; only the gap after the last
+    // victim of a run reaches past it, and passes to the node before the run.
+    NodeType* run_pred = nullptr;
+    for (size_t i = 0; i < victims.size(); ++i) {
+      if (run_pred == nullptr) {
+        run_pred = victims[i]->back();
+      }
+      if (i + 1 == victims.size() || victims[i + 1] != victims[i]->next()) {
+        if (victims[i]->data().IsSentinel()) {
+          run_pred->data().SetSentinel(true);
+        }
+        run_pred = nullptr;
+      }
+    }
+    for (NodeType* victim : victims) {
+      const size_t charge = NodeCharge(victim);
+      if (RemoveNode(victim->data())) {
+        Release(charge);
+      }
+    }
+  }
+
+  // A committed write the cache cannot reproduce (Merge, entity, blob index):
+  // drop the key, or close the range it would fall into.
+  void ApplyInvalidate(const Slice& key, SequenceNumber seq) {
+    const Slice user_key = StripTimestampFromUserKey(key, ts_sz_);
+    RaiseFillFence(user_key, seq);
+    SpillTier::WriteGuard spill_guard(&spill_, user_key);
+    if (!Remove(user_key)) {
+      FollyKV node = Probe(user_key);
+      SkipListType::Accessor accessor(skiplist_);
+      SeekLive(node)->data().SetSentinel(true);
+    }
+  }
+
+  // Data in [begin, end] (both included) changed outside the write path,
+  // e.g. by a file ingestion, and is visible from `seq` on. Cached keys in
+  // the span are dropped and the gaps around them closed. Dirty entries
+  // stay: their write-back values are newer than anything in the LSM.
+  void ApplyInvalidateRange(const Slice& begin, const Slice& end,
+                            SequenceNumber seq) {
+    const Slice user_begin = StripTimestampFromUserKey(begin, ts_sz_);
+    const Slice user_end = StripTimestampFromUserKey(end, ts_sz_);
+    RaiseFillFence(user_begin, user_end, seq);
+    SpillTier::WriteGuard spill_guard(&spill_, user_begin, &user_end);
+    SpillTier::WriteGuard spill_end_guard(&spill_, user_end);
+    FollyKV begin_node = Probe(user_begin);
+    FollyKV end_node = Probe(user_end);
+    const FollyKVComparator& cmp = skiplist_->comparator();
+    SkipListType::Accessor accessor(skiplist_);
+    // The entry whose gap reaches into the span; those before the dropped
+    // ones are closed below, like in Remove().
+    SeekLive(begin_node)->data().SetSentinel(true);
+    std::vector<NodeType*> victims;
+    // The tail node is the only one without a successor.
+    for (NodeType* pNode = skiplist_->lower_bound(begin_node);
+         pNode != nullptr && pNode->skip(0) != nullptr &&
+         !cmp(end_node, pNode->data());
+         pNode = pNode->next()) {
+      if (pNode->data().Dirty()) {
+        pNode->data().SetSentinel(true);
+      } else {
+        victims.push_back(pNode);
+      }
+    }
+    for (NodeType* victim : victims) {
+      victim->back()->data().SetSentinel(true);
+      const size_t charge = NodeCharge(victim);
+      // Dirtied since the check above, it stays as well.
+      if (RemoveNode(victim->data(), true /* only_clean */)) {
+        Release(charge);
+      }
+    }
+  }
 
   NodeType* Find(const Slice& key) {
-    FollyKV node(key, std::string(""));
+    FollyKV node = Probe(key);
     SkipListType::Accessor accessor(skiplist_);
     NodeType* pNode = skiplist_->lower_bound(node);
     if (pNode != skiplist_.get()->head_) {
-      lru_list->Touch(pNode);
+      pNode->Touch();
     }
     return pNode;
   }
@@ -358,16 +2088,23 @@ struct FollySkipList {
     return std::make_unique<Iterator>(skiplist_, nullptr, this);
   }
 
+  std::unique_ptr<Iterator> NewIterator(SequenceNumber read_seq) {
+    auto iter = NewIterator();
+    iter->SetReadSequence(read_seq);
+    return iter;
+  }
+
   std::vector<std::string> DumpAllNodes() const {
     SkipListType::Accessor accessor(skiplist_);
     std::vector<std::string> xs;
     auto x = skiplist_->head_.load();
     while (x != nullptr) {
-      //      if (x->data().IsSentinel()) {
-      //        xs.emplace_back(SENTINEL_STR);
-      //      } else {
       xs.push_back(x->data().Key());
-      //      }
+      // An unknown gap after a node shows up as SENTINEL_STR; the tail has
+      // no gap after it.
+      if (x->next() != nullptr && x->data().IsSentinel()) {
+        xs.emplace_back(SENTINEL_STR);
+      }
       x = x->next();
     }
     return xs;
@@ -5,10 +5,13 @@
 #include <thread>
 #include <unordered_set>
 
+#include "db/wide/wide_column_serialization.h"
 #include "gtest/gtest.h"
 #include "memtable/follyskiplist.h"
+#include "rocksdb/omnicache.h"
 #include "rocksdb/slice.h"
 #include "test_util/testharness.h"
+#include "util/coding.h"
 
 namespace ROCKSDB_NAMESPACE {
 
@@ -41,9 +44,9 @@ class FollySkipListTest : public ::testing::Test {
     for (int i = x; i < x + count; ++i) {
       auto s = std::to_string(i);
       if (i == x) {
-        skiplist->Insert(s, s);
+        skiplist->Insert(s, s, 0);
       } else {
-        skiplist->Append(s, s);
+        skiplist->Append(s, s, 0);
       }
     }
   }
@@ -51,7 +54,7 @@ class FollySkipListTest : public ::testing::Test {
     assert(count > 0);
     for (int i = x; i < x + count; ++i) {
       auto s = std::to_string(i);
-      skiplist->Append(s, s);
+      skiplist->Append(s, s, 0);
     }
   }
 
@@ -59,7 +62,7 @@ class FollySkipListTest : public ::testing::Test {
   void ConcurrentInsert(int start, int count) {
     for (int i = start; i < start + count; ++i) {
       auto s = std::to_string(i);
-      skiplist->Insert(s, s);
+      skiplist->Insert(s, s, 0);
     }
   }
 
@@ -68,9 +71,9 @@ class FollySkipListTest : public ::testing::Test {
     for (int i = x; i < x + count; ++i) {
       auto s = std::to_string(i);
       if (i == x) {
-        skiplist->Insert(s, s);
+        skiplist->Insert(s, s, 0);
       } else {
-        skiplist->Append(s, s);
+        skiplist->Append(s, s, 0);
       }
     }
   }
@@ -348,6 +351,688 @@ TEST_F(FollySkipListTest, MultiThreadedOverlappingInsertRangeTest) {
   //  }
 }
 
+TEST_F(FollySkipListTest, SequenceVisibility) {
+  skiplist->Insert("10", "10", 5);
+
+  auto it = skiplist->NewIterator(4);
+  it->Seek("10");
+  ASSERT_FALSE(it->Valid());
+  it = skiplist->NewIterator(6);
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+
+  // Linking 11 makes the gap 10 -> 11 known only as of 8.
+  skiplist->Append("11", "11", 8);
+  it->Seek("10");
+  ASSERT_FALSE(it->Valid());
+
+  it = skiplist->NewIterator(8);
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "11");
+}
+
+TEST_F(FollySkipListTest, FillFence) {
+  skiplist->RaiseFillFence(10);
+  ASSERT_FALSE(skiplist->Insert("10", "10", 9)->Valid());
+  ASSERT_FALSE(skiplist->NewIterator(kMaxSequenceNumber)->Valid());
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_FALSE(it->Valid());
+
+  ASSERT_TRUE(skiplist->Insert("10", "10", 10)->Valid());
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+}
+
+TEST_F(FollySkipListTest, FillFencePerKey) {
+  // A write of one key does not hold back point fills of others, but any
+  // write may cut a gap a fill claims.
+  skiplist->ApplyPut("30", "v30", 10);
+  ASSERT_FALSE(skiplist->Insert("30", "old", 9)->Valid());
+  ASSERT_TRUE(skiplist->Insert("10", "10", 9)->Valid());
+  ASSERT_FALSE(skiplist->Append("10", "20", "20", 9)->Valid());
+  ASSERT_TRUE(skiplist->Append("10", "20", "20", 10)->Valid());
+}
+
+TEST_F(FollySkipListTest, FillFencePerSpan) {
+  // A span changed outside the write path holds back point fills inside it
+  // only, until a later change folds it.
+  skiplist->ApplyInvalidateRange("20", "30", 11);
+  ASSERT_FALSE(skiplist->Insert("25", "old", 10)->Valid());
+  ASSERT_FALSE(skiplist->Insert("30", "old", 10)->Valid());
+  ASSERT_TRUE(skiplist->Insert("50", "50", 10)->Valid());
+  ASSERT_TRUE(skiplist->Insert("25", "25", 11)->Valid());
+
+  skiplist->ApplyInvalidateRange("70", "80", 12);
+  ASSERT_FALSE(skiplist->Insert("75", "old", 11)->Valid());
+  ASSERT_FALSE(skiplist->Insert("60", "old", 10)->Valid());
+  ASSERT_TRUE(skiplist->Insert("60", "60", 11)->Valid());
+}
+
+TEST_F(FollySkipListTest, ApplyPutClosesRange) {
+  InsertRange(10, 4);
+  // "115" sorts between "11" and "12".
+  skiplist->ApplyPut("115", "v", 1);
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("11");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+
+  skiplist->ApplyPut("12", "v12", 2);
+  it->Seek("12");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Value(), "v12");
+  ASSERT_EQ(it->Seq(), 2u);
+}
+
+TEST_F(FollySkipListTest, ApplyDeleteRange) {
+  InsertRange(10, 6);
+  skiplist->ApplyDeleteRange("11", "14", 7);
+  CheckAllNodes({"10", "14", "15", SENTINEL_STR});
+
+  // Current readers step over the deleted keys ...
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "14");
+  // ... but older snapshots must not.
+  it = skiplist->NewIterator(6);
+  it->Seek("10");
+  ASSERT_FALSE(it->Valid());
+}
+
+TEST_F(FollySkipListTest, ApplyDeleteKeepsUnknownGaps) {
+  InsertRange(10, 2);
+  InsertRange(15, 2);
+  // 11 ends a filled range, the gap after it is unknown.
+  skiplist->ApplyDelete("11", 7);
+  CheckAllNodes({"10", SENTINEL_STR, "15", "16", SENTINEL_STR});
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+
+  skiplist->ApplyDeleteRange("15", "17", 8);
+  CheckAllNodes({"10", SENTINEL_STR});
+  it->Seek("10");
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+}
+
+TEST_F(FollySkipListTest, ApplyInvalidateRange) {
+  InsertRange(10, 6);
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("13");
+  it->Update("w", 1);
+  // An ingested file spanning [11, 14].
+  skiplist->ApplyInvalidateRange("11", "14", 7);
+
+  for (const char* key : {"11", "12", "14"}) {
+    it->Seek(key);
+    ASSERT_FALSE(it->Valid());
+    ASSERT_FALSE(it->KnownAbsent());
+  }
+  // The file may hold keys right after 10 and 13.
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+  // A write-back value is newer than the file, its entry stays.
+  it->Seek("13");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Value(), "w");
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+  it->Seek("15");
+  ASSERT_TRUE(it->Valid());
+
+  // Fills read before the ingestion are dropped.
+  ASSERT_FALSE(skiplist->Insert("12", "v12", 6)->Valid());
+  ASSERT_TRUE(skiplist->Insert("12", "v12", 7)->Valid());
+}
+
+TEST_F(FollySkipListTest, AppendAfterEvictedKey) {
+  skiplist->Insert("10", "10", 0);
+  skiplist->Append("10", "11", "11", 0);
+  // "11" goes away between the caller's read and its next append.
+  skiplist->Remove("11");
+  skiplist->Append("11", "12", "12", 0);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+}
+
+TEST_F(FollySkipListTest, ReverseScan) {
+  // A reverse scan of "10", "11", "12" from SeekToLast.
+  skiplist->InsertLast("12", "12", 5);
+  skiplist->Prepend("12", "11", "11", 5);
+  skiplist->Prepend("11", "10", "10", 5);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->SeekToLast();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "12");
+  it->Prev();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "11");
+  it->Prev();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "10");
+  // Nothing says "10" is the first key.
+  it->Prev();
+  ASSERT_FALSE(it->Valid());
+  it->SeekToFirst();
+  ASSERT_FALSE(it->Valid());
+
+  // The same ranges serve forward scans, up to the tail.
+  it->Seek("10");
+  it->Next();
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "12");
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+
+  it->SeekForPrev("115");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "11");
+  it->SeekForPrev("0");
+  ASSERT_FALSE(it->Valid());
+
+  // Older snapshots do not see the ranges.
+  auto old_it = skiplist->NewIterator(4);
+  old_it->SeekToLast();
+  ASSERT_FALSE(old_it->Valid());
+
+  skiplist->InsertFirst("10", "10", 5);
+  it->SeekToFirst();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "10");
+
+  // A write between two cached keys closes the range in both directions.
+  skiplist->ApplyPut("111", "111", 6);
+  it->SeekForPrev("115");
+  ASSERT_FALSE(it->Valid());
+  it->Seek("12");
+  it->Prev();
+  ASSERT_FALSE(it->Valid());
+  // And one past the last key ends SeekToLast hits.
+  skiplist->ApplyPut("13", "13", 7);
+  it->SeekToLast();
+  ASSERT_FALSE(it->Valid());
+}
+
+TEST_F(FollySkipListTest, PrependAfterEvictedKey) {
+  skiplist->InsertLast("12", "12", 0);
+  // "12" goes away between the caller's read and its next prepend.
+  skiplist->Remove("12");
+  skiplist->Prepend("12", "11", "11", 0);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("11");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_FALSE(it->Valid());
+  it->SeekToLast();
+  ASSERT_FALSE(it->Valid());
+}
+
+TEST_F(FollySkipListTest, MultiFind) {
+  skiplist->InsertBatch({{"10", "v10"}, {"12", "v12"}, {"14", "v14"}}, 5);
+  skiplist->Insert("16", "v16", 7);
+
+  std::vector<Slice> keys = {"09", "10", "10", "11", "14", "16", "17"};
+  std::map<size_t, std::string> hits;
+  skiplist->MultiFind(keys, 6, [&](size_t i, const FollyValue& value) {
+    hits[i] = value.Value().ToString();
+  });
+  // "16" only became valid at 7.
+  ASSERT_EQ(hits, (std::map<size_t, std::string>(
+                      {{1, "v10"}, {2, "v10"}, {4, "v14"}})));
+
+  // A write of a key after the read rejects its fill; a range write
+  // rejects the whole batch.
+  skiplist->ApplyPut("18", "w18", 9);
+  skiplist->InsertBatch({{"18", "v18"}, {"19", "v19"}}, 8);
+  hits.clear();
+  skiplist->MultiFind({"18", "19"}, kMaxSequenceNumber,
+                      [&](size_t i, const FollyValue& value) {
+                        hits[i] = value.Value().ToString();
+                      });
+  ASSERT_EQ(hits, (std::map<size_t, std::string>({{1, "v19"}})));
+
+  skiplist->ApplyDeleteRange("30", "40", 11);
+  skiplist->InsertBatch({{"21", "v21"}, {"22", "v22"}}, 10);
+  hits.clear();
+  skiplist->MultiFind({"21", "22"}, kMaxSequenceNumber,
+                      [&](size_t i, const FollyValue& value) {
+                        hits[i] = value.Value().ToString();
+                      });
+  ASSERT_TRUE(hits.empty());
+}
+
+TEST_F(FollySkipListTest, SharedValues) {
+  skiplist->SetPinValueMinSize(4);
+  skiplist->Insert("10", "v10", 0);
+  skiplist->Insert("11", "large11", 0);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_EQ(it->Data().SharedValue(), nullptr);
+  it->Seek("11");
+  auto pinned = it->Data().SharedValue();
+  ASSERT_NE(pinned, nullptr);
+  ASSERT_EQ(pinned->Value(), "large11");
+
+  // An update swaps the buffer; the reader keeps the old one, pinned or
+  // not, until it lets go of its accessor.
+  const Slice read = it->Value();
+  skiplist->ApplyPut("11", "v", 1);
+  ASSERT_EQ(it->Data().Value(), "v");
+  ASSERT_EQ(it->Data().SharedValue(), nullptr);
+  // The iterator stays on the version it checked.
+  ASSERT_EQ(it->Value(), "large11");
+  ASSERT_EQ(read, "large11");
+  it.reset();
+  ASSERT_EQ(pinned->Value(), "large11");
+}
+
+TEST_F(FollySkipListTest, PausedIterator) {
+  skiplist->Insert("10", "v10", 0);
+  skiplist->Append("10", "11", "v11", 0);
+  skiplist->Append("11", "12", "v12", 0);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  it->Pause();
+  // Nothing holds the old buffer of 10 now but the recycler.
+  skiplist->ApplyPut("10", "x", 1);
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "11");
+  it->Pause();
+  // Once the paused entry is gone, there is nothing to step from.
+  skiplist->Remove("11");
+  it->Prev();
+  ASSERT_FALSE(it->Valid());
+
+  it->Pause();
+  it->Seek("12");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Value(), "v12");
+}
+
+TEST_F(FollySkipListTest, Entities) {
+  std::string entity;
+  ASSERT_OK(WideColumnSerialization::Serialize(
+      {{kDefaultWideColumnName, "d"}, {"c", "v"}}, entity));
+  skiplist->Insert("10", entity, 0, true /* entity */);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_TRUE(it->Data().Entity());
+  PinnableSlice value;
+  OmniCache::PinValue(it->Current(), &value);
+  ASSERT_EQ(value, "d");
+  PinnableWideColumns columns;
+  ASSERT_OK(OmniCache::PinColumns(it->Current(), &columns));
+  ASSERT_EQ(columns.columns(),
+            WideColumns({{kDefaultWideColumnName, "d"}, {"c", "v"}}));
+
+  // A Put replaces the entity with a plain value, a PutEntity brings one
+  // back.
+  skiplist->ApplyPut("10", "p", 1);
+  ASSERT_FALSE(it->Data().Entity());
+  columns.Reset();
+  ASSERT_OK(OmniCache::PinColumns(it->Data().Current(), &columns));
+  ASSERT_EQ(columns.columns(), WideColumns({{kDefaultWideColumnName, "p"}}));
+  skiplist->ApplyPut("10", entity, 2, true /* entity */);
+  ASSERT_TRUE(it->Data().Entity());
+}
+
+TEST_F(FollySkipListTest, EntityFlagTravelsWithValue) {
+  skiplist->Insert("10", "p", 0);
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::thread reader([&] {
+    auto it = skiplist->NewIterator(kMaxSequenceNumber);
+    while (!stop.load()) {
+      it->Seek("10");
+      // Entities start with 'e', plain values with 'p'.
+      const FollyValue& current = it->Current();
+      if (current.Entity() != current.Value().starts_with("e")) {
+        ++torn;
+      }
+      it = skiplist->NewIterator(kMaxSequenceNumber);
+    }
+  });
+  for (SequenceNumber seq = 1; seq <= 100000; ++seq) {
+    const bool entity = seq % 2 == 0;
+    skiplist->ApplyPut("10", entity ? "e" : "p", seq, entity);
+  }
+  stop = true;
+  reader.join();
+  ASSERT_EQ(torn.load(), 0);
+}
+
+TEST_F(FollySkipListTest, ValueNeverNewerThanItsSequence) {
+  skiplist->Insert("10", "0", 0);
+  std::atomic<SequenceNumber> last{0};
+  std::atomic<bool> stop{false};
+  std::atomic<int> torn{0};
+  std::thread reader([&] {
+    while (!stop.load()) {
+      const SequenceNumber read_seq = last.load();
+      auto it = skiplist->NewIterator(read_seq);
+      it->Seek("10");
+      // Every value is the sequence number it was written at.
+      if (it->Valid() &&
+          std::stoull(it->Current().Value().ToString()) > read_seq) {
+        ++torn;
+      }
+    }
+  });
+  for (SequenceNumber seq = 1; seq <= 100000; ++seq) {
+    skiplist->ApplyPut("10", std::to_string(seq), seq);
+    last = seq;
+  }
+  stop = true;
+  reader.join();
+  ASSERT_EQ(torn.load(), 0);
+}
+
+TEST_F(FollySkipListTest, NegativeEntries) {
+  // 10 -> (12) -> 15, as a reverse and a forward scan around a Seek(12)
+  // that found nothing would leave them.
+  skiplist->InsertAbsent("12", 5);
+  skiplist->Append("12", "15", "v15", 5);
+  skiplist->Prepend("12", "10", "v10", 5);
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("12");
+  ASSERT_FALSE(it->Valid());
+  ASSERT_TRUE(it->KnownAbsent());
+  // In the gaps on either side.
+  it->Seek("11");
+  ASSERT_TRUE(it->KnownAbsent());
+  it->Seek("13");
+  ASSERT_TRUE(it->KnownAbsent());
+  // After the range, and before it: nothing is known.
+  it->Seek("16");
+  ASSERT_FALSE(it->KnownAbsent());
+  it->Seek("09");
+  ASSERT_FALSE(it->KnownAbsent());
+  // Not for readers older than the fill.
+  auto old_it = skiplist->NewIterator(4);
+  old_it->Seek("12");
+  ASSERT_FALSE(old_it->KnownAbsent());
+
+  // Scans step over the negative entry.
+  it->Seek("10");
+  ASSERT_TRUE(it->Valid());
+  it->Next();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "15");
+  it->Prev();
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "10");
+  it->LowerBound("11");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "15");
+  it->SeekForPrev("13");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Key(), "10");
+  it->LowerBound("16");
+  ASSERT_FALSE(it->Valid());
+
+  std::map<size_t, std::string> hits;
+  std::vector<size_t> absent;
+  skiplist->MultiFind(
+      {"09", "10", "11", "12", "13", "15", "16"}, kMaxSequenceNumber,
+      [&](size_t i, const FollyValue& value) {
+        hits[i] = value.Value().ToString();
+      },
+      [&](size_t i) { absent.push_back(i); });
+  ASSERT_EQ(hits,
+            (std::map<size_t, std::string>({{1, "v10"}, {5, "v15"}})));
+  ASSERT_EQ(absent, std::vector<size_t>({2, 3, 4}));
+
+  // A Put turns the negative entry into a value; a Put into a gap makes it
+  // unknown again.
+  skiplist->ApplyPut("12", "v12", 6);
+  it->Seek("12");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_FALSE(it->KnownAbsent());
+  ASSERT_EQ(it->Value(), "v12");
+  skiplist->ApplyPut("14", "v14", 7);
+  it->Seek("13");
+  ASSERT_FALSE(it->KnownAbsent());
+
+  skiplist->InsertBatch({{"20", "", false, true /* absent */}}, 8);
+  it->Seek("20");
+  ASSERT_TRUE(it->KnownAbsent());
+}
+
+TEST_F(FollySkipListTest, PointIndex) {
+  using IndexType = FollySkipList::IndexType;
+  skiplist->Insert("10", "10", 0);
+  skiplist->Insert("12", "12", 0);
+  FollySkipList::NodeType* pNode =
+      skiplist->index_.Lookup(IndexType::Hash("12"));
+  ASSERT_NE(pNode, nullptr);
+  ASSERT_EQ(pNode->data().Key(), "12");
+  ASSERT_EQ(skiplist->Seek("12"), pNode);
+
+  // Removal unpublishes the node; lookups fall back to the descent.
+  ASSERT_TRUE(skiplist->Remove("12"));
+  ASSERT_EQ(skiplist->index_.Lookup(IndexType::Hash("12")), nullptr);
+  ASSERT_EQ(skiplist->Seek("12")->data().Key(), "10");
+
+  skiplist->ApplyDelete("10", 1);
+  ASSERT_EQ(skiplist->index_.Lookup(IndexType::Hash("10")), nullptr);
+}
+
+TEST(FollySkipListEvictTest, BackgroundEviction) {
+  const size_t budget = 64 << 10;
+  TestComparator cmp;
+  FollySkipList skiplist(32, &cmp, budget);
+  for (int i = 0; i < 4096; ++i) {
+    auto s = std::to_string(i);
+    skiplist.Insert(s, std::string(64, 'v'), 0);
+    // Fills beyond the hard watermark are dropped, never evicted inline.
+    ASSERT_LE(skiplist.ApproximateMemoryUsage(),
+              budget + budget / 4 + 4096);
+  }
+  for (int i = 0; i < 1000 && skiplist.ApproximateMemoryUsage() > budget;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_LE(skiplist.ApproximateMemoryUsage(), budget);
+  ASSERT_EQ(skiplist.EvictQueueDepth(), 0u);
+}
+
+TEST(FollySkipListEvictTest, AdmissionFilter) {
+  TestComparator cmp;
+  FollySkipList skiplist(32, &cmp, 64 << 10);
+  // Fill up to the low watermark; admission only applies above it.
+  for (int i = 0; skiplist.ApproximateMemoryUsage() <=
+                  skiplist.lowWatermark_.load();
+       ++i) {
+    skiplist.Insert("hot" + std::to_string(i), "v", 0);
+  }
+  skiplist.SetAdmissionMinFrequency(2);
+
+  // A scan reads each key once.
+  ASSERT_FALSE(skiplist.Insert("scan0", "v", 0)->Valid());
+  ASSERT_FALSE(skiplist.Insert("scan1", "v", 0)->Valid());
+  // A key read again gets in.
+  ASSERT_TRUE(skiplist.Insert("scan0", "v", 0)->Valid());
+  // Cached keys are always refreshed.
+  ASSERT_TRUE(skiplist.Insert("hot0", "v2", 1)->Valid());
+
+  skiplist.SetAdmissionMinFrequency(0);
+  ASSERT_TRUE(skiplist.Insert("scan2", "v", 0)->Valid());
+}
+
+TEST_F(FollySkipListTest, SetCapacity) {
+  for (int i = 0; i < 1024; ++i) {
+    auto s = std::to_string(i);
+    skiplist->Insert(s, std::string(64, 'v'), 0);
+  }
+  const size_t budget = 16 << 10;
+  ASSERT_GT(skiplist->ApproximateMemoryUsage(), budget);
+
+  skiplist->SetCapacity(budget);
+  ASSERT_EQ(skiplist->GetCapacity(), budget);
+  for (int i = 0; i < 1000 && skiplist->ApproximateMemoryUsage() > budget;
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_LE(skiplist->ApproximateMemoryUsage(), budget);
+}
+
+TEST_F(FollySkipListTest, MinDirtyLogNumber) {
+  InsertRange(10, 4);
+  ASSERT_EQ(skiplist->MinDirtyLogNumber(),
+            std::numeric_limits<uint64_t>::max());
+
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("11");
+  it->Update("a", 1, 3);
+  it->Seek("12");
+  it->Update("b", 1, 2);
+  ASSERT_EQ(skiplist->MinDirtyLogNumber(), 2u);
+
+  // An unlogged update keeps the entry on its last logged file.
+  it->Update("c", 2);
+  ASSERT_EQ(skiplist->MinDirtyLogNumber(), 2u);
+
+  // Written back, the entry no longer holds on to its file.
+  skiplist->ApplyPut("12", "c", 3);
+  ASSERT_EQ(skiplist->MinDirtyLogNumber(), 3u);
+}
+
+TEST_F(FollySkipListTest, WriteBackUpdate) {
+  InsertRange(10, 2);
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  ASSERT_TRUE(it->Update("a", 5));
+  // A write-back never moves the entry back in time.
+  ASSERT_TRUE(it->Update("b", 3));
+  ASSERT_EQ(it->Seq(), 5u);
+  ASSERT_EQ(it->Value(), "b");
+
+  // Eviction and fill rollbacks leave a dirty entry alone.
+  ASSERT_FALSE(skiplist->Remove("10", true /* only_clean */));
+  ASSERT_EQ(it->Data().Value(), "b");
+
+  // Once the entry is being removed the value has to go elsewhere.
+  ASSERT_TRUE(skiplist->Remove("10"));
+  ASSERT_FALSE(it->Update("c", 6));
+}
+
+TEST_F(FollySkipListTest, WriteBackKeepsNewerValue) {
+  InsertRange(10, 1);
+  auto it = skiplist->NewIterator(kMaxSequenceNumber);
+  it->Seek("10");
+  it->Update("a", 1, 2);
+  // The evictor stages "a", then a write-back hit replaces it.
+  FollyValueHandle staged = it->Data().Current().Hold();
+  it->Update("b", 1, 3);
+  // The write of "a" reaches the memtable and is done.
+  skiplist->ApplyWriteBack("10", 2);
+  skiplist->CleanIfStaged(skiplist->FindEntry("10"), staged.get());
+  ASSERT_TRUE(it->Data().Dirty());
+  ASSERT_EQ(it->Data().Value(), "b");
+  ASSERT_EQ(skiplist->MinDirtyLogNumber(), 3u);
+
+  // Once "b" is written back too, the entry is clean.
+  staged = it->Data().Current().Hold();
+  skiplist->ApplyWriteBack("10", 3);
+  skiplist->CleanIfStaged(skiplist->FindEntry("10"), staged.get());
+  ASSERT_FALSE(it->Data().Dirty());
+  ASSERT_EQ(skiplist->MinDirtyLogNumber(),
+            std::numeric_limits<uint64_t>::max());
+}
+
+TEST(FollySkipListComparatorTest, ReverseBytewise) {
+  FollySkipList skiplist(32, ReverseBytewiseComparator(), 1 << 20);
+  skiplist.Insert("c", "c", 0);
+  skiplist.Append("c", "b", "b", 0);
+  skiplist.Append("b", "a", "a", 0);
+
+  std::vector<std::string> keys;
+  auto it = skiplist.NewIterator(kMaxSequenceNumber);
+  for (it->Seek("c"); it->Valid(); it->Next()) {
+    keys.push_back(it->Key());
+  }
+  ASSERT_EQ(keys, std::vector<std::string>({"c", "b", "a"}));
+}
+
+TEST(FollySkipListComparatorTest, AbbreviatedKeys) {
+  FollySkipList skiplist(32, BytewiseComparator(), 1 << 20);
+  // Equal prefixes, including zero padding, fall back to the full key.
+  for (const std::string& k :
+       {std::string("key00000b"), std::string("key00000a"), std::string("a"),
+        std::string("a\0", 2), std::string("b")}) {
+    skiplist.Insert(k, k, 0);
+  }
+  // Separate fills, so every gap is unknown.
+  ASSERT_EQ(skiplist.DumpAllNodes(),
+            std::vector<std::string>(
+                {"", SENTINEL_STR, "a", SENTINEL_STR, std::string("a\0", 2),
+                 SENTINEL_STR, "b", SENTINEL_STR, "key00000a", SENTINEL_STR,
+                 "key00000b", SENTINEL_STR, TAIL}));
+}
+
+TEST(FollySkipListComparatorTest, Timestamps) {
+  FollySkipList skiplist(32, BytewiseComparatorWithU64Ts(), 1 << 20);
+  auto with_ts = [](const std::string& key, uint64_t ts) {
+    std::string ret = key;
+    PutFixed64(&ret, ts);
+    return ret;
+  };
+  skiplist.Insert(with_ts("k", 10), "v10", 1);
+  auto it = skiplist.NewIterator(kMaxSequenceNumber);
+
+  // Writes below the cached version's timestamp leave it alone.
+  skiplist.ApplyPut(with_ts("k", 5), "v5", 2);
+  it->Seek("k");
+  ASSERT_TRUE(it->Valid());
+  ASSERT_EQ(it->Value(), "v10");
+  skiplist.ApplyPut(with_ts("k", 20), "v20", 3);
+  it->Seek("k");
+  ASSERT_EQ(it->Value(), "v20");
+  // The node keeps its key, the version travels with the value.
+  ASSERT_EQ(it->Key(), with_ts("k", 10));
+  ASSERT_EQ(it->Data().Timestamp(), with_ts("", 20));
+  skiplist.ApplyDelete(with_ts("k", 15), 4);
+  it->Seek("k");
+  ASSERT_TRUE(it->Valid());
+  skiplist.ApplyDelete(with_ts("k", 25), 5);
+  it->Seek("k");
+  ASSERT_FALSE(it->Valid());
+
+  const std::string max_ts(8, '\xff');
+  const std::string old_ts = with_ts("", 5);
+  const Slice max_ts_slice(max_ts);
+  const Slice old_ts_slice(old_ts);
+  ASSERT_TRUE(skiplist.ServesReadsAt(&max_ts_slice));
+  ASSERT_FALSE(skiplist.ServesReadsAt(&old_ts_slice));
+  ASSERT_FALSE(skiplist.ServesReadsAt(nullptr));
+}
+
 TEST_F(FollySkipListTest, BasicOverlapRandom) {
   using namespace std::chrono;
   auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch())
@@ -367,9 +1052,9 @@ TEST_F(FollySkipListTest, BasicOverlapRandom) {
       auto str = std::to_string(start + len);
       s.insert(str);
       if (len == 0) {
-        skiplist->Insert(str, str);
+        skiplist->Insert(str, str, 0);
       } else {
-        skiplist->Append(str, str);
+        skiplist->Append(str, str, 0);
       }
     }
 //    auto act = skiplist->DumpAllNodesNoSentinel();
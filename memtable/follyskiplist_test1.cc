@@ -39,9 +39,9 @@ class FollySkipListTest : public ::testing::Test {
     for (int i = x; i < x + count; ++i) {
       auto s = std::to_string(i);
       if (i == x) {
-        skiplist->Insert(s, s);
+        skiplist->Insert(s, s, 0);
       } else {
-        skiplist->Append(s, s);
+        skiplist->Append(s, s, 0);
       }
     }
   }
@@ -49,7 +49,7 @@ class FollySkipListTest : public ::testing::Test {
     assert(count > 0);
     for (int i = x; i < x + count; ++i) {
       auto s = std::to_string(i);
-      skiplist->Append(s, s);
+      skiplist->Append(s, s, 0);
     }
   }
 
@@ -57,7 +57,7 @@ class FollySkipListTest : public ::testing::Test {
   void ConcurrentInsert(int start, int count) {
     for (int i = start; i < start + count; ++i) {
       auto s = std::to_string(i);
-      skiplist->Insert(s, s);
+      skiplist->Insert(s, s, 0);
     }
   }
 
@@ -66,9 +66,9 @@ class FollySkipListTest : public ::testing::Test {
     for (int i = x; i < x + count; ++i) {
       auto s = std::to_string(i);
       if (i == x) {
-        skiplist->Insert(s, s);
+        skiplist->Insert(s, s, 0);
       } else {
-        skiplist->Append(s, s);
+        skiplist->Append(s, s, 0);
       }
     }
   }
@@ -231,10 +231,10 @@ TEST_F(FollySkipListTest, BasicNext2) {
   InsertRange(10, 2);
   InsertRange(15, 2);
 
-  skiplist->Insert("12", "12");
-  skiplist->Append("13", "13");
-  skiplist->Append("14", "14");
-  skiplist->Append("15", "15");
+  skiplist->Insert("12", "12", 0);
+  skiplist->Append("13", "13", 0);
+  skiplist->Append("14", "14", 0);
+  skiplist->Append("15", "15", 0);
 
   auto it = skiplist->NewIterator();
   it->Seek("0");
@@ -435,9 +435,9 @@ TEST_F(FollySkipListTest, BasicOverlapRandom) {
       auto str = std::to_string(start + len);
       s.insert(str);
       if (len == 0) {
-        skiplist->Insert(str, str);
+        skiplist->Insert(str, str, 0);
       } else {
-        skiplist->Append(str, str);
+        skiplist->Append(str, str, 0);
       }
     }
     //    auto act = skiplist->DumpAllNodesNoSentinel();
@@ -0,0 +1,120 @@
+#ifndef ROCKSDB_FREQUENCY_SKETCH_H
+#define ROCKSDB_FREQUENCY_SKETCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace rocksdb {
+
+// TinyLFU frequency sketch
+//
+// Approximate read counts of recently read keys, by key hash: a count-min
+// sketch of 4 rows of saturating counters behind a doorkeeper bitmap. The
+// first read of a key only sets its doorkeeper bit, so keys read once (a
+// scan) never reach the counters. After 10 reads per counter the counters
+// are halved and the doorkeeper cleared, so old popularity fades.
+//
+// Updates are relaxed and may lose increments under contention; the counts
+// are estimates anyway.
+class FrequencySketch {
+ public:
+  static const uint32_t kMaxCount = 15;
+
+  // `width` counters per row, rounded up to a power of two.
+  explicit FrequencySketch(size_t width) {
+    width_ = 64;
+    while (width_ < width) {
+      width_ <<= 1;
+    }
+    counters_.reset(new std::atomic<uint8_t>[kDepth * width_]);
+    doorkeeper_.reset(new std::atomic<uint64_t>[width_ / 64]);
+    for (size_t i = 0; i < kDepth * width_; ++i) {
+      counters_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < width_ / 64; ++i) {
+      doorkeeper_[i].store(0, std::memory_order_relaxed);
+    }
+    sample_size_ = 10 * width_;
+  }
+
+  void Increment(uint64_t hash) {
+    std::atomic<uint64_t>& word = doorkeeper_[DoorkeeperIndex(hash) / 64];
+    const uint64_t bit = uint64_t{1} << (DoorkeeperIndex(hash) % 64);
+    if ((word.fetch_or(bit, std::memory_order_relaxed) & bit) != 0) {
+      for (size_t i = 0; i < kDepth; ++i) {
+        std::atomic<uint8_t>& counter = counters_[CounterIndex(hash, i)];
+        const uint8_t count = counter.load(std::memory_order_relaxed);
+        if (count < kMaxCount) {
+          counter.store(count + 1, std::memory_order_relaxed);
+        }
+      }
+    }
+    if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 >=
+        sample_size_) {
+      Age();
+    }
+  }
+
+  // Reads of `hash` since it was last aged out, at most kMaxCount + 1.
+  uint32_t Estimate(uint64_t hash) const {
+    const uint64_t word =
+        doorkeeper_[DoorkeeperIndex(hash) / 64].load(std::memory_order_relaxed);
+    if ((word & (uint64_t{1} << (DoorkeeperIndex(hash) % 64))) == 0) {
+      return 0;
+    }
+    uint32_t count = kMaxCount;
+    for (size_t i = 0; i < kDepth; ++i) {
+      count = std::min<uint32_t>(
+          count,
+          counters_[CounterIndex(hash, i)].load(std::memory_order_relaxed));
+    }
+    return count + 1;
+  }
+
+  size_t ApproximateMemoryUsage() const {
+    return kDepth * width_ + width_ / 8;
+  }
+
+ private:
+  static const size_t kDepth = 4;
+
+  size_t CounterIndex(uint64_t hash, size_t row) const {
+    static const uint64_t kSeeds[kDepth] = {
+        0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL,
+        0xd6e8feb86659fd93ULL};
+    return row * width_ + ((hash * kSeeds[row]) >> 32) % width_;
+  }
+
+  size_t DoorkeeperIndex(uint64_t hash) const { return hash % width_; }
+
+  // Only one thread ages at a time; the others keep counting.
+  void Age() {
+    bool expected = false;
+    if (!aging_.compare_exchange_strong(expected, true)) {
+      return;
+    }
+    for (size_t i = 0; i < kDepth * width_; ++i) {
+      counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2,
+                         std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < width_ / 64; ++i) {
+      doorkeeper_[i].store(0, std::memory_order_relaxed);
+    }
+    additions_.store(0, std::memory_order_relaxed);
+    aging_.store(false, std::memory_order_release);
+  }
+
+  size_t width_;
+  size_t sample_size_;
+  std::unique_ptr<std::atomic<uint8_t>[]> counters_;
+  std::unique_ptr<std::atomic<uint64_t>[]> doorkeeper_;
+  std::atomic<size_t> additions_{0};
+  std::atomic<bool> aging_{false};
+};
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_FREQUENCY_SKETCH_H
@@ -0,0 +1,29 @@
+#include "gtest/gtest.h"
+#include "memtable/frequency_sketch.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(FrequencySketchTest, Estimate) {
+  FrequencySketch sketch(1024);
+  ASSERT_EQ(sketch.Estimate(42), 0u);
+  // The first read only reaches the doorkeeper.
+  sketch.Increment(42);
+  ASSERT_EQ(sketch.Estimate(42), 1u);
+  for (int i = 0; i < 100; ++i) {
+    sketch.Increment(42);
+  }
+  ASSERT_EQ(sketch.Estimate(42), FrequencySketch::kMaxCount + 1);
+  // Aging halves the counters and clears the doorkeeper.
+  for (uint64_t h = 1000; h < 1000 + 10 * 1024; ++h) {
+    sketch.Increment(h);
+  }
+  ASSERT_EQ(sketch.Estimate(42), 0u);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
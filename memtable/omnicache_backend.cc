@@ -0,0 +1,141 @@
+#include "memtable/omnicache_backend.h"
+
+#include <atomic>
+
+#include "memtable/cacheskiplist.h"
+#include "memtable/follyskiplist.h"
+
+namespace rocksdb {
+
+namespace {
+
+// The skiplist OmniCache runs on. Writers swap in new value buffers, so
+// readers copy values without a lock; every write bumps the sequence so
+// fills raced by a write are fenced off as in a DB.
+class FollySkipListBackend : public OmniCacheBackend {
+ public:
+  FollySkipListBackend(const Comparator* cmp, size_t capacity)
+      : list_(32, cmp, capacity), seq_(1) {}
+
+  const char* Name() const override { return "FollySkipList"; }
+
+  void Insert(const Slice& key, const Slice& value) override {
+    list_.Insert(key, value, seq_.load(std::memory_order_acquire));
+  }
+
+  void Append(const Slice& prev_key, const Slice& key,
+              const Slice& value) override {
+    list_.Append(prev_key, key, value, seq_.load(std::memory_order_acquire));
+  }
+
+  void Update(const Slice& key, const Slice& value) override {
+    list_.ApplyPut(key, value, seq_.fetch_add(1) + 1);
+  }
+
+  bool Get(const Slice& key, std::string* value) override {
+    auto iter = list_.NewIterator(kMaxSequenceNumber);
+    iter->Seek(key);
+    if (!iter->Valid()) {
+      return false;
+    }
+    value->assign(iter->Value().ToStringView());
+    return true;
+  }
+
+  size_t Scan(const Slice& key, size_t count) override {
+    auto iter = list_.NewIterator(kMaxSequenceNumber);
+    std::string value;
+    size_t n = 0;
+    for (iter->Seek(key); iter->Valid() && n < count; iter->Next()) {
+      value.assign(iter->Value().ToStringView());
+      n++;
+    }
+    return n;
+  }
+
+ private:
+  FollySkipList list_;
+  std::atomic<SequenceNumber> seq_;
+};
+
+// The earlier range skiplist: sentinels between ranges and a mutex per
+// node, which readers take while they copy a value. It has no sequence
+// numbers, so it cannot fence fills against writes.
+class CacheSkipListBackend : public OmniCacheBackend {
+ public:
+  CacheSkipListBackend(const Comparator* cmp, size_t capacity)
+      : list_(CACHESKIPLIST_MAXLEVEL, cmp, capacity), cmp_(cmp) {}
+
+  const char* Name() const override { return "CacheSkipList"; }
+
+  void Insert(const Slice& key, const Slice& value) override {
+    list_.Insert(key, value);
+  }
+
+  // CacheSkipList extends whichever range ends right before `key`.
+  void Append(const Slice& /*prev_key*/, const Slice& key,
+              const Slice& value) override {
+    list_.Append(key, value);
+  }
+
+  void Update(const Slice& key, const Slice& value) override {
+    auto x = Find(key);
+    if (x != nullptr) {
+      list_.M_UpdateValue(x, value);
+    }
+  }
+
+  bool Get(const Slice& key, std::string* value) override {
+    auto x = Find(key);
+    if (x == nullptr) {
+      return false;
+    }
+    CopyValue(x, value);
+    return true;
+  }
+
+  size_t Scan(const Slice& key, size_t count) override {
+    std::string value;
+    size_t n = 0;
+    for (auto x = Find(key); x != nullptr && !x->IsSentinel() && n < count;
+         x = x->Next(0)) {
+      CopyValue(x, &value);
+      n++;
+    }
+    return n;
+  }
+
+ private:
+  // The node of a cached `key`, nullptr on a miss.
+  CacheSkipList::NodePtrType Find(const Slice& key) {
+    auto x = list_.Seek(key);
+    if (x == nullptr || x->IsSentinel() || cmp_->Compare(x->Key(), key) != 0) {
+      return nullptr;
+    }
+    return x;
+  }
+
+  static void CopyValue(CacheSkipList::NodePtrType x, std::string* value) {
+    x->Lock();
+    value->assign(x->Value());
+    x->Unlock();
+  }
+
+  CacheSkipList list_;
+  const Comparator* cmp_;
+};
+
+}  // namespace
+
+std::unique_ptr<OmniCacheBackend> NewOmniCacheBackend(
+    OmniCacheBackendType type, const Comparator* cmp, size_t capacity) {
+  switch (type) {
+    case OmniCacheBackendType::kFollySkipList:
+      return std::make_unique<FollySkipListBackend>(cmp, capacity);
+    case OmniCacheBackendType::kCacheSkipList:
+      return std::make_unique<CacheSkipListBackend>(cmp, capacity);
+  }
+  return nullptr;
+}
+
+}  // namespace rocksdb
@@ -0,0 +1,55 @@
+#ifndef ROCKSDB_OMNICACHE_BACKEND_H
+#define ROCKSDB_OMNICACHE_BACKEND_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "rocksdb/comparator.h"
+#include "rocksdb/slice.h"
+
+namespace rocksdb {
+
+enum class OmniCacheBackendType {
+  kFollySkipList,
+  kCacheSkipList,
+};
+
+// OmniCache backend
+//
+// The range-cache operations OmniCache needs from its index, over the two
+// skiplists in this directory, so they can be compared under the same
+// workload. Keys are user keys ordered by `cmp`; a cached range is a run of
+// keys filled with Append, whose gaps are known to hold nothing.
+//
+// All calls are safe to make concurrently. Values are copied out, so the
+// callers never hold on to cache memory.
+class OmniCacheBackend {
+ public:
+  virtual ~OmniCacheBackend() {}
+
+  virtual const char* Name() const = 0;
+
+  // Caches `key` on its own: the gaps around it stay unknown.
+  virtual void Insert(const Slice& key, const Slice& value) = 0;
+  // Caches `key` as the successor of the cached `prev_key`, so the gap
+  // between them is known to be empty.
+  virtual void Append(const Slice& prev_key, const Slice& key,
+                      const Slice& value) = 0;
+  // Write hook: replaces the value of `key` if it is cached.
+  virtual void Update(const Slice& key, const Slice& value) = 0;
+
+  // Copies the cached value of `key` into `value`; false on a miss.
+  virtual bool Get(const Slice& key, std::string* value) = 0;
+  // Reads up to `count` entries from the cached `key` on, stopping at the
+  // end of its range; returns the number of entries read.
+  virtual size_t Scan(const Slice& key, size_t count) = 0;
+};
+
+// `capacity` is the value bytes the backend may hold before it evicts.
+std::unique_ptr<OmniCacheBackend> NewOmniCacheBackend(
+    OmniCacheBackendType type, const Comparator* cmp, size_t capacity);
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_OMNICACHE_BACKEND_H
@@ -0,0 +1,42 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "memtable/omnicache_backend.h"
+#include "rocksdb/comparator.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(OmniCacheBackendTest, RangesAndUpdates) {
+  for (auto type : {OmniCacheBackendType::kFollySkipList,
+                    OmniCacheBackendType::kCacheSkipList}) {
+    auto cache = NewOmniCacheBackend(type, BytewiseComparator(), 1 << 20);
+    cache->Insert("a", "a");
+    cache->Append("a", "b", "b");
+    cache->Append("b", "c", "c");
+    cache->Insert("m", "m");
+
+    std::string value;
+    ASSERT_TRUE(cache->Get("b", &value)) << cache->Name();
+    ASSERT_EQ(value, "b");
+    ASSERT_FALSE(cache->Get("x", &value)) << cache->Name();
+    ASSERT_EQ(cache->Scan("a", 10), 3u) << cache->Name();
+    ASSERT_EQ(cache->Scan("a", 2), 2u) << cache->Name();
+    ASSERT_EQ(cache->Scan("m", 10), 1u) << cache->Name();
+    ASSERT_EQ(cache->Scan("x", 10), 0u) << cache->Name();
+
+    cache->Update("b", "B");
+    ASSERT_TRUE(cache->Get("b", &value)) << cache->Name();
+    ASSERT_EQ(value, "B");
+    // Only refreshes cached keys.
+    cache->Update("x", "x");
+    ASSERT_FALSE(cache->Get("x", &value)) << cache->Name();
+  }
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#ifndef ROCKSDB_POINT_INDEX_H
+#define ROCKSDB_POINT_INDEX_H
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+#include "rocksdb/slice.h"
+#include "util/hash.h"
+#include "util/hash_containers.h"
+
+namespace rocksdb {
+
+// Point lookup index over the skiplist
+//
+// Maps the hash of a user key (without timestamp) to the node caching it,
+// so a point hit costs one hash probe instead of a skiplist descent. The
+// index is only a hint: two keys whose hashes collide share one slot, and
+// keys that the column family's comparator considers equal without being
+// bytewise equal never meet. Callers check the node they get back and fall
+// back to the skiplist on any doubt.
+//
+// Nodes are published after they are linked and unpublished after they
+// are marked for removal, both under the shard lock. A node seen here is
+// therefore still protected by the skiplist accessor of whoever is about
+// to unpublish it, and stays valid for the caller's own accessor.
+template <class NodeType>
+class PointIndex {
+ public:
+  static const size_t kNumShards = 64;
+  // Charged per cached node on top of the node itself.
+  static const size_t kEntryCharge = 4 * sizeof(void*);
+
+  static uint64_t Hash(const Slice& user_key) {
+    return GetSliceNPHash64(user_key);
+  }
+
+  // The node last published for `hash`, nullptr if none.
+  NodeType* Lookup(uint64_t hash) const {
+    const Shard& shard = GetShard(hash);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex_);
+    auto it = shard.map_.find(hash);
+    return it != shard.map_.end() ? it->second : nullptr;
+  }
+
+  // Publish a node just added to the skiplist. A concurrent removal may
+  // already have marked it, in which case it is not kept.
+  void Insert(uint64_t hash, NodeType* node) {
+    Shard& shard = GetShard(hash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+    if (!node->markedForRemoval()) {
+      shard.map_[hash] = node;
+    }
+  }
+
+  // Called after a node with this hash was removed from the skiplist. Drops
+  // the slot if the node in it is marked, whichever node that was.
+  void Erase(uint64_t hash) {
+    Shard& shard = GetShard(hash);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex_);
+    auto it = shard.map_.find(hash);
+    if (it != shard.map_.end() && it->second->markedForRemoval()) {
+      shard.map_.erase(it);
+    }
+  }
+
+ private:
+  struct Shard {
+    mutable std::shared_mutex mutex_;
+    UnorderedMap<uint64_t, NodeType*> map_;
+  };
+
+  // The low bits pick the bucket inside a shard.
+  Shard& GetShard(uint64_t hash) { return shards_[(hash >> 58) % kNumShards]; }
+  const Shard& GetShard(uint64_t hash) const {
+    return shards_[(hash >> 58) % kNumShards];
+  }
+
+  Shard shards_[kNumShards];
+};
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_POINT_INDEX_H
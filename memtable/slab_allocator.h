@@ -0,0 +1,279 @@
+#ifndef ROCKSDB_SLAB_ALLOCATOR_H
+#define ROCKSDB_SLAB_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "port/port.h"
+#include "util/core_local.h"
+#include "util/mutexlock.h"
+
+namespace rocksdb {
+
+// Slab allocator for skiplist nodes
+//
+// Nodes only come in a few sizes (the node plus one to MAX_HEIGHT tower
+// pointers) and churn at the rate of fills and evictions. Blocks of each
+// size class are carved from kSlabSize slabs. A freed block goes on the
+// free list of the core freeing it, and the next allocation of that class
+// on the core takes it back without touching shared state. Cores that free
+// more than they allocate hand blocks to the shared lists in batches.
+//
+// Slabs are only given back when the allocator goes away: memory freed by
+// eviction stays with the cache for the fills that follow, instead of
+// fragmenting the heap. It is still counted, see IdleBytes(). Blocks larger
+// than kMaxClassSize go to malloc.
+class SlabAllocator {
+ public:
+  static const size_t kAlignment = 16;
+  static const size_t kMaxClassSize = 512;
+  static const size_t kNumClasses = kMaxClassSize / kAlignment;
+  static const size_t kSlabSize = 256 << 10;
+  // Blocks moved between a core and the shared lists at a time.
+  static const size_t kBatch = 32;
+  // Free blocks a core keeps per class.
+  static const size_t kMaxCoreFree = 4 * kBatch;
+
+  SlabAllocator() = default;
+
+  ~SlabAllocator() {
+    for (char* slab : slabs_) {
+      std::free(slab);
+    }
+  }
+
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+  // Bytes actually taken by an allocation of `bytes`.
+  static size_t ClassSize(size_t bytes) {
+    return bytes <= kMaxClassSize
+               ? (bytes + kAlignment - 1) / kAlignment * kAlignment
+               : bytes;
+  }
+
+  void* Allocate(size_t bytes) {
+    if (bytes == 0 || bytes > kMaxClassSize) {
+      return std::malloc(bytes);
+    }
+    const size_t cls = ClassIndex(bytes);
+    CoreCache* core = cores_.Access();
+    {
+      std::lock_guard<SpinMutex> lock(core->mutex_);
+      if (core->lists_[cls].head_ != nullptr) {
+        core->AddInUse(ClassSize(bytes));
+        return core->lists_[cls].Pop();
+      }
+    }
+    FreeList refill;
+    Refill(cls, &refill);
+    void* p = refill.Pop();
+    std::lock_guard<SpinMutex> lock(core->mutex_);
+    core->AddInUse(ClassSize(bytes));
+    core->lists_[cls].Splice(&refill);
+    return p;
+  }
+
+  void Deallocate(void* p, size_t bytes) {
+    if (bytes == 0 || bytes > kMaxClassSize) {
+      std::free(p);
+      return;
+    }
+    const size_t cls = ClassIndex(bytes);
+    CoreCache* core = cores_.Access();
+    FreeList spill;
+    {
+      std::lock_guard<SpinMutex> lock(core->mutex_);
+      core->AddInUse(-static_cast<int64_t>(ClassSize(bytes)));
+      FreeList& list = core->lists_[cls];
+      list.Push(p);
+      if (list.count_ > kMaxCoreFree) {
+        for (size_t i = 0; i < kBatch; ++i) {
+          spill.Push(list.Pop());
+        }
+      }
+    }
+    if (spill.head_ != nullptr) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shared_[cls].Splice(&spill);
+    }
+  }
+
+  // Bytes held in slabs, used or free.
+  size_t ApproximateMemoryUsage() const {
+    return slab_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Bytes held in slabs but not handed out: the free lists and the rest of
+  // the current slab. Sums over the cores, not for every allocation.
+  size_t IdleBytes() const {
+    int64_t in_use = 0;
+    for (size_t i = 0; i < cores_.Size(); ++i) {
+      in_use += cores_.AccessAtCore(i)->in_use_.load(std::memory_order_relaxed);
+    }
+    const int64_t slab_bytes =
+        static_cast<int64_t>(slab_bytes_.load(std::memory_order_relaxed));
+    return in_use < slab_bytes ? static_cast<size_t>(slab_bytes - in_use) : 0;
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next_;
+  };
+
+  struct FreeList {
+    FreeBlock* head_ = nullptr;
+    FreeBlock* tail_ = nullptr;
+    size_t count_ = 0;
+
+    void Push(void* p) {
+      FreeBlock* block = static_cast<FreeBlock*>(p);
+      block->next_ = head_;
+      if (head_ == nullptr) {
+        tail_ = block;
+      }
+      head_ = block;
+      ++count_;
+    }
+
+    void* Pop() {
+      FreeBlock* block = head_;
+      head_ = block->next_;
+      if (head_ == nullptr) {
+        tail_ = nullptr;
+      }
+      --count_;
+      return block;
+    }
+
+    // Moves all of `other` to the front of this list.
+    void Splice(FreeList* other) {
+      if (other->head_ == nullptr) {
+        return;
+      }
+      other->tail_->next_ = head_;
+      if (head_ == nullptr) {
+        tail_ = other->tail_;
+      }
+      head_ = other->head_;
+      count_ += other->count_;
+      *other = FreeList();
+    }
+  };
+
+  struct ALIGN_AS(CACHE_LINE_SIZE) CoreCache {
+    SpinMutex mutex_;
+    FreeList lists_[kNumClasses];
+    // Bytes allocated minus bytes freed on this core, which may go below
+    // zero. Written under mutex_, read without it by IdleBytes().
+    std::atomic<int64_t> in_use_{0};
+
+    void AddInUse(int64_t bytes) {
+      in_use_.store(in_use_.load(std::memory_order_relaxed) + bytes,
+                    std::memory_order_relaxed);
+    }
+  };
+
+  static size_t ClassIndex(size_t bytes) {
+    return (bytes + kAlignment - 1) / kAlignment - 1;
+  }
+
+  // Up to kBatch blocks of class `cls` from the shared lists, or carved
+  // from the current slab.
+  void Refill(size_t cls, FreeList* out) {
+    const size_t size = (cls + 1) * kAlignment;
+    std::lock_guard<std::mutex> lock(mutex_);
+    FreeList& shared = shared_[cls];
+    while (shared.head_ != nullptr && out->count_ < kBatch) {
+      out->Push(shared.Pop());
+    }
+    while (out->count_ < kBatch) {
+      if (slab_left_ < size) {
+        char* slab = static_cast<char*>(std::malloc(kSlabSize));
+        if (slab == nullptr) {
+          break;
+        }
+        slabs_.push_back(slab);
+        slab_bytes_.fetch_add(kSlabSize, std::memory_order_relaxed);
+        slab_next_ = slab;
+        // The tail of the previous slab is lost, at most kMaxClassSize.
+        slab_left_ = kSlabSize;
+      }
+      out->Push(slab_next_);
+      slab_next_ += size;
+      slab_left_ -= size;
+    }
+    if (out->head_ == nullptr) {
+      throw std::bad_alloc();
+    }
+  }
+
+  CoreLocalArray<CoreCache> cores_;
+  // Protects everything below.
+  std::mutex mutex_;
+  FreeList shared_[kNumClasses];
+  std::vector<char*> slabs_;
+  char* slab_next_ = nullptr;
+  size_t slab_left_ = 0;
+  std::atomic<size_t> slab_bytes_{0};
+};
+
+// Allocator for the skiplist's NodeAlloc parameter. Copies share one
+// SlabAllocator, which lives as long as the last of them, i.e. until the
+// skiplist and every node it freed are gone. A default-constructed one
+// uses malloc.
+template <typename T>
+class SlabNodeAllocator {
+ public:
+  using value_type = T;
+
+  SlabNodeAllocator() = default;
+  explicit SlabNodeAllocator(std::shared_ptr<SlabAllocator> slab)
+      : slab_(std::move(slab)) {}
+
+  template <typename U, std::enable_if_t<!std::is_same<U, T>::value, int> = 0>
+  SlabNodeAllocator(const SlabNodeAllocator<U>& other) noexcept
+      : slab_(other.slab()) {}
+
+  T* allocate(size_t count) {
+    const size_t bytes = sizeof(T) * count;
+    void* p = slab_ != nullptr ? slab_->Allocate(bytes) : std::malloc(bytes);
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t count) {
+    if (slab_ != nullptr) {
+      slab_->Deallocate(p, sizeof(T) * count);
+    } else {
+      std::free(p);
+    }
+  }
+
+  const std::shared_ptr<SlabAllocator>& slab() const { return slab_; }
+
+  friend bool operator==(const SlabNodeAllocator& a,
+                         const SlabNodeAllocator& b) noexcept {
+    return a.slab_ == b.slab_;
+  }
+  friend bool operator!=(const SlabNodeAllocator& a,
+                         const SlabNodeAllocator& b) noexcept {
+    return a.slab_ != b.slab_;
+  }
+
+ private:
+  std::shared_ptr<SlabAllocator> slab_;
+};
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_SLAB_ALLOCATOR_H
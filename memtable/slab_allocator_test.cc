@@ -0,0 +1,46 @@
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "memtable/slab_allocator.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(SlabAllocatorTest, ReusesFreedBlocks) {
+  ASSERT_EQ(SlabAllocator::ClassSize(100), 112u);
+  ASSERT_EQ(SlabAllocator::ClassSize(1000), 1000u);
+
+  SlabAllocator slab;
+  std::vector<void*> blocks;
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 256; ++i) {
+      void* p = slab.Allocate(100);
+      ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % SlabAllocator::kAlignment, 0u);
+      blocks.push_back(p);
+    }
+    for (void* p : blocks) {
+      slab.Deallocate(p, 100);
+    }
+    blocks.clear();
+  }
+  // Every round fits in the first slab, whichever cores it ran on.
+  ASSERT_EQ(slab.ApproximateMemoryUsage(), size_t{SlabAllocator::kSlabSize});
+  // All of it is free again, but still held.
+  ASSERT_EQ(slab.IdleBytes(), size_t{SlabAllocator::kSlabSize});
+
+  void* p = slab.Allocate(100);
+  ASSERT_EQ(slab.IdleBytes(), SlabAllocator::kSlabSize - 112u);
+  slab.Deallocate(p, 100);
+  // Large blocks are not taken from slabs.
+  p = slab.Allocate(1000);
+  ASSERT_EQ(slab.IdleBytes(), size_t{SlabAllocator::kSlabSize});
+  slab.Deallocate(p, 1000);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,384 @@
+#ifndef ROCKSDB_SPILL_TIER_H
+#define ROCKSDB_SPILL_TIER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "monitoring/perf_counter.h"
+#include "port/port.h"
+#include "rocksdb/advanced_cache.h"
+#include "rocksdb/comparator.h"
+#include "rocksdb/secondary_cache.h"
+#include "util/coding.h"
+#include "util/mutexlock.h"
+
+namespace rocksdb {
+
+// Second tier of the OmniCache
+//
+// Instead of being dropped, clean eviction victims are spilled to a
+// SecondaryCache (typically a CompressedSecondaryCache) in chunks: runs of
+// entries that were adjacent in the cache, with the gaps between them known
+// to be empty. The chunks stay indexed here by their first and last user
+// key. A Seek that misses in the cache but falls into a chunk promotes the
+// whole chunk back, gaps included.
+//
+// A write that lands in a chunk drops it. Write hooks call Drop() both
+// before and after they update the skiplist (see WriteGuard), and spilling
+// and promoting each happen under the exclusive lock, so a chunk can
+// neither capture a value a write is about to replace nor be promoted
+// over a write that already passed the skiplist.
+class SpillTier {
+ public:
+  // A run of entries, keys as stored (with timestamp, if any).
+  typedef std::vector<std::pair<std::string, std::string>> Chunk;
+  typedef std::vector<std::pair<Slice, Slice>> ChunkView;
+
+  // Limits per chunk: a promotion brings back a whole chunk.
+  static const size_t kMaxChunkKeys = 64;
+  static const size_t kMaxChunkBytes = 32 << 10;
+  // Chunks indexed at most. Index entries are not charged to the cache.
+  static const size_t kMaxChunks = 1 << 20;
+
+  // `stats` (may be null) counts the chunks of the DB.
+  SpillTier(const Comparator* ucmp, size_t ts_sz, Statistics* stats = nullptr)
+      : ts_sz_(ts_sz),
+        stats_(stats),
+        chunks_(UserKeyLess{ucmp}),
+        instance_(NextInstance()) {}
+
+  ~SpillTier() {
+    if (secondary_ == nullptr) {
+      return;
+    }
+    for (const auto& chunk : chunks_) {
+      secondary_->Erase(CacheKey(chunk.second.id));
+    }
+  }
+
+  SpillTier(const SpillTier&) = delete;
+  SpillTier& operator=(const SpillTier&) = delete;
+
+  // Set once, before the cache is used.
+  void SetSecondaryCache(std::shared_ptr<SecondaryCache> secondary) {
+    secondary_ = std::move(secondary);
+  }
+
+  bool Enabled() const { return secondary_ != nullptr; }
+  // Whether any chunk may be spilled. Lock-free, for the hot paths.
+  bool MayHoldChunks() const {
+    return count_.load(std::memory_order_relaxed) > 0;
+  }
+
+  // Calls `build` under the exclusive lock to collect chunks from the
+  // victims still in the cache, registers them, then hands them to the
+  // secondary cache.
+  void Spill(const std::function<void(std::vector<Chunk>*)>& build) {
+    static PERFCOUNTER_DEF_STAT("/oc/spill/", spilled_chunks,
+                                OMNICACHE_SPILLED_CHUNKS);
+    std::vector<Chunk> chunks;
+    std::vector<uint64_t> ids;
+    std::vector<uint64_t> replaced;
+    {
+      WriteLock lock(&mu_);
+      // Before reading any victim: a write that updates one after the read
+      // must see the tier busy and come for the lock, see Drop().
+      count_.fetch_add(1);
+      build(&chunks);
+      for (const Chunk& chunk : chunks) {
+        if (chunk.empty() || chunks_.size() >= kMaxChunks) {
+          ids.push_back(0);
+          continue;
+        }
+        std::string first = UserKey(chunk.front().first).ToString();
+        Slice last = UserKey(chunk.back().first);
+        EraseOverlapping(first, last, true /* last_inclusive */, &replaced);
+        const uint64_t id = ++next_id_;
+        chunks_[std::move(first)] = ChunkRef{last.ToString(), id};
+        ids.push_back(id);
+      }
+      count_.store(chunks_.size());
+    }
+    for (uint64_t id : replaced) {
+      secondary_->Erase(CacheKey(id));
+    }
+    // A Promote() that finds a chunk before it got here treats it as lost.
+    std::string payload;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+      if (ids[i] == 0) {
+        continue;
+      }
+      Encode(chunks[i], &payload);
+      secondary_
+          ->Insert(CacheKey(ids[i]), &payload, Helper(), true /* force */)
+          .PermitUncheckedError();
+      PERFCOUNTER_INC_STAT(spilled_chunks, stats_);
+    }
+  }
+
+  // Promotes the chunk covering `user_key`, if there is one: it leaves the
+  // tier and `fill` is called with its entries under the exclusive lock.
+  // Returns whether that happened.
+  bool Promote(const Slice& user_key,
+               const std::function<void(const ChunkView&)>& fill) {
+    static PERFCOUNTER_DEF_STAT("/oc/spill/", promoted_chunks,
+                                OMNICACHE_SPILL_PROMOTED_CHUNKS);
+    static PERFCOUNTER_DEF_STAT("/oc/spill/", lost_chunks,
+                                OMNICACHE_SPILL_LOST_CHUNKS);
+    std::string first;
+    uint64_t id;
+    {
+      ReadLock lock(&mu_);
+      auto it = Covering(user_key);
+      if (it == chunks_.end()) {
+        return false;
+      }
+      first = it->first;
+      id = it->second.id;
+    }
+    // The lookup may decompress, keep it out of the lock.
+    bool kept = false;
+    std::unique_ptr<SecondaryCacheResultHandle> handle =
+        secondary_->Lookup(CacheKey(id), Helper(), nullptr /* context */,
+                           true /* wait */, true /* advise_erase */,
+                           nullptr /* stats */, kept);
+    std::unique_ptr<std::string> payload(
+        handle != nullptr ? static_cast<std::string*>(handle->Value())
+                          : nullptr);
+    ChunkView entries;
+    const bool decoded = payload != nullptr && Decode(*payload, &entries);
+    WriteLock lock(&mu_);
+    auto it = chunks_.find(first);
+    if (it == chunks_.end() || it->second.id != id) {
+      // A write dropped it in the meantime.
+      return false;
+    }
+    chunks_.erase(it);
+    count_.store(chunks_.size());
+    if (!decoded) {
+      PERFCOUNTER_INC_STAT(lost_chunks, stats_);
+      return false;
+    }
+    fill(entries);
+    PERFCOUNTER_INC_STAT(promoted_chunks, stats_);
+    return true;
+  }
+
+  // Drops the chunks a write to `user_key`, or to [user_key, *end) if
+  // `end` is given, makes stale.
+  void Drop(const Slice& user_key, const Slice* end = nullptr) {
+    if (!Enabled()) {
+      return;
+    }
+    // Orders the caller's skiplist update before the check, against the
+    // victim reads of a concurrent Spill().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (count_.load() == 0) {
+      return;
+    }
+    const Slice& last = end != nullptr ? *end : user_key;
+    {
+      ReadLock lock(&mu_);
+      if (!Overlaps(user_key, last, end == nullptr)) {
+        return;
+      }
+    }
+    std::vector<uint64_t> ids;
+    {
+      WriteLock lock(&mu_);
+      EraseOverlapping(user_key, last, end == nullptr, &ids);
+      count_.store(chunks_.size());
+    }
+    for (uint64_t id : ids) {
+      secondary_->Erase(CacheKey(id));
+    }
+  }
+
+  // Drops the chunks a write overlaps before it reaches the skiplist and
+  // once more after, see the class comment. Keys without timestamp.
+  class WriteGuard {
+   public:
+    WriteGuard(SpillTier* tier, const Slice& user_key,
+               const Slice* end = nullptr)
+        : tier_(tier), user_key_(user_key), end_(end) {
+      tier_->Drop(user_key_, end_);
+    }
+    ~WriteGuard() { tier_->Drop(user_key_, end_); }
+
+    WriteGuard(const WriteGuard&) = delete;
+    WriteGuard& operator=(const WriteGuard&) = delete;
+
+   private:
+    SpillTier* const tier_;
+    const Slice user_key_;
+    const Slice* const end_;
+  };
+
+ private:
+  struct UserKeyLess {
+    const Comparator* ucmp;
+    bool operator()(const std::string& a, const std::string& b) const {
+      return ucmp->CompareWithoutTimestamp(a, false, b, false) < 0;
+    }
+    int Compare(const Slice& a, const Slice& b) const {
+      return ucmp->CompareWithoutTimestamp(a, false, b, false);
+    }
+  };
+
+  struct ChunkRef {
+    std::string last;
+    uint64_t id;
+  };
+  typedef std::map<std::string, ChunkRef, UserKeyLess> ChunkMap;
+
+  static uint64_t NextInstance() {
+    static std::atomic<uint64_t> instances{0};
+    return ++instances;
+  }
+
+  Slice UserKey(const Slice& key) const {
+    return ts_sz_ > 0 ? StripTimestampFromUserKey(key, ts_sz_) : key;
+  }
+
+  // Unique across the tiers sharing a secondary cache.
+  std::string CacheKey(uint64_t id) const {
+    std::string key;
+    PutFixed64(&key, instance_);
+    PutFixed64(&key, id);
+    return key;
+  }
+
+  // The chunk whose [first, last] holds `user_key`. Lock held.
+  ChunkMap::iterator Covering(const Slice& user_key) {
+    auto it = chunks_.upper_bound(user_key.ToString());
+    if (it == chunks_.begin()) {
+      return chunks_.end();
+    }
+    --it;
+    return chunks_.key_comp().Compare(user_key, it->second.last) <= 0
+               ? it
+               : chunks_.end();
+  }
+
+  // Chunks are disjoint and sorted, so their last keys are too: the ones
+  // overlapping [begin, last] (or [begin, last)) precede the first chunk
+  // starting after it. Lock held.
+  bool Overlaps(const Slice& begin, const Slice& last, bool last_inclusive) {
+    auto it = LastCandidate(last, last_inclusive);
+    return it != chunks_.end() &&
+           chunks_.key_comp().Compare(it->second.last, begin) >= 0;
+  }
+
+  void EraseOverlapping(const Slice& begin, const Slice& last,
+                        bool last_inclusive, std::vector<uint64_t>* ids) {
+    auto it = LastCandidate(last, last_inclusive);
+    while (it != chunks_.end() &&
+           chunks_.key_comp().Compare(it->second.last, begin) >= 0) {
+      if (ids != nullptr) {
+        ids->push_back(it->second.id);
+      }
+      if (it == chunks_.begin()) {
+        chunks_.erase(it);
+        break;
+      }
+      it = std::prev(chunks_.erase(it));
+    }
+  }
+
+  // Last chunk starting at or before `last` (before, if exclusive).
+  ChunkMap::iterator LastCandidate(const Slice& last, bool last_inclusive) {
+    auto it = last_inclusive ? chunks_.upper_bound(last.ToString())
+                             : chunks_.lower_bound(last.ToString());
+    return it == chunks_.begin() ? chunks_.end() : std::prev(it);
+  }
+
+  static void Encode(const Chunk& chunk, std::string* payload) {
+    payload->clear();
+    PutVarint32(payload, static_cast<uint32_t>(chunk.size()));
+    for (const auto& entry : chunk) {
+      PutLengthPrefixedSlice(payload, entry.first);
+      PutLengthPrefixedSlice(payload, entry.second);
+    }
+  }
+
+  // `entries` point into `payload`.
+  static bool Decode(const std::string& payload, ChunkView* entries) {
+    Slice input(payload);
+    uint32_t count;
+    if (!GetVarint32(&input, &count)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      Slice key;
+      Slice value;
+      if (!GetLengthPrefixedSlice(&input, &key) ||
+          !GetLengthPrefixedSlice(&input, &value)) {
+        return false;
+      }
+      entries->emplace_back(key, value);
+    }
+    return true;
+  }
+
+  // Chunks are handed over as encoded std::strings.
+  static const Cache::CacheItemHelper* Helper() {
+    static const Cache::CacheItemHelper kBasic(CacheEntryRole::kOmniCache,
+                                               &Delete);
+    static const Cache::CacheItemHelper kHelper(
+        CacheEntryRole::kOmniCache, &Delete, &Size, &SaveTo, &Create,
+        &kBasic);
+    return &kHelper;
+  }
+
+  static void Delete(Cache::ObjectPtr obj, MemoryAllocator* /*allocator*/) {
+    delete static_cast<std::string*>(obj);
+  }
+
+  static size_t Size(Cache::ObjectPtr obj) {
+    return static_cast<std::string*>(obj)->size();
+  }
+
+  static Status SaveTo(Cache::ObjectPtr from, size_t from_offset,
+                       size_t length, char* out) {
+    const std::string* payload = static_cast<std::string*>(from);
+    memcpy(out, payload->data() + from_offset, length);
+    return Status::OK();
+  }
+
+  static Status Create(const Slice& data, CompressionType type,
+                       CacheTier /*source*/,
+                       Cache::CreateContext* /*context*/,
+                       MemoryAllocator* /*allocator*/, Cache::ObjectPtr* out,
+                       size_t* charge) {
+    if (type != kNoCompression) {
+      return Status::NotSupported("compressed OmniCache chunk");
+    }
+    *out = new std::string(data.data(), data.size());
+    *charge = data.size();
+    return Status::OK();
+  }
+
+  const size_t ts_sz_;
+  Statistics* const stats_;
+  std::shared_ptr<SecondaryCache> secondary_;
+  // Protects everything below.
+  port::RWMutex mu_;
+  // By first user key.
+  ChunkMap chunks_;
+  uint64_t next_id_ = 0;
+  // Chunks indexed, plus one while a Spill() is collecting.
+  std::atomic<size_t> count_{0};
+  const uint64_t instance_;
+};
+
+}  // namespace rocksdb
+
+#endif  // ROCKSDB_SPILL_TIER_H
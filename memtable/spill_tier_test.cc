@@ -0,0 +1,71 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "memtable/spill_tier.h"
+#include "rocksdb/cache.h"
+#include "rocksdb/comparator.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(SpillTierTest, PromoteAndDrop) {
+  CompressedSecondaryCacheOptions opts;
+  opts.capacity = 1 << 20;
+  opts.compression_type = kNoCompression;
+  SpillTier tier(BytewiseComparator(), 0);
+  tier.SetSecondaryCache(NewCompressedSecondaryCache(opts));
+  auto spill = [&tier](const std::vector<std::string>& keys) {
+    tier.Spill([&keys](std::vector<SpillTier::Chunk>* chunks) {
+      SpillTier::Chunk chunk;
+      for (const auto& key : keys) {
+        chunk.emplace_back(key, "v" + key);
+      }
+      chunks->push_back(std::move(chunk));
+    });
+  };
+  std::vector<std::string> promoted;
+  auto promote = [&tier, &promoted](const std::string& key) {
+    promoted.clear();
+    return tier.Promote(key, [&promoted](const SpillTier::ChunkView& entries) {
+      for (const auto& entry : entries) {
+        ASSERT_EQ(entry.second.ToString(), "v" + entry.first.ToString());
+        promoted.push_back(entry.first.ToString());
+      }
+    });
+  };
+
+  spill({"b", "d", "f"});
+  ASSERT_TRUE(tier.MayHoldChunks());
+  ASSERT_FALSE(promote("a"));
+  ASSERT_FALSE(promote("g"));
+  // Gaps inside the chunk count too.
+  ASSERT_TRUE(promote("c"));
+  ASSERT_EQ(promoted, std::vector<std::string>({"b", "d", "f"}));
+  ASSERT_FALSE(promote("d"));
+  ASSERT_FALSE(tier.MayHoldChunks());
+
+  spill({"b", "d", "f"});
+  spill({"x"});
+  // Writes outside a chunk leave it alone.
+  tier.Drop("a");
+  const Slice end("b");
+  tier.Drop("a", &end);
+  tier.Drop("g");
+  ASSERT_TRUE(promote("x"));
+  spill({"x"});
+  // Writes inside drop it, points and ranges alike.
+  tier.Drop("e");
+  ASSERT_FALSE(promote("d"));
+  const Slice x_end("y");
+  tier.Drop("w", &x_end);
+  ASSERT_FALSE(promote("x"));
+  ASSERT_FALSE(tier.MayHoldChunks());
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
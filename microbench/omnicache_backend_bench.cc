@@ -0,0 +1,123 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "memtable/omnicache_backend.h"
+#include "rocksdb/comparator.h"
+#include "util/random.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+static const size_t kOmniCacheValueSize = 100;
+static const size_t kOmniCacheScanLength = 16;
+
+static std::string OmniCacheBenchKey(uint64_t i) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%016llu", static_cast<unsigned long long>(i));
+  return buf;
+}
+
+// A mix of point reads, short scans and write-hook updates over a key space
+// cached as one range, on the backend given by the first argument. Reads
+// and scans always hit, so the numbers are the cost of the structure
+// itself under contention.
+static void OmniCacheBackendMix(benchmark::State& state) {
+  auto type = static_cast<OmniCacheBackendType>(state.range(0));
+  int read_pct = static_cast<int>(state.range(1));
+  int scan_pct = static_cast<int>(state.range(2));
+  uint64_t key_num = state.range(3);
+
+  static std::unique_ptr<OmniCacheBackend> cache = nullptr;
+  std::string value(kOmniCacheValueSize, 'v');
+
+  if (state.thread_index() == 0) {
+    // Capacity above the key space: nothing is evicted during the run.
+    cache = NewOmniCacheBackend(type, BytewiseComparator(),
+                                2 * key_num * kOmniCacheValueSize);
+    std::string prev = OmniCacheBenchKey(0);
+    cache->Insert(prev, value);
+    for (uint64_t i = 1; i < key_num; i++) {
+      std::string key = OmniCacheBenchKey(i);
+      cache->Append(prev, key, value);
+      prev = std::move(key);
+    }
+  }
+
+  auto rnd = Random(301 + state.thread_index());
+  std::string result;
+  uint64_t reads = 0;
+  uint64_t hits = 0;
+
+  for (auto _ : state) {
+    // Not paused around: pausing takes a lock, which would serialize the
+    // threads this is meant to measure.
+    std::string key = OmniCacheBenchKey(rnd.Uniform(static_cast<int>(key_num)));
+    int op = static_cast<int>(rnd.Uniform(100));
+    if (op < read_pct) {
+      reads++;
+      hits += cache->Get(key, &result) ? 1 : 0;
+    } else if (op < read_pct + scan_pct) {
+      reads++;
+      hits += cache->Scan(key, kOmniCacheScanLength) > 0 ? 1 : 0;
+    } else {
+      cache->Update(key, value);
+    }
+  }
+
+  state.counters["hit_rate"] = benchmark::Counter(
+      reads > 0 ? static_cast<double>(hits) / reads : 0,
+      benchmark::Counter::kAvgThreads);
+
+  if (state.thread_index() == 0) {
+    state.SetLabel(cache->Name());
+    cache.reset();
+  }
+}
+
+static void OmniCacheBackendMixArguments(benchmark::internal::Benchmark* b) {
+  for (int type : {static_cast<int>(OmniCacheBackendType::kFollySkipList),
+                   static_cast<int>(OmniCacheBackendType::kCacheSkipList)}) {
+    // {read_pct, scan_pct}, updates make up the rest
+    for (const auto& mix : std::vector<std::pair<int, int>>{
+             {100, 0}, {95, 0}, {50, 0}, {0, 100}, {0, 95}, {45, 45}}) {
+      for (int64_t key_num : {1l << 16, 1l << 20}) {
+        b->Args({type, mix.first, mix.second, key_num});
+      }
+    }
+  }
+  b->ArgNames({"backend", "read_pct", "scan_pct", "key_num"});
+}
+
+static const uint64_t OmniCacheBackendMixNum = 1024000l;
+BENCHMARK(OmniCacheBackendMix)
+    ->Threads(1)
+    ->Iterations(OmniCacheBackendMixNum)
+    ->UseRealTime()
+    ->Apply(OmniCacheBackendMixArguments);
+BENCHMARK(OmniCacheBackendMix)
+    ->Threads(8)
+    ->Iterations(OmniCacheBackendMixNum / 8)
+    ->UseRealTime()
+    ->Apply(OmniCacheBackendMixArguments);
+BENCHMARK(OmniCacheBackendMix)
+    ->Threads(32)
+    ->Iterations(OmniCacheBackendMixNum / 32)
+    ->UseRealTime()
+    ->Apply(OmniCacheBackendMixArguments);
+BENCHMARK(OmniCacheBackendMix)
+    ->Threads(64)
+    ->Iterations(OmniCacheBackendMixNum / 64)
+    ->UseRealTime()
+    ->Apply(OmniCacheBackendMixArguments);
+
+}  // namespace ROCKSDB_NAMESPACE
+
+BENCHMARK_MAIN();
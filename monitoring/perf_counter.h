@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "monitoring/statistics_impl.h"
+#include "port/port.h"
+#include "rocksdb/perf_data_client.h"
+#include "rocksdb/statistics.h"
+#include "util/core_local.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+// The type-independent part of PerfCounter: one slot per core, each on its
+// own cache line. Updates are a relaxed add to the slot of the current core,
+// readers sum all slots.
+class PerfCounterBase {
+ public:
+  PerfCounterBase(const PerfCounterBase&) = delete;
+  PerfCounterBase& operator=(const PerfCounterBase&) = delete;
+
+  // Total over all cores. Unsigned counters that also go down wrap around
+  // like the value they count; the total is exact once updates stop.
+  uint64_t Sum() const {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < slots_.Size(); ++i) {
+      sum += slots_.AccessAtCore(i)->value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  Tickers ticker() const { return ticker_; }
+
+ protected:
+  explicit PerfCounterBase(Tickers ticker) : ticker_(ticker) {}
+
+  void Add(uint64_t n) {
+    slots_.Access()->value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+ private:
+  struct ALIGN_AS(CACHE_LINE_SIZE) Slot {
+    std::atomic<uint64_t> value{0};
+    char padding[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+  };
+  static_assert(sizeof(Slot) % CACHE_LINE_SIZE == 0,
+                "Slots must not share a cache line");
+
+  CoreLocalArray<Slot> slots_;
+  const Tickers ticker_;
+};
+
+// A process-wide event counter, published to the perf server under `name`.
+// A counter bound to a ticker also counts each event of a DB in that DB's
+// Statistics, see Record().
+template <typename T = uint64_t>
+class PerfCounter : public PerfCounterBase {
+  static_assert(std::is_integral<T>::value, "T must be an integral type");
+
+ public:
+  explicit PerfCounter(std::string name, Tickers ticker = TICKER_ENUM_MAX)
+      : PerfCounterBase(ticker), name_(std::move(name)) {
+    Register();
+  }
+
+  void Inc(T inc) { Add(static_cast<uint64_t>(inc)); }
+  // Inc(), and the same in the ticker of the DB whose `stats` (may be null)
+  // are passed.
+  void Record(Statistics* stats, T inc = 1) {
+    assert(ticker() < TICKER_ENUM_MAX);
+    Inc(inc);
+    RecordTick(stats, ticker(), static_cast<uint64_t>(inc));
+  }
+  void Dec(T dec) { Add(~static_cast<uint64_t>(dec) + 1); }
+  T Value() const { return static_cast<T>(Sum()); }
+  void Dump() const {
+    fprintf(stderr, "%s: %f\n", name_.c_str(), static_cast<double>(Value()));
+  }
+
+  PerfCounter& operator++() { Inc(1); return *this; }
+  PerfCounter& operator++(int) { Inc(1); return *this; }
+  PerfCounter& operator--() { Dec(1); return *this; }
+  PerfCounter& operator--(int) { Dec(1); return *this; }
+  PerfCounter& operator+=(T inc) { Inc(inc); return *this; }
+  PerfCounter& operator-=(T dec) { Dec(dec); return *this; }
+
+  const std::string& name() const { return name_; }
+
+ private:
+  void Register() {
+    auto& client = PerfDataClient::GetPerfDataClient();
+    client.RegisterMetric(name_,
+                          [this]() { return static_cast<double>(Value()); });
+  }
+
+  const std::string name_;
+};
+
+#define PERFCOUNTER_DEF_T(type, hier, name) PerfCounter<type> name{hier #name}
+#define PERFCOUNTER_DEF(hier, name) PERFCOUNTER_DEF_T(uint64_t, hier, name)
+// Same, bound to the Statistics ticker `stat`.
+#define PERFCOUNTER_DEF_STAT(hier, name, stat) \
+  PerfCounter<uint64_t> name{hier #name, stat}
+#define PERFCOUNTER_INC(name) do { name += 1; } while (0)
+#define PERFCOUNTER_INC_STAT(name, stats) do { name.Record(stats); } while (0)
+#define PERFCOUNTER_DEC(name) do { name -= 1; } while (0)
+
+}  // namespace ROCKSDB_NAMESPACE
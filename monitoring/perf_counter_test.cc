@@ -0,0 +1,48 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "monitoring/perf_counter.h"
+#include "rocksdb/statistics.h"
+#include "test_util/testharness.h"
+
+namespace ROCKSDB_NAMESPACE {
+
+TEST(PerfCounterTest, SumsCoresAndRecordsPerDB) {
+  PerfCounter<uint64_t> hits("/test/hits", OMNICACHE_ITER_SEEK_HIT);
+  PerfCounter<uint64_t> depth("/test/depth");
+  auto stats1 = CreateDBStatistics();
+  auto stats2 = CreateDBStatistics();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      Statistics* stats = t % 2 == 0 ? stats1.get() : stats2.get();
+      for (int i = 0; i < 10000; ++i) {
+        PERFCOUNTER_INC_STAT(hits, t < 3 ? stats : nullptr);
+        depth.Inc(2);
+        depth.Dec(2);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  depth.Inc(5);
+  ASSERT_EQ(hits.Value(), 40000u);
+  ASSERT_EQ(depth.Value(), 5u);
+
+  // Each DB only sees its own events, and a reset sticks.
+  ASSERT_EQ(stats1->getTickerCount(OMNICACHE_ITER_SEEK_HIT), 20000u);
+  ASSERT_EQ(stats2->getTickerCount(OMNICACHE_ITER_SEEK_HIT), 10000u);
+  ASSERT_OK(stats1->Reset());
+  hits.Record(stats1.get(), 3);
+  ASSERT_EQ(stats1->getTickerCount(OMNICACHE_ITER_SEEK_HIT), 3u);
+  ASSERT_EQ(hits.Value(), 40003u);
+}
+
+}  // namespace ROCKSDB_NAMESPACE
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -3,10 +3,17 @@
 #include <grpcpp/grpcpp.h>
 
 #include "perfdata.grpc.pb.h"
-#include "rocksdb/omnicache.h"
 
 namespace rocksdb {
 
+namespace {
+// Set by PerfDataClient::Enable(), empty while the client is off.
+std::string& ServerAddress() {
+  static std::string server_address;
+  return server_address;
+}
+}  // anonymous namespace
+
 class PerfDataClientImpl {
  public:
   PerfDataClientImpl(const std::string& server_address) : stopped_(false) {
@@ -31,8 +38,7 @@ class PerfDataClientImpl {
   }
 
   static PerfDataClient& GetPerfDataClient() {
-    static PerfDataClient client(OmniCacheEnv::GetOmniCacheEnv().perfEnabled,
-                                 OmniCacheEnv::GetOmniCacheEnv().perfServer);
+    static PerfDataClient client(!ServerAddress().empty(), ServerAddress());
     return client;
   }
 
@@ -129,6 +135,10 @@ PerfDataClient& PerfDataClient::GetPerfDataClient() {
   return PerfDataClientImpl::GetPerfDataClient();
 }
 
+void PerfDataClient::Enable(const std::string& server_address) {
+  ServerAddress() = server_address;
+}
+
 void PerfDataClient::RegisterMetric(const std::string& name, double& value) {
   if (enabled_) {
     pimpl_->RegisterMetric(name, value);
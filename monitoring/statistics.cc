@@ -265,6 +265,20 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
     {PREFETCH_BYTES, "rocksdb.prefetch.bytes"},
     {PREFETCH_BYTES_USEFUL, "rocksdb.prefetch.bytes.useful"},
     {PREFETCH_HITS, "rocksdb.prefetch.hits"},
+    {OMNICACHE_ITER_SEEK_HIT, "rocksdb.omnicache.iter.seek.hit"},
+    {OMNICACHE_ITER_SEEK_MISS, "rocksdb.omnicache.iter.seek.miss"},
+    {OMNICACHE_ITER_NEXT_HIT, "rocksdb.omnicache.iter.next.hit"},
+    {OMNICACHE_ITER_NEXT_MISS, "rocksdb.omnicache.iter.next.miss"},
+    {OMNICACHE_ADMISSION_REJECTED, "rocksdb.omnicache.admission.rejected"},
+    {OMNICACHE_FILL_DROPPED, "rocksdb.omnicache.fill.dropped"},
+    {OMNICACHE_EVICTED, "rocksdb.omnicache.evicted"},
+    {OMNICACHE_GHOST_HITS, "rocksdb.omnicache.ghost.hits"},
+    {OMNICACHE_WRITTEN_BACK, "rocksdb.omnicache.written.back"},
+    {OMNICACHE_SPILLED_CHUNKS, "rocksdb.omnicache.spilled.chunks"},
+    {OMNICACHE_SPILL_PROMOTED_CHUNKS,
+     "rocksdb.omnicache.spill.promoted.chunks"},
+    {OMNICACHE_SPILL_LOST_CHUNKS, "rocksdb.omnicache.spill.lost.chunks"},
+    {OMNICACHE_WARM_UP_KEYS, "rocksdb.omnicache.warm.up.keys"},
 };
 
 const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
@@ -335,6 +349,7 @@ const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
     {ASYNC_PREFETCH_ABORT_MICROS, "rocksdb.async.prefetch.abort.micros"},
     {TABLE_OPEN_PREFETCH_TAIL_READ_BYTES,
      "rocksdb.table.open.prefetch.tail.read.bytes"},
+    {OMNICACHE_EVICT_QUEUE_DEPTH, "rocksdb.omnicache.evict.queue.depth"},
 };
 
 std::shared_ptr<Statistics> CreateDBStatistics() {
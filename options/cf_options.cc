@@ -24,6 +24,7 @@
 #include "rocksdb/env.h"
 #include "rocksdb/file_system.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/secondary_cache.h"
 #include "rocksdb/options.h"
 #include "rocksdb/table.h"
 #include "rocksdb/utilities/object_registry.h"
@@ -568,6 +569,32 @@ static std::unordered_map<std::string, OptionTypeInfo>
          {offsetof(struct MutableCFOptions, memtable_max_range_deletions),
           OptionType::kUInt32T, OptionVerificationType::kNormal,
           OptionTypeFlags::kMutable}},
+        {"omnicache_capacity",
+         {offsetof(struct MutableCFOptions, omnicache_capacity),
+          OptionType::kSizeT, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
+        {"omnicache_admission_min_frequency",
+         {offsetof(struct MutableCFOptions,
+                   omnicache_admission_min_frequency),
+          OptionType::kUInt64T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
+        {"omnicache_max_iterator_fills",
+         {offsetof(struct MutableCFOptions, omnicache_max_iterator_fills),
+          OptionType::kUInt64T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
+        {"omnicache_replacement_policy",
+         OptionTypeInfo::Enum<OmniCacheReplacementPolicy>(
+             offsetof(struct MutableCFOptions, omnicache_replacement_policy),
+             &omnicache_replacement_policy_string_map,
+             OptionTypeFlags::kMutable)},
+        {"omnicache_pin_value_min_size",
+         {offsetof(struct MutableCFOptions, omnicache_pin_value_min_size),
+          OptionType::kUInt64T, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
+        {"omnicache_warm_restart",
+         {offsetof(struct MutableCFOptions, omnicache_warm_restart),
+          OptionType::kBoolean, OptionVerificationType::kNormal,
+          OptionTypeFlags::kMutable}},
 
 };
 
@@ -814,6 +841,16 @@ static std::unordered_map<std::string, OptionTypeInfo>
             auto* cache = static_cast<std::shared_ptr<Cache>*>(addr);
             return Cache::CreateFromString(opts, value, cache);
           }}},
+        {"omnicache_secondary_cache",
+         {offsetof(struct ImmutableCFOptions, omnicache_secondary_cache),
+          OptionType::kUnknown, OptionVerificationType::kNormal,
+          (OptionTypeFlags::kCompareNever | OptionTypeFlags::kDontSerialize),
+          // Parses the input value as a SecondaryCache
+          [](const ConfigOptions& opts, const std::string&,
+             const std::string& value, void* addr) {
+            auto* cache = static_cast<std::shared_ptr<SecondaryCache>*>(addr);
+            return SecondaryCache::CreateFromString(opts, value, cache);
+          }}},
         {"persist_user_defined_timestamps",
          {offsetof(struct ImmutableCFOptions, persist_user_defined_timestamps),
           OptionType::kBoolean, OptionVerificationType::kNormal,
@@ -961,6 +998,7 @@ ImmutableCFOptions::ImmutableCFOptions(const ColumnFamilyOptions& cf_options)
       compaction_thread_limiter(cf_options.compaction_thread_limiter),
       sst_partitioner_factory(cf_options.sst_partitioner_factory),
       blob_cache(cf_options.blob_cache),
+      omnicache_secondary_cache(cf_options.omnicache_secondary_cache),
       persist_user_defined_timestamps(
           cf_options.persist_user_defined_timestamps) {}
 
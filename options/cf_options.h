@@ -87,6 +87,8 @@ struct ImmutableCFOptions {
 
   std::shared_ptr<Cache> blob_cache;
 
+  std::shared_ptr<SecondaryCache> omnicache_secondary_cache;
+
   bool persist_user_defined_timestamps;
 };
 
@@ -172,6 +174,13 @@ struct MutableCFOptions {
             options.sample_for_compression),  // TODO: is 0 fine here?
         compression_per_level(options.compression_per_level),
         memtable_max_range_deletions(options.memtable_max_range_deletions),
+        omnicache_capacity(options.omnicache_capacity),
+        omnicache_admission_min_frequency(
+            options.omnicache_admission_min_frequency),
+        omnicache_max_iterator_fills(options.omnicache_max_iterator_fills),
+        omnicache_replacement_policy(options.omnicache_replacement_policy),
+        omnicache_pin_value_min_size(options.omnicache_pin_value_min_size),
+        omnicache_warm_restart(options.omnicache_warm_restart),
         bottommost_file_compaction_delay(
             options.bottommost_file_compaction_delay) {
     RefreshDerivedOptions(options.num_levels, options.compaction_style);
@@ -223,7 +232,13 @@ struct MutableCFOptions {
         memtable_protection_bytes_per_key(0),
         block_protection_bytes_per_key(0),
         sample_for_compression(0),
-        memtable_max_range_deletions(0) {}
+        memtable_max_range_deletions(0),
+        omnicache_capacity(0),
+        omnicache_admission_min_frequency(0),
+        omnicache_max_iterator_fills(0),
+        omnicache_replacement_policy(OmniCacheReplacementPolicy::kClock),
+        omnicache_pin_value_min_size(0),
+        omnicache_warm_restart(false) {}
 
   explicit MutableCFOptions(const Options& options);
 
@@ -318,6 +333,12 @@ struct MutableCFOptions {
   uint64_t sample_for_compression;
   std::vector<CompressionType> compression_per_level;
   uint32_t memtable_max_range_deletions;
+  size_t omnicache_capacity;
+  uint64_t omnicache_admission_min_frequency;
+  uint64_t omnicache_max_iterator_fills;
+  OmniCacheReplacementPolicy omnicache_replacement_policy;
+  uint64_t omnicache_pin_value_min_size;
+  bool omnicache_warm_restart;
   uint32_t bottommost_file_compaction_delay;
 
   // Derived options
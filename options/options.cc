@@ -23,12 +23,14 @@
 #include "rocksdb/filter_policy.h"
 #include "rocksdb/memtablerep.h"
 #include "rocksdb/merge_operator.h"
+#include "rocksdb/secondary_cache.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
 #include "rocksdb/sst_file_manager.h"
 #include "rocksdb/sst_partitioner.h"
 #include "rocksdb/table.h"
 #include "rocksdb/table_properties.h"
+#include "rocksdb/utilities/options_type.h"
 #include "rocksdb/wal_filter.h"
 #include "table/block_based/block_based_table_factory.h"
 #include "util/compression.h"
@@ -466,6 +468,33 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
                      experimental_mempurge_threshold);
     ROCKS_LOG_HEADER(log, "           Options.memtable_max_range_deletions: %d",
                      memtable_max_range_deletions);
+    ROCKS_LOG_HEADER(log,
+                     "                     Options.omnicache_capacity: %" ROCKSDB_PRIszt,
+                     omnicache_capacity);
+    ROCKS_LOG_HEADER(log,
+                     "      Options.omnicache_admission_min_frequency: %" PRIu64,
+                     omnicache_admission_min_frequency);
+    ROCKS_LOG_HEADER(log,
+                     "           Options.omnicache_max_iterator_fills: %" PRIu64,
+                     omnicache_max_iterator_fills);
+    std::string str_replacement_policy;
+    SerializeEnum<OmniCacheReplacementPolicy>(
+        omnicache_replacement_policy_string_map, omnicache_replacement_policy,
+        &str_replacement_policy);
+    ROCKS_LOG_HEADER(log,
+                     "           Options.omnicache_replacement_policy: %s",
+                     str_replacement_policy.c_str());
+    ROCKS_LOG_HEADER(log,
+                     "           Options.omnicache_pin_value_min_size: %" PRIu64,
+                     omnicache_pin_value_min_size);
+    ROCKS_LOG_HEADER(log,
+                     "                 Options.omnicache_warm_restart: %d",
+                     omnicache_warm_restart);
+    if (omnicache_secondary_cache) {
+      ROCKS_LOG_HEADER(log,
+                       "              Options.omnicache_secondary_cache: %s",
+                       omnicache_secondary_cache->Name());
+    }
 }  // ColumnFamilyOptions::Dump
 
 void Options::Dump(Logger* log) const {
@@ -274,6 +274,14 @@ void UpdateColumnFamilyOptions(const MutableCFOptions& moptions,
   cf_opts->last_level_temperature = moptions.last_level_temperature;
   cf_opts->default_write_temperature = moptions.default_write_temperature;
   cf_opts->memtable_max_range_deletions = moptions.memtable_max_range_deletions;
+  cf_opts->omnicache_capacity = moptions.omnicache_capacity;
+  cf_opts->omnicache_admission_min_frequency =
+      moptions.omnicache_admission_min_frequency;
+  cf_opts->omnicache_max_iterator_fills = moptions.omnicache_max_iterator_fills;
+  cf_opts->omnicache_replacement_policy =
+      moptions.omnicache_replacement_policy;
+  cf_opts->omnicache_pin_value_min_size = moptions.omnicache_pin_value_min_size;
+  cf_opts->omnicache_warm_restart = moptions.omnicache_warm_restart;
 }
 
 void UpdateColumnFamilyOptions(const ImmutableCFOptions& ioptions,
@@ -308,6 +316,7 @@ void UpdateColumnFamilyOptions(const ImmutableCFOptions& ioptions,
   cf_opts->compaction_thread_limiter = ioptions.compaction_thread_limiter;
   cf_opts->sst_partitioner_factory = ioptions.sst_partitioner_factory;
   cf_opts->blob_cache = ioptions.blob_cache;
+  cf_opts->omnicache_secondary_cache = ioptions.omnicache_secondary_cache;
   cf_opts->preclude_last_level_data_seconds =
       ioptions.preclude_last_level_data_seconds;
   cf_opts->preserve_internal_time_seconds =
@@ -823,6 +832,13 @@ std::unordered_map<std::string, PrepopulateBlobCache>
         {"kDisable", PrepopulateBlobCache::kDisable},
         {"kFlushOnly", PrepopulateBlobCache::kFlushOnly}};
 
+std::unordered_map<std::string, OmniCacheReplacementPolicy>
+    OptionsHelper::omnicache_replacement_policy_string_map = {
+        {"kClock", OmniCacheReplacementPolicy::kClock},
+        {"kFrequency", OmniCacheReplacementPolicy::kFrequency},
+        {"kRoundRobin", OmniCacheReplacementPolicy::kRoundRobin},
+        {"kAdaptive", OmniCacheReplacementPolicy::kAdaptive}};
+
 Status OptionTypeInfo::NextToken(const std::string& opts, char delimiter,
                                  size_t pos, size_t* end, std::string* token) {
   while (pos < opts.size() && isspace(opts[pos])) {
@@ -416,6 +416,8 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
        sizeof(uint64_t)},
       {offsetof(struct ColumnFamilyOptions, blob_cache),
        sizeof(std::shared_ptr<Cache>)},
+      {offsetof(struct ColumnFamilyOptions, omnicache_secondary_cache),
+       sizeof(std::shared_ptr<SecondaryCache>)},
       {offsetof(struct ColumnFamilyOptions, comparator), sizeof(Comparator*)},
       {offsetof(struct ColumnFamilyOptions, merge_operator),
        sizeof(std::shared_ptr<MergeOperator>)},
@@ -565,6 +567,12 @@ TEST_F(OptionsSettableTest, ColumnFamilyOptionsAllFieldsSettable) {
       "persist_user_defined_timestamps=true;"
       "block_protection_bytes_per_key=1;"
       "memtable_max_range_deletions=999999;"
+      "omnicache_capacity=1048576;"
+      "omnicache_admission_min_frequency=2;"
+      "omnicache_max_iterator_fills=1000;"
+      "omnicache_replacement_policy=kAdaptive;"
+      "omnicache_pin_value_min_size=65536;"
+      "omnicache_warm_restart=true;"
       "bottommost_file_compaction_delay=7200;",
       new_options));
 
@@ -652,7 +652,7 @@ Status BlockBasedTableFactory::ValidateOptions(
         CacheEntryRole::kCompressionDictionaryBuildingBuffer,
         CacheEntryRole::kFilterConstruction,
         CacheEntryRole::kBlockBasedTableReader, CacheEntryRole::kFileMetadata,
-        CacheEntryRole::kBlobCache};
+        CacheEntryRole::kBlobCache, CacheEntryRole::kOmniCache};
     if (options.charged != CacheEntryRoleOptions::Decision::kFallback &&
         kMemoryChargingSupported.count(role) == 0) {
       return Status::NotSupported(
@@ -21,7 +21,6 @@
 // are templates.
 
 namespace ROCKSDB_NAMESPACE {
-extern OmniCache* g_oc_;
 namespace {
 using IterPlaceholderCacheInterface =
     PlaceholderCacheInterface<CacheEntryRole::kMisc>;